@@ -0,0 +1,548 @@
+#include"benchmark.h"
+
+#include"physics/physDefine.h"
+#include"objects/modelFunc.h"
+#include"physics/satCollision.h"
+#include"physics/gjkCollision.h"
+#include"core/timing.h"
+#include"core/error.h"
+#include<algorithm>
+#include<fstream>
+#include<limits>
+#include<stdio.h>
+#include<string.h>
+#include<math.h>
+#include<random>
+#include<thread>
+
+using std::min;
+using std::max;
+
+
+Benchmark::Benchmark() : window_(options_), renderer_(options_.graphics), soundEngine_(options_.sound),
+	world_(options_, resCache_, window_, renderer_, soundEngine_) {
+
+}
+
+void Benchmark::start(int argc, char** argv){
+
+	// Arguments: [stack | threads | narrowphase | batch | ccd] [number of updates] [number of bodies] [per-update csv output]
+	// Narrowphase run takes rounds of tests and pairs per hull instead of updates and bodies
+	bool stack			= argc > 1 && strcmp(argv[1], "stack") == 0;
+	bool threads		= argc > 1 && strcmp(argv[1], "threads") == 0;
+	bool narrowphase	= argc > 1 && strcmp(argv[1], "narrowphase") == 0;
+	bool batch			= argc > 1 && strcmp(argv[1], "batch") == 0;
+	bool ccd			= argc > 1 && strcmp(argv[1], "ccd") == 0;
+	int arg				= stack || threads || narrowphase || batch || ccd ? 2 : 1;
+
+	int numUpdates	= argc > arg ? atoi(argv[arg]) : narrowphase ? NTW_BENCH_NARROWPHASE_ROUNDS : NTW_BENCH_DEFAULT_UPDATES;
+	int numBodies	= argc > arg + 1 ? atoi(argv[arg + 1]) : narrowphase ? NTW_BENCH_NARROWPHASE_PAIRS : NTW_BENCH_DEFAULT_BODIES;
+	string csvPath	= argc > arg + 2 ? argv[arg + 2] : "";
+
+	if(numUpdates <= 0 || numBodies <= 0){
+		ntw::error("Usage: [stack | threads | narrowphase | batch | ccd] [number of updates] [number of bodies] [csv output path]");
+		return;
+	}
+
+	loadModels();
+
+	if(narrowphase)
+		runNarrowphase(numUpdates, numBodies);
+
+	else if(threads)
+		runThreadScaling(numUpdates, numBodies, csvPath);
+
+	// Run scene without and with batch solving, sleeping is disabled so every update solves the whole pile
+	// The block solver keeps box piles out of the batch solver, so it is disabled for both runs
+	else if(batch){
+		world_.getPhysicsEngine().setAllowSleeping(false);
+		world_.getPhysicsEngine().setBlockSolver(false);
+
+		for(int i = 0; i < 2; i++){
+			bool batchSolver = i == 1;
+
+			printf("%sBatch benchmark: %d bodies, %d updates, batch solver %s\n", i == 0 ? "" : "\n",
+				numBodies, numUpdates, batchSolver ? "on" : "off");
+
+			world_.getPhysicsEngine().setBatchSolver(batchSolver);
+
+			createScene(numBodies);
+			run(numUpdates);
+			report(csvPath.empty() ? csvPath : csvPath + (batchSolver ? ".batch.csv" : ".sequential.csv"));
+
+			world_.unload();
+		}
+	}
+
+	// Fire bodies at a thin wall without and with continuous collision
+	else if(ccd){
+		for(int i = 0; i < 2; i++){
+			bool continuousCollision = i == 1;
+
+			printf("%sContinuous collision benchmark: %d bodies, %d updates, continuous collision %s\n", i == 0 ? "" : "\n",
+				numBodies, numUpdates, continuousCollision ? "on" : "off");
+
+			createWallScene(numBodies, continuousCollision);
+			run(numUpdates);
+			report(csvPath.empty() ? csvPath : csvPath + (continuousCollision ? ".ccd.csv" : ".discrete.csv"));
+
+			// Bodies are fired from behind the wall in the positive x direction
+			int numThrough = 0;
+
+			for(Object* obj : world_.getObjects())
+				if(obj->getPhysicsType() == PhysicsType::RIGID_BODY && obj->getPosition()[0] > 0)
+					numThrough++;
+
+			printf("Bodies through wall: %d\n", numThrough);
+
+			world_.unload();
+		}
+	}
+
+	else if(!stack){
+		printf("Benchmark: %d bodies, %d updates\n", numBodies, numUpdates);
+
+		createScene(numBodies);
+		run(numUpdates);
+		report(csvPath);
+	}
+
+	// Run stack scene without and with warm starting, then with the block solver
+	else{
+		const char* csvSuffixes[3] = {".cold.csv", ".warm.csv", ".block.csv"};
+
+		// Columns are large enough to be batch solved without the block solver, so runs only differ in the sequential solver
+		world_.getPhysicsEngine().setBatchSolver(false);
+
+		for(int i = 0; i < 3; i++){
+			bool warmStarting = i >= 1;
+			bool blockSolver = i == 2;
+
+			printf("%sStack benchmark: %d bodies, %d updates, warm starting %s, block solver %s\n", i == 0 ? "" : "\n",
+				numBodies, numUpdates, warmStarting ? "on" : "off", blockSolver ? "on" : "off");
+
+			world_.getPhysicsEngine().setWarmStarting(warmStarting);
+			world_.getPhysicsEngine().setBlockSolver(blockSolver);
+
+			createStackScene(numBodies);
+			run(numUpdates);
+			report(csvPath.empty() ? csvPath : csvPath + csvSuffixes[i]);
+
+			world_.unload();
+		}
+	}
+
+	finish();
+}
+
+void Benchmark::runThreadScaling(int numUpdates, int numBodies, const string& csvPath){
+
+	// Thread counts to run, doubling up to one per hardware thread
+	int maxThreads = max((int)std::thread::hardware_concurrency(), 1);
+	vector<int> threadCounts;
+
+	for(int i = 1; i < maxThreads; i *= 2)
+		threadCounts.push_back(i);
+
+	threadCounts.push_back(maxThreads);
+
+	vector<float> collisionTimes;
+	vector<float> constraintTimes;
+	vector<unsigned int> hashes;
+
+	// Sleeping is disabled so every update solves the whole scene
+	world_.getPhysicsEngine().setAllowSleeping(false);
+
+	for(int numThreads : threadCounts){
+
+		printf("%sBenchmark: %d bodies, %d updates, %d threads\n", numThreads == 1 ? "" : "\n", numBodies, numUpdates, numThreads);
+
+		world_.getPhysicsEngine().setNumThreads(numThreads);
+
+		createScene(numBodies);
+		run(numUpdates);
+		report(csvPath.empty() ? csvPath : csvPath + ".t" + std::to_string(numThreads) + ".csv");
+
+		float collisionTime = 0;
+		float constraintTime = 0;
+
+		for(const PhysicsTimings& t : timings_){
+			collisionTime += t.collisions;
+			constraintTime += t.constraints;
+		}
+
+		collisionTimes.push_back(collisionTime / timings_.size());
+		constraintTimes.push_back(constraintTime / timings_.size());
+		hashes.push_back(getStateHash());
+
+		world_.unload();
+	}
+
+
+	// Compare each thread count to the serial run
+	printf("\n%-8s %16s %8s %16s %8s %12s\n", "Threads", "Collisions (us)", "Speedup", "Constraints (us)", "Speedup", "State hash");
+
+	bool identical = true;
+
+	for(int i = 0; i < (int)threadCounts.size(); i++){
+		printf("%-8d %16.1f %7.2fx %16.1f %7.2fx %12x\n", threadCounts[i],
+			collisionTimes[i], collisionTimes[0] / collisionTimes[i],
+			constraintTimes[i], constraintTimes[0] / constraintTimes[i], hashes[i]);
+
+		if(hashes[i] != hashes[0])
+			identical = false;
+	}
+
+	printf("Results identical to serial run: %s\n", identical ? "yes" : "no");
+}
+
+void Benchmark::runNarrowphase(int numRounds, int numPairs){
+
+	printf("Narrowphase benchmark: %d pairs per hull, %d rounds\n", numPairs, numRounds);
+	printf("%-14s %8s %8s %12s %12s %14s %10s\n", "Hull", "Vertices", "Overlap", "SAT (us)", "GJK (us)", "GJK warm (us)", "Agreement");
+
+	// Hulls built by the model generators
+	struct NarrowphaseHull{
+		const char* name;
+		Model model;
+	};
+
+	vector<NarrowphaseHull> hulls = {
+		{"Cube",			ntw::getCube()},
+		{"Sphere 8x8",		ntw::getSphere(8, 8)},
+		{"Sphere 16x16",	ntw::getSphere(16, 16)},
+		{"Sphere 24x24",	ntw::getSphere(24, 24)},
+		{"Capsule 16x16",	ntw::getCapsule(16, 16, 1)},
+	};
+
+	// Fixed seed so every run tests the same pairs
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0, 1);
+
+	for(NarrowphaseHull& hull : hulls){
+
+		ntw::setModelProperties(&hull.model);
+
+		// Pairs placed from deep overlap to just apart at random orientations
+		vector<Object*> objects;
+
+		for(int i = 0; i < numPairs * 2; i++){
+			Object* object = new Object(world_, &hull.model, nullptr);
+			object->setRotation(unit(random) * 360, unit(random) * 360, unit(random) * 360);
+
+			if(i % 2 == 1){
+				float distance = objects.back()->getColliders()[0].boundRadius * 2 * (0.3f + unit(random) * 0.8f);
+				object->setPosition(Vec3(unit(random) * 360, unit(random) * 180 - 90) * distance);
+			}
+
+			object->cacheColliderTransform();
+			objects.push_back(object);
+		}
+
+		// Result of each pair, depth is zero without collision
+		vector<float> satDepths(numPairs);
+		vector<float> gjkDepths(numPairs);
+		vector<GJKSimplex> simplices(numPairs);
+		vector<int> supportVertices(numPairs * 2, 0);
+
+		SATBuffers satBuffers;
+		GJKBuffers gjkBuffers;
+
+		auto l_collider = [&objects](int pair, int object) -> const Collider* {
+			return &objects[pair * 2 + object]->getColliders()[0];
+		};
+
+		// Time every pair for a number of rounds, including contact generation
+		auto l_time = [&](auto l_test) -> float {
+			auto t1 = currentTime;
+
+			for(int round = 0; round < numRounds; round++)
+				for(int i = 0; i < numPairs; i++)
+					l_test(i);
+
+			return timeBetweenPrecise(t1, currentTime) / (numRounds * numPairs);
+		};
+
+		float satTime = l_time([&](int i){
+			SATCollision test(l_collider(i, 0), l_collider(i, 1), satBuffers);
+			satDepths[i] = test.testCollision() ? test.getContactPoints().maxDistance : 0;
+		});
+
+		float gjkTime = l_time([&](int i){
+			GJKCollision test(l_collider(i, 0), l_collider(i, 1), gjkBuffers);
+			gjkDepths[i] = test.testCollision() ? test.getContactPoints().maxDistance : 0;
+		});
+
+		// Start each test from the simplex and support vertices of the pair's previous test
+		float gjkWarmTime = l_time([&](int i){
+			GJKCollision test(l_collider(i, 0), l_collider(i, 1), gjkBuffers);
+			test.setSimplex(simplices[i]);
+			test.setSupportVertices(supportVertices[i * 2], supportVertices[i * 2 + 1]);
+
+			gjkDepths[i] = test.testCollision() ? test.getContactPoints().maxDistance : 0;
+
+			simplices[i] = test.getSimplex();
+			supportVertices[i * 2] = test.getSupportVertex1();
+			supportVertices[i * 2 + 1] = test.getSupportVertex2();
+		});
+
+		// Pairs where both tests agree on collision and penetration depth
+		// SAT depth can be deeper by its feature tolerance since it prefers face axes over the shallowest axis
+		int numOverlapping = 0;
+		int numAgreeing = 0;
+
+		for(int i = 0; i < numPairs; i++){
+			numOverlapping += satDepths[i] > 0;
+			numAgreeing += (satDepths[i] > 0) == (gjkDepths[i] > 0) &&
+				abs(satDepths[i] - gjkDepths[i]) <= NTW_SAT_FEATURE_TOLERANCE + NTW_EPA_TOLERANCE;
+		}
+
+		printf("%-14s %8d %7.0f%% %12.2f %12.2f %14.2f %9.1f%%\n", hull.name, (int)hull.model.colliderHitboxes[0].vertices.size(),
+			100.0f * numOverlapping / numPairs, satTime, gjkTime, gjkWarmTime, 100.0f * numAgreeing / numPairs);
+
+		for(Object* object : objects)
+			delete object;
+	}
+}
+
+void Benchmark::loadModels(){
+
+	Model* boxModel = new Model(ntw::getCube());
+	ntw::setModelProperties(boxModel);
+	models_.push_back(boxModel);
+
+	Model* sphereModel = new Model(ntw::getSphere(8, 8));
+	ntw::setModelProperties(sphereModel);
+	models_.push_back(sphereModel);
+}
+
+void Benchmark::createScene(int numBodies){
+
+	Model* boxModel		= models_[0];
+	Model* sphereModel	= models_[1];
+
+
+	// Bodies are placed in layers of a square grid, 10 layers for the default body count
+	const float spacing = 0.75f;
+	int side = max((int)ceilf(sqrtf(numBodies / 10.0f)), 1);
+
+	// Floor
+	Object* floor = new Object(world_, boxModel, nullptr);
+	floor->setPosition(0, 0, -1);
+	floor->setScale((side * spacing / 2) + 2, (side * spacing / 2) + 2, 1);
+	world_.addObject(floor);
+
+	for(int i = 0; i < numBodies; i++){
+
+		int x = i % side;
+		int y = (i / side) % side;
+		int z = i / (side * side);
+
+		// Every fifth body is a sphere
+		PhysicsObject* body = new PhysicsObject(world_, i % 5 == 4 ? sphereModel : boxModel, nullptr, 1);
+
+		// Offset alternate layers so bodies do not land squarely on each other
+		float offset = (z % 2) * spacing * 0.25f;
+
+		body->setPosition(((x - side / 2.0f) * spacing) + offset, ((y - side / 2.0f) * spacing) + offset, 0.5f + (z * spacing));
+		body->setRotation(0, 0, (float)((i * 37) % 90));
+		body->setScale(0.25f);
+		world_.addObject(body);
+	}
+}
+
+void Benchmark::createStackScene(int numBodies){
+
+	Model* boxModel = models_[0];
+
+	// Columns of boxes placed on a square grid
+	const float spacing = 1.5f;
+	const float size = 0.5f;
+	int numColumns = (numBodies + NTW_BENCH_STACK_HEIGHT - 1) / NTW_BENCH_STACK_HEIGHT;
+	int side = max((int)ceilf(sqrtf((float)numColumns)), 1);
+
+	// Floor
+	Object* floor = new Object(world_, boxModel, nullptr);
+	floor->setPosition(0, 0, -1);
+	floor->setScale((side * spacing / 2) + 2, (side * spacing / 2) + 2, 1);
+	world_.addObject(floor);
+
+	for(int i = 0; i < numBodies; i++){
+
+		int column = i / NTW_BENCH_STACK_HEIGHT;
+		int x = column % side;
+		int y = column / side;
+		int z = i % NTW_BENCH_STACK_HEIGHT;
+
+		// Small gap between boxes so the stack starts without penetration
+		PhysicsObject* body = new PhysicsObject(world_, boxModel, nullptr, 1);
+		body->setPosition((x - side / 2.0f) * spacing, (y - side / 2.0f) * spacing, (size / 2) + (z * size * 1.01f));
+		body->setScale(size / 2);
+		world_.addObject(body);
+	}
+}
+
+void Benchmark::createWallScene(int numBodies, bool continuousCollision){
+
+	Model* boxModel = models_[0];
+
+	// Rows of bodies on a square grid behind a thin wall, moving far enough each update to pass through it
+	const float spacing = 0.75f;
+	const float speed = 60;
+	int side = max((int)ceilf(sqrtf((float)numBodies)), 1);
+
+	Object* wall = new Object(world_, boxModel, nullptr);
+	wall->setPosition(0, 0, 0);
+	wall->setScale(0.05f, (side * spacing / 2) + 1, (side * spacing / 2) + 1);
+	world_.addObject(wall);
+
+	for(int i = 0; i < numBodies; i++){
+
+		int y = i % side;
+		int z = i / side;
+
+		// Bodies start at different distances so they reach the wall at different points of an update
+		PhysicsObject* body = new PhysicsObject(world_, boxModel, nullptr, 1);
+		body->setPosition(-3 - ((i * 7) % 10) * 0.1f, (y - side / 2.0f) * spacing, (z - side / 2.0f) * spacing);
+		body->setScale(0.25f);
+		body->setUseGravity(false);
+		body->setContinuousCollision(continuousCollision);
+		world_.addObject(body);
+
+		body->setVelocity(Vec3(speed, 0, 0));
+	}
+}
+
+void Benchmark::run(int numUpdates){
+
+	timings_.clear();
+	timings_.reserve(numUpdates);
+
+	for(int i = 0; i < numUpdates; i++){
+		world_.update(NTW_PHYS_TIME_DELTA, true);
+		timings_.push_back(world_.getPhysicsEngine().getTimings());
+	}
+}
+
+void Benchmark::report(const string& csvPath){
+
+	if(timings_.empty())
+		return;
+
+	struct Stat{
+		const char* name;
+		float min;
+		float max;
+		float sum;
+	};
+
+	const float maxFloat = std::numeric_limits<float>::max();
+
+	Stat stats[4] = {
+		{"Collisions",	maxFloat, 0, 0},
+		{"Constraints",	maxFloat, 0, 0},
+		{"Integration",	maxFloat, 0, 0},
+		{"Total",		maxFloat, 0, 0},
+	};
+
+	int iterations = 0;
+	int converged = 0;
+	int solved = 0;
+	int sleeping = 0;
+
+	for(const PhysicsTimings& t : timings_){
+
+		float values[4] = {t.collisions, t.constraints, t.integration, t.collisions + t.constraints + t.integration};
+
+		for(int i = 0; i < 4; i++){
+			stats[i].min = min(stats[i].min, values[i]);
+			stats[i].max = max(stats[i].max, values[i]);
+			stats[i].sum += values[i];
+		}
+
+		iterations += t.constraintIterations;
+
+		if(t.constraintIterations < NTW_PHYS_MAX_CONSTRAINT_ITER)
+			converged++;
+
+		// Updates where every body sleeps solve nothing
+		if(t.constraintIterations > 0)
+			solved++;
+
+		sleeping += t.sleepingObjects;
+	}
+
+	int n = (int)timings_.size();
+
+	printf("%-12s %12s %12s %12s\n", "Stage (us)", "Avg", "Min", "Max");
+
+	for(const Stat& s : stats)
+		printf("%-12s %12.1f %12.1f %12.1f\n", s.name, s.sum / n, s.min, s.max);
+
+	printf("Avg. constraint iterations: %.2f\n", (float)iterations / n);
+	printf("Avg. constraint iterations while awake: %.2f (%d updates)\n", solved > 0 ? (float)iterations / solved : 0.0f, solved);
+	printf("Converged before iteration limit: %.1f%%\n", 100.0f * converged / n);
+	printf("Avg. sleeping bodies: %.1f\n", (float)sleeping / n);
+	printf("Updates per second: %.1f\n", 1000000.0f * n / stats[3].sum);
+	printf("State hash: %08x\n", getStateHash());
+
+	AABBTreeQuality quality = world_.getPhysicsEngine().getTreeQuality();
+	printf("Broadphase tree: %d leaves, depth %d, internal area %.1f (%.2fx root)\n", quality.numLeaves, quality.maxDepth,
+		quality.internalArea, quality.rootArea > 0 ? quality.internalArea / quality.rootArea : 0.0f);
+	printf("Static tree: %d leaves, depth %d\n", quality.numStaticLeaves, quality.staticMaxDepth);
+
+
+	// Write timings of every update
+	if(csvPath.empty())
+		return;
+
+	std::ofstream file(csvPath);
+
+	if(!file){
+		ntw::error("Unable to write benchmark output: " + csvPath);
+		return;
+	}
+
+	file << "update,collisions,constraints,integration,iterations,sleeping\n";
+
+	for(int i = 0; i < n; i++){
+		const PhysicsTimings& t = timings_[i];
+		file << i << "," << t.collisions << "," << t.constraints << "," << t.integration << "," << t.constraintIterations << "," << t.sleepingObjects << "\n";
+	}
+}
+
+unsigned int Benchmark::getStateHash(){
+
+	// FNV-1a over the bits of each position and rotation
+	unsigned int hash = 2166136261u;
+
+	auto l_hash = [&hash](float value) -> void {
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		for(int i = 0; i < 4; i++){
+			hash ^= (bits >> (i * 8)) & 0xff;
+			hash *= 16777619u;
+		}
+	};
+
+	for(Object* obj : world_.getObjects()){
+		for(int i = 0; i < 3; i++)
+			l_hash(obj->getPosition()[i]);
+
+		for(int i = 0; i < 4; i++)
+			l_hash(obj->getRotation()[i]);
+	}
+
+	return hash;
+}
+
+void Benchmark::finish(){
+
+	world_.unload();
+
+	for(Model* m : models_)
+		delete m;
+
+	models_.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+ *	benchmark.h
+ *
+ *	Headless physics benchmark. Steps a world for a fixed number of updates
+ *	without a window, OpenGL context, or sound device and reports timings.
+ *
+ *	The stack scene is run without and with warm starting, then with the block
+ *	solver, to compare how many constraint iterations resting contacts need to converge.
+ *	Warm started stacks two boxes high converge in about 3 iterations, taller stacks
+ *	still reach NTW_PHYS_MAX_CONSTRAINT_ITER while awake.
+ *
+ *	The thread scaling run repeats the scene with an increasing number of
+ *	physics threads, and checks that every run ends in the same state.
+ *
+ *	The batch run repeats the scene without and with batch solving of contacts.
+ *
+ *	The continuous collision run fires bodies at a thin wall without and with
+ *	continuous collision, and counts how many pass through it.
+ *
+ *	The narrowphase run times SAT and GJK tests on pairs of each hull built
+ *	by the model generators, and checks that both find the same collisions.
+ *
+ */
+
+class Benchmark;
+
+#include"options.h"
+#include"window.h"
+#include"resourceCache.h"
+#include"graphics/renderer.h"
+#include"sound/soundEngine.h"
+#include"world.h"
+#include<vector>
+#include<string>
+
+using std::vector;
+using std::string;
+
+
+// Default number of physics updates to run
+#define NTW_BENCH_DEFAULT_UPDATES	600
+
+// Default number of rigid bodies in the benchmark scene
+#define NTW_BENCH_DEFAULT_BODIES	1000
+
+// Number of boxes in each column of the stack scene
+#define NTW_BENCH_STACK_HEIGHT		10
+
+// Default number of object pairs per hull and rounds of tests over them in the narrowphase run
+#define NTW_BENCH_NARROWPHASE_PAIRS		200
+#define NTW_BENCH_NARROWPHASE_ROUNDS	20
+
+
+class Benchmark{
+
+	Options options_;
+
+	// Never initialized, only required to construct the world
+	Window window_;
+	ResourceCache resCache_;
+	Renderer renderer_;
+	SoundEngine soundEngine_;
+
+	World world_;
+
+	vector<Model*> models_;
+
+	// Timings of every update
+	vector<PhysicsTimings> timings_;
+
+
+	void loadModels();
+	void createScene(int numBodies);
+	void createStackScene(int numBodies);
+	void createWallScene(int numBodies, bool continuousCollision);
+
+	void runThreadScaling(int numUpdates, int numBodies, const string& csvPath);
+	void runNarrowphase(int numRounds, int numPairs);
+
+	void run(int numUpdates);
+	void report(const string& csvPath);
+
+	// Hash of all physics object positions and rotations, for checking determinism
+	unsigned int getStateHash();
+
+	void finish();
+
+public:
+	Benchmark();
+
+	void start(int argc, char** argv);
+};
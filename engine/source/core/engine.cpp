@@ -1,15 +1,12 @@
 #include"engine.h"
 
 #include"physics/physDefine.h"
+#include"core/timing.h"
 #include<iostream>
-#include<chrono>
 #include<thread>
 #include<vector>
 #include<algorithm>
 
-#define currentTime std::chrono::high_resolution_clock::now()
-#define timeBetween(t1, t2) (int)std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
-
 
 Engine::Engine() : window_(options_), game_(options_, window_) {
 
@@ -0,0 +1,120 @@
+#include"threadPool.h"
+
+
+ThreadPool::ThreadPool(int numThreads) : task_(nullptr), numTasks_(0), nextTask_(0), numWorking_(0),
+	generation_(0), stopping_(false) {
+
+	startWorkers(numThreads);
+}
+
+ThreadPool::~ThreadPool(){
+	stopWorkers();
+}
+
+void ThreadPool::run(int numTasks, const std::function<void(int)>& task){
+
+	if(numTasks <= 0)
+		return;
+
+	// Nothing to run in parallel
+	if(workers_.empty() || numTasks == 1){
+		for(int i = 0; i < numTasks; i++)
+			task(i);
+
+		return;
+	}
+
+	// Start job on workers
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		task_ = &task;
+		numTasks_ = numTasks;
+		nextTask_ = 0;
+		numWorking_ = (int)workers_.size();
+		generation_++;
+	}
+
+	startCondition_.notify_all();
+
+	// Take tasks on this thread as well
+	runTasks();
+
+	// Wait for workers to finish their last task
+	std::unique_lock<std::mutex> lock(mutex_);
+	doneCondition_.wait(lock, [this]{ return numWorking_ == 0; });
+
+	task_ = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned int generation){
+
+	while(true){
+
+		// Wait for next job
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			startCondition_.wait(lock, [this, generation]{ return stopping_ || generation_ != generation; });
+
+			if(stopping_)
+				return;
+
+			generation = generation_;
+		}
+
+		runTasks();
+
+		// Last worker to finish wakes the calling thread
+		bool done;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			done = --numWorking_ == 0;
+		}
+
+		if(done)
+			doneCondition_.notify_one();
+	}
+}
+
+void ThreadPool::runTasks(){
+
+	// Take task indices until none are left
+	for(int i = nextTask_++; i < numTasks_; i = nextTask_++)
+		(*task_)(i);
+}
+
+void ThreadPool::startWorkers(int numThreads){
+
+	if(numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+
+	// Calling thread counts as one thread
+	for(int i = 1; i < numThreads; i++)
+		workers_.emplace_back(&ThreadPool::workerLoop, this, generation_);
+}
+
+void ThreadPool::stopWorkers(){
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+
+	startCondition_.notify_all();
+
+	for(std::thread& t : workers_)
+		t.join();
+
+	workers_.clear();
+	stopping_ = false;
+}
+
+void ThreadPool::setNumThreads(int numThreads){
+	stopWorkers();
+	startWorkers(numThreads);
+}
+
+int ThreadPool::getNumThreads() const{
+	return (int)workers_.size() + 1;
+}
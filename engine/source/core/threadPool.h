@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ *	threadPool.h
+ *
+ *	Fixed-size pool of worker threads for running independent tasks in parallel.
+ *	The calling thread also takes tasks, so a pool of one thread runs everything serially.
+ *
+ */
+
+class ThreadPool;
+
+#include<vector>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<functional>
+
+using std::vector;
+
+
+class ThreadPool{
+
+	vector<std::thread> workers_;
+
+	std::mutex mutex_;
+	std::condition_variable startCondition_;
+	std::condition_variable doneCondition_;
+
+	// Current job
+	const std::function<void(int)>* task_;
+	int numTasks_;
+	std::atomic<int> nextTask_;
+
+	// Workers that have not finished the current job
+	int numWorking_;
+
+	// Incremented for every job so workers only start each job once
+	unsigned int generation_;
+
+	bool stopping_;
+
+
+	void workerLoop(unsigned int generation);
+	void runTasks();
+
+	void startWorkers(int numThreads);
+	void stopWorkers();
+
+public:
+	// Number of threads including the calling thread, 0 to use one per hardware thread
+	ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Call task for every index from 0 to numTasks - 1 and wait until all calls have returned
+	// Tasks may run in any order and on any thread
+	void run(int numTasks, const std::function<void(int)>& task);
+
+	void setNumThreads(int numThreads);
+	int getNumThreads() const;
+};
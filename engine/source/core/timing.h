@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+ *	timing.h
+ *
+ *	Time measurement macros for the game loop and profiling.
+ *
+ */
+
+#include<chrono>
+
+#define currentTime std::chrono::high_resolution_clock::now()
+#define timeBetween(t1, t2) (int)std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count()
+
+// Fractional microseconds, for timing short sections of code
+#define timeBetweenPrecise(t1, t2) std::chrono::duration<float, std::micro>(t2 - t1).count()
@@ -7,7 +7,7 @@ using ntw::setModelProperties;
 
 World::World(Options& options, ResourceCache& resCache, Window& window, Renderer& renderer, SoundEngine& soundEngine) :
 	options_(options), resCache_(resCache), window_(window), renderer_(renderer), soundEngine_(soundEngine),
-	physicsEngine_(*this, objects_, physicsObjects_), initialized_(false) {
+	physicsEngine_(*this, objects_, physicsObjects_), initialized_(false), player_(nullptr) {
 
 }
 
@@ -151,10 +151,11 @@ void World::test(){
 		Vec3 f3 = Vec3(0, 0, (-pHeight / 2) - (frameScale / 2));
 		Vec3 f4 = Vec3(0, 0, (pHeight / 2) + (frameScale / 2));
 
-		f1 = Matrix(3, 3, true).rotate(rotation) * f1;
-		f2 = Matrix(3, 3, true).rotate(rotation) * f2;
-		f3 = Matrix(3, 3, true).rotate(rotation) * f3;
-		f4 = Matrix(3, 3, true).rotate(rotation) * f4;
+		Mat3 rotationMatrix = Mat3(rotation);
+		f1 = rotationMatrix * f1;
+		f2 = rotationMatrix * f2;
+		f3 = rotationMatrix * f3;
+		f4 = rotationMatrix * f4;
 
 		Object* portalFrame = new Object(*this, testModel, blankMaterial);
 		portalFrame->setPosition(pos + f1);
@@ -232,7 +233,8 @@ void World::test(){
 void World::update(float timeDelta, bool updatePhysics){
 	
 	// Update player movement
-	player_->updatePlayer(timeDelta, updatePhysics);
+	if(player_)
+		player_->updatePlayer(timeDelta, updatePhysics);
 
 	// Update all objects
 	for(Object* obj : objects_)
@@ -242,6 +244,9 @@ void World::update(float timeDelta, bool updatePhysics){
 	if(updatePhysics)
 		physicsEngine_.update();
 
+	// Headless worlds have no player, listener and camera are not updated
+	if(!player_)
+		return;
 
 	// Set sound listener and orientation to player's
 	soundEngine_.setListenerPosition(player_->getPosition());
@@ -1,7 +1,7 @@
 #pragma once
 
 #include"math/vec3.h"
-#include"math/matrix.h"
+#include"math/mat3.h"
 
 
 struct Camera{
@@ -10,5 +10,5 @@ struct Camera{
 	float yaw;
 	float pitch;
 	float roll;
-	Matrix rotationMatrix;
+	Mat3 rotationMatrix;
 };
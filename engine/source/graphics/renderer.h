@@ -16,7 +16,7 @@ class Renderer;
 #include"objects/material.h"
 #include"objects/portal.h"
 #include"core/world.h"
-#include"math/matrix.h"
+#include"math/mat4.h"
 #include<unordered_map>
 
 using std::unordered_map;
@@ -75,7 +75,7 @@ class Renderer{
 
 
 	// Identity model matrix, do not change
-	const Matrix identity_;
+	const Mat4 identity_;
 
 
 	// Current rendered world
@@ -107,15 +107,15 @@ class Renderer{
 
 	void addPortalBatch(Portal* portal);
 
-	void setViewProj(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly);
-	void setViewProj(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly, Vec3 clipPlaneNormal, float clipPlaneDistance);
-	void setViewProjSub(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly);
+	void setViewProj(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly);
+	void setViewProj(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly, Vec3 clipPlaneNormal, float clipPlaneDistance);
+	void setViewProjSub(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly);
 
 	// Render world, then portals, recursively
 	void renderWorld(int time, float physTimeDelta, int iterations);
 
 	// Render all world elements except for portals
-	void renderWorldSub(const Camera& camera, const Matrix& viewProj, const Matrix& viewProjRotOnly, int time, float physTimeDelta);
+	void renderWorldSub(const Camera& camera, const Mat4& viewProj, const Mat4& viewProjRotOnly, int time, float physTimeDelta);
 
 public:
 	Renderer(GraphicsOptions& gOptions);
@@ -206,7 +206,7 @@ void Renderer::addPortalBatch(Portal* portal){
 
 	// Portal transformations
 	Vec3 size = Vec3(portal->getWidth() / 2, NTW_NEAR_CLIP * 2, portal->getHeight() / 2);
-	Matrix rotation = Matrix(3, 3, true).rotate(portal->getRotation());
+	Mat3 rotation = Mat3(portal->getRotation());
 
 
 	// Add vertices
@@ -296,35 +296,35 @@ void Renderer::cleanupWorldRendering(){
 	glDeleteFramebuffers(1, &fbWorldPortal_.id);
 }
 
-void Renderer::setViewProj(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly){
+void Renderer::setViewProj(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly){
 
 	setViewProjSub(camera, viewProj, viewProjRotOnly);
 
 	// Apply projection matrix
-	Matrix proj = Matrix::projectionMatrix((float)gOptions_.fov, (float)gOptions_.resolutionX / gOptions_.resolutionY, NTW_NEAR_CLIP, NTW_FAR_CLIP);
+	Mat4 proj = Mat4::projectionMatrix((float)gOptions_.fov, (float)gOptions_.resolutionX / gOptions_.resolutionY, NTW_NEAR_CLIP, NTW_FAR_CLIP);
 
 	viewProj *= proj;
 	viewProjRotOnly *= proj;
 }
 
-void Renderer::setViewProj(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly, Vec3 clipPlaneNormal, float clipPlaneDistance){
+void Renderer::setViewProj(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly, Vec3 clipPlaneNormal, float clipPlaneDistance){
 
 	setViewProjSub(camera, viewProj, viewProjRotOnly);
 
 	// Apply projection matrix with oblique near clipping plane
-	Matrix proj = Matrix::projectionMatrix((float)gOptions_.fov, (float)gOptions_.resolutionX / gOptions_.resolutionY, NTW_FAR_CLIP, clipPlaneNormal, clipPlaneDistance);
+	Mat4 proj = Mat4::projectionMatrix((float)gOptions_.fov, (float)gOptions_.resolutionX / gOptions_.resolutionY, NTW_FAR_CLIP, clipPlaneNormal, clipPlaneDistance);
 
 	viewProj *= proj;
 	viewProjRotOnly *= proj;
 }
 
-void Renderer::setViewProjSub(const Camera& camera, Matrix& viewProj, Matrix& viewProjRotOnly){
+void Renderer::setViewProjSub(const Camera& camera, Mat4& viewProj, Mat4& viewProjRotOnly){
 
 	// View location, swap y and z axes and negate y
 	viewProj.translate(-camera.position[0], -camera.position[1], -camera.position[2]);
 
 	// Initial orientation
-	viewProj = camera.rotationMatrix * viewProj;
+	viewProj = Mat4(camera.rotationMatrix) * viewProj;
 
 	// Rotation
 	viewProj.rotate(-90, 90 - camera.yaw, 0);
@@ -370,8 +370,8 @@ void Renderer::renderWorld(int time, float physTimeDelta){
 	}
 
 
-	Matrix viewProj;
-	Matrix viewProjRotOnly;
+	Mat4 viewProj;
+	Mat4 viewProjRotOnly;
 	setViewProj(camera, viewProj, viewProjRotOnly);
 
 	renderWorldSub(camera, viewProj, viewProjRotOnly, time, physTimeDelta);
@@ -398,18 +398,17 @@ void Renderer::renderWorld(int time, float physTimeDelta){
 		for(const Vec3& vertex : verts){
 
 			// Get vertex and apply projection
-			Matrix v = Matrix(1, 4);
-			v.set(0, 0, vertex[0]);
-			v.set(0, 1, vertex[1]);
-			v.set(0, 2, vertex[2]);
-			v.set(0, 3, 1);
-			v *= viewProj;
+			// Vertex is a row vector with w = 1
+			float v[4];
+
+			for(int c = 0; c < 4; c++)
+				v[c] = vertex[0] * viewProj.get(0, c) + vertex[1] * viewProj.get(1, c) + vertex[2] * viewProj.get(2, c) + viewProj.get(3, c);
 
 			// Normalize
-			float w = v.get(0, 3);
-			float xw = v.get(0, 0) / w;
-			float yw = v.get(0, 1) / w;
-			float zw = v.get(0, 2) / w;
+			float w = v[3];
+			float xw = v[0] / w;
+			float yw = v[1] / w;
+			float zw = v[2] / w;
 
 			// Check vertex visibility
 			if(	xw >= -1 && xw <= 1 &&
@@ -461,7 +460,7 @@ void Renderer::renderWorld(int time, float physTimeDelta){
 		Vec3 planeNormal = portal->getNormal();
 
 		// Rotate portal plane into camera space
-		Matrix cameraRotation = camera.rotationMatrix;
+		Mat3 cameraRotation = camera.rotationMatrix;
 		cameraRotation.rotate(-90, 90 - camera.yaw, 0);
 		cameraRotation.rotate(-camera.pitch, 0, 0);
 		//cameraRotation.rotate(0, 0, -portalCamera.roll);
@@ -473,8 +472,8 @@ void Renderer::renderWorld(int time, float physTimeDelta){
 		distance = distance < NTW_NEAR_CLIP * 2 ? NTW_NEAR_CLIP * 2 : distance;
 
 		// Get clipped viewProj matrix
-		Matrix viewProjPortal;
-		Matrix viewProjRotOnlyPortal;
+		Mat4 viewProjPortal;
+		Mat4 viewProjRotOnlyPortal;
 		setViewProj(portalCamera, viewProjPortal, viewProjRotOnlyPortal, -planeNormal, -distance);
 
 
@@ -529,7 +528,7 @@ void Renderer::renderWorld(int time, float physTimeDelta){
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void Renderer::renderWorldSub(const Camera& camera, const Matrix& viewProj, const Matrix& viewProjRotOnly, int time, float physTimeDelta){
+void Renderer::renderWorldSub(const Camera& camera, const Mat4& viewProj, const Mat4& viewProjRotOnly, int time, float physTimeDelta){
 
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
@@ -575,7 +574,7 @@ void Renderer::renderWorldSub(const Camera& camera, const Matrix& viewProj, cons
 						rotation.rotate(angularVelocity, angVelMag * physTimeDelta);
 				}
 
-				Matrix model;
+				Mat4 model;
 				model.scale(obj->getScale());
 				model.rotate(rotation);
 				model.translate(position);
@@ -1,6 +1,15 @@
+#ifdef __NTW_BENCHMARK__
+#include"core/benchmark.h"
+
+int main(int argc, char** argv){
+	Benchmark b;
+	b.start(argc, argv);
+}
+#else
 #include"core/engine.h"
 
 int main(){
 	Engine e;
 	e.start();
 }
+#endif
@@ -0,0 +1,124 @@
+#include"mat3.h"
+
+#include"math/quaternion.h"
+#include"math/mathFunc.h"
+
+using ntw::toRadians;
+
+
+// Rotation matrix from quaternion
+Mat3::Mat3(const Quaternion& q){
+
+	float x = q[0];
+	float y = q[1];
+	float z = q[2];
+	float w = q[3];
+	float x2 = 2 * x * x;
+	float y2 = 2 * y * y;
+	float z2 = 2 * z * z;
+
+	values_[0] = 1 - y2 - z2;
+	values_[1] = 2 * (x * y - w * z);
+	values_[2] = 2 * (x * z + w * y);
+
+	values_[3] = 2 * (x * y + w * z);
+	values_[4] = 1 - x2 - z2;
+	values_[5] = 2 * (y * z - w * x);
+
+	values_[6] = 2 * (x * z - w * y);
+	values_[7] = 2 * (y * z + w * x);
+	values_[8] = 1 - x2 - y2;
+}
+
+bool operator==(const Mat3& a, const Mat3& b){
+
+	for(int i = 0; i < 9; i++)
+		if(a.values_[i] != b.values_[i])
+			return false;
+
+	return true;
+}
+
+bool operator!=(const Mat3& a, const Mat3& b){
+	return !(a == b);
+}
+
+
+Mat3& Mat3::scale(float x, float y, float z){
+	return *this = Mat3(
+		x, 0, 0,
+		0, y, 0,
+		0, 0, z
+	) * *this;
+}
+
+Mat3& Mat3::scale(const Vec3& v){
+	return scale(v[0], v[1], v[2]);
+}
+
+Mat3& Mat3::rotate(const Quaternion& q){
+	return *this = Mat3(q) * *this;
+}
+
+Mat3& Mat3::rotate(Vec3 axis, float ang, bool degrees){
+
+	ang = degrees ? toRadians(ang) : ang;
+
+	float c = cosf(ang);
+	float s = sinf(ang);
+
+	axis.normalize();
+	Vec3 tmp = (1 - c) * axis;
+
+	return *this = Mat3(
+		c + tmp[0] * axis[0],			tmp[0] * axis[1] + s * axis[2],	tmp[0] * axis[2] - s * axis[1],
+		tmp[1] * axis[0] - s * axis[2],	c + tmp[1] * axis[1],			tmp[1] * axis[2] + s * axis[0],
+		tmp[2] * axis[0] + s * axis[1],	tmp[2] * axis[1] - s * axis[0],	c + tmp[2] * axis[2]
+	) * *this;
+}
+
+Mat3& Mat3::rotate(float x, float y, float z, bool degrees){
+
+	float ax = degrees ? toRadians(x) : x;
+	float ay = degrees ? toRadians(y) : y;
+	float az = degrees ? toRadians(z) : z;
+
+	float cx = cosf(ax);
+	float sx = sinf(ax);
+
+	float cy = cosf(ay);
+	float sy = sinf(ay);
+
+	float cz = cosf(az);
+	float sz = sinf(az);
+
+	return *this = Mat3(
+		cy * cz,	(-cx * sz) + (sx * sy * cz),	(sx * sz) + (cx * sy * cz),
+		cy * sz,	(cx * cz) + (sx * sy * sz),		(-sx * cz) + (cx * sy * sz),
+		-sy,		sx * cy,						cx * cy
+	) * *this;
+}
+
+
+Mat3 Mat3::getInverse() const{
+
+	// Adjugate matrix (transposed cofactors)
+	Mat3 adj(
+		get(1, 1) * get(2, 2) - get(1, 2) * get(2, 1),
+		get(0, 2) * get(2, 1) - get(0, 1) * get(2, 2),
+		get(0, 1) * get(1, 2) - get(0, 2) * get(1, 1),
+
+		get(1, 2) * get(2, 0) - get(1, 0) * get(2, 2),
+		get(0, 0) * get(2, 2) - get(0, 2) * get(2, 0),
+		get(0, 2) * get(1, 0) - get(0, 0) * get(1, 2),
+
+		get(1, 0) * get(2, 1) - get(1, 1) * get(2, 0),
+		get(0, 1) * get(2, 0) - get(0, 0) * get(2, 1),
+		get(0, 0) * get(1, 1) - get(0, 1) * get(1, 0)
+	);
+
+	// Determinant
+	float det = get(0, 0) * adj.get(0, 0) + get(0, 1) * adj.get(1, 0) + get(0, 2) * adj.get(2, 0);
+
+	return adj / det;
+}
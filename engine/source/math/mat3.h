@@ -0,0 +1,156 @@
+#pragma once
+
+/*
+ *	mat3.h
+ *
+ *	Fixed size 3x3 matrix stored by value.
+ *	Used for rotations and inertia tensors on physics hot paths.
+ *
+ */
+
+class Mat3;
+
+#include"math/vec3.h"
+
+class Quaternion;
+
+
+class Mat3{
+
+	// Row-major values
+	float values_[9];
+
+public:
+	// Initialize to identity matrix
+	constexpr Mat3() : values_{
+		1, 0, 0,
+		0, 1, 0,
+		0, 0, 1
+	} {}
+
+	// Initialize to given values (row-major)
+	constexpr Mat3(
+		float v00, float v01, float v02,
+		float v10, float v11, float v12,
+		float v20, float v21, float v22) : values_{
+		v00, v01, v02,
+		v10, v11, v12,
+		v20, v21, v22
+	} {}
+
+	// Rotation matrix from quaternion
+	explicit Mat3(const Quaternion& q);
+
+	static constexpr Mat3 identity(){
+		return Mat3();
+	}
+
+	static constexpr Mat3 zero(){
+		return Mat3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+	}
+
+
+	friend Mat3 operator*(const Mat3& a, const Mat3& b){
+		Mat3 result = zero();
+
+		for(int i = 0; i < 3; i++)
+			for(int k = 0; k < 3; k++){
+				float aik = a.values_[i * 3 + k];
+
+				for(int j = 0; j < 3; j++)
+					result.values_[i * 3 + j] += aik * b.values_[k * 3 + j];
+			}
+
+		return result;
+	}
+
+	friend Vec3 operator*(const Mat3& a, const Vec3& b){
+		float x = b[0];
+		float y = b[1];
+		float z = b[2];
+
+		return Vec3(
+			a.values_[0] * x + a.values_[1] * y + a.values_[2] * z,
+			a.values_[3] * x + a.values_[4] * y + a.values_[5] * z,
+			a.values_[6] * x + a.values_[7] * y + a.values_[8] * z
+		);
+	}
+
+	friend Mat3 operator*(const Mat3& a, float b){
+		Mat3 result = a;
+
+		for(int i = 0; i < 9; i++)
+			result.values_[i] *= b;
+
+		return result;
+	}
+
+	friend Mat3 operator/(const Mat3& a, float b){
+		return a * (1 / b);
+	}
+
+	friend Mat3 operator+(const Mat3& a, const Mat3& b){
+		Mat3 result = a;
+
+		for(int i = 0; i < 9; i++)
+			result.values_[i] += b.values_[i];
+
+		return result;
+	}
+
+	friend Mat3 operator-(const Mat3& a, const Mat3& b){
+		Mat3 result = a;
+
+		for(int i = 0; i < 9; i++)
+			result.values_[i] -= b.values_[i];
+
+		return result;
+	}
+
+	friend bool operator==(const Mat3& a, const Mat3& b);
+	friend bool operator!=(const Mat3& a, const Mat3& b);
+
+	Mat3& operator*=(const Mat3& a){
+		return *this = *this * a;
+	}
+
+	Mat3& operator*=(float a){
+		return *this = *this * a;
+	}
+
+
+	Mat3& scale(float x, float y, float z);
+	Mat3& scale(const Vec3& v);
+
+	Mat3& rotate(const Quaternion& q);
+	Mat3& rotate(Vec3 axis, float ang, bool degrees = false);
+	Mat3& rotate(float x, float y, float z, bool degrees = true);
+
+
+	void transpose(){
+		*this = getTranspose();
+	}
+
+	Mat3 getTranspose() const{
+		return Mat3(
+			values_[0], values_[3], values_[6],
+			values_[1], values_[4], values_[7],
+			values_[2], values_[5], values_[8]
+		);
+	}
+
+	Mat3 getInverse() const;
+
+
+	const float* getValuesPtr() const{
+		return values_;
+	}
+
+	float get(int row, int col) const{
+		return values_[row * 3 + col];
+	}
+
+	void set(int row, int col, float value){
+		values_[row * 3 + col] = value;
+	}
+};
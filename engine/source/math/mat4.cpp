@@ -0,0 +1,108 @@
+#include"mat4.h"
+
+#include"math/quaternion.h"
+#include"math/mathFunc.h"
+
+using ntw::toRadians;
+
+
+// Projection matrix
+Mat4 Mat4::projectionMatrix(float fovy, float aspect, float zNear, float zFar){
+
+	float f = 1 / tanf(toRadians(fovy) / 2);
+	float zr = zNear - zFar;
+
+	return Mat4(
+		f / aspect,	0,	0,	0,
+		0,			f,	0,	0,
+		0,			0,	(zFar + zNear) / zr,		-1,
+		0,			0,	(2 * zFar * zNear) / zr,	0
+	);
+}
+
+// Projection matrix with oblique near clipping plane
+Mat4 Mat4::projectionMatrix(float fovy, float aspect, float zFar, const Vec3& normal, float dist){
+
+	Mat4 proj = projectionMatrix(fovy, aspect, dist, zFar);
+
+	auto l_sign = [](float val) -> int {
+		return val == 0 ? 0 : val > 0 ? 1 : -1;
+	};
+
+	float cx = normal[0];
+	float cy = normal[1];
+	float cz = normal[2];
+	float cw = dist;
+
+	float qx = (l_sign(cx) + proj.get(2, 0)) / proj.get(0, 0);
+	float qy = (l_sign(cy) + proj.get(2, 1)) / proj.get(1, 1);
+	float qz = -1;
+	float qw = 1 / zFar;
+
+	float fac = 2 / ((cx * qx) + (cy * qy) + (cz * qz) + (cw * qw));
+
+	proj.set(0, 2, fac * cx);
+	proj.set(1, 2, fac * cy);
+	proj.set(2, 2, fac * cz + 1);
+	proj.set(3, 2, fac * cw);
+
+	return proj;
+}
+
+bool operator==(const Mat4& a, const Mat4& b){
+
+	for(int i = 0; i < 16; i++)
+		if(a.values_[i] != b.values_[i])
+			return false;
+
+	return true;
+}
+
+bool operator!=(const Mat4& a, const Mat4& b){
+	return !(a == b);
+}
+
+
+Mat4& Mat4::translate(float x, float y, float z){
+
+	// Add bottom row scaled by translation to the other rows
+	for(int c = 0; c < 4; c++){
+		float w = values_[12 + c];
+		values_[c]		+= x * w;
+		values_[4 + c]	+= y * w;
+		values_[8 + c]	+= z * w;
+	}
+
+	return *this;
+}
+
+Mat4& Mat4::translate(const Vec3& v){
+	return translate(v[0], v[1], v[2]);
+}
+
+Mat4& Mat4::scale(float x, float y, float z){
+
+	for(int c = 0; c < 4; c++){
+		values_[c]		*= x;
+		values_[4 + c]	*= y;
+		values_[8 + c]	*= z;
+	}
+
+	return *this;
+}
+
+Mat4& Mat4::scale(const Vec3& v){
+	return scale(v[0], v[1], v[2]);
+}
+
+Mat4& Mat4::rotate(const Quaternion& q){
+	return *this = Mat4(Mat3(q)) * *this;
+}
+
+Mat4& Mat4::rotate(Vec3 axis, float ang, bool degrees){
+	return *this = Mat4(Mat3().rotate(axis, ang, degrees)) * *this;
+}
+
+Mat4& Mat4::rotate(float x, float y, float z, bool degrees){
+	return *this = Mat4(Mat3().rotate(x, y, z, degrees)) * *this;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+/*
+ *	mat4.h
+ *
+ *	Fixed size 4x4 matrix stored by value.
+ *	Used for transformations, same memory layout as Matrix for uploading to shaders.
+ *
+ */
+
+class Mat4;
+
+#include"math/vec3.h"
+#include"math/mat3.h"
+
+class Quaternion;
+
+
+class Mat4{
+
+	// Row-major values
+	float values_[16];
+
+public:
+	// Initialize to identity matrix
+	constexpr Mat4() : values_{
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	} {}
+
+	// Initialize to given values (row-major)
+	constexpr Mat4(
+		float v00, float v01, float v02, float v03,
+		float v10, float v11, float v12, float v13,
+		float v20, float v21, float v22, float v23,
+		float v30, float v31, float v32, float v33) : values_{
+		v00, v01, v02, v03,
+		v10, v11, v12, v13,
+		v20, v21, v22, v23,
+		v30, v31, v32, v33
+	} {}
+
+	// Initialize to 3x3 matrix with no translation
+	explicit Mat4(const Mat3& m) : values_{
+		m.get(0, 0), m.get(0, 1), m.get(0, 2), 0,
+		m.get(1, 0), m.get(1, 1), m.get(1, 2), 0,
+		m.get(2, 0), m.get(2, 1), m.get(2, 2), 0,
+		0, 0, 0, 1
+	} {}
+
+	static constexpr Mat4 identity(){
+		return Mat4();
+	}
+
+	// Create projection matrix
+	static Mat4 projectionMatrix(float fovy, float aspect, float zNear, float zFar);
+	static Mat4 projectionMatrix(float fovy, float aspect, float zFar, const Vec3& normal, float dist);
+
+
+	friend Mat4 operator*(const Mat4& a, const Mat4& b){
+		Mat4 result(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+		for(int i = 0; i < 4; i++)
+			for(int k = 0; k < 4; k++){
+				float aik = a.values_[i * 4 + k];
+
+				for(int j = 0; j < 4; j++)
+					result.values_[i * 4 + j] += aik * b.values_[k * 4 + j];
+			}
+
+		return result;
+	}
+
+	// Transform point (implicit w of 1)
+	friend Vec3 operator*(const Mat4& a, const Vec3& b){
+		float x = b[0];
+		float y = b[1];
+		float z = b[2];
+
+		return Vec3(
+			a.values_[0] * x + a.values_[1] * y + a.values_[2] * z + a.values_[3],
+			a.values_[4] * x + a.values_[5] * y + a.values_[6] * z + a.values_[7],
+			a.values_[8] * x + a.values_[9] * y + a.values_[10] * z + a.values_[11]
+		);
+	}
+
+	friend bool operator==(const Mat4& a, const Mat4& b);
+	friend bool operator!=(const Mat4& a, const Mat4& b);
+
+	Mat4& operator*=(const Mat4& a){
+		return *this = *this * a;
+	}
+
+
+	Mat4& translate(float x, float y, float z);
+	Mat4& translate(const Vec3& v);
+
+	Mat4& scale(float x, float y, float z);
+	Mat4& scale(const Vec3& v);
+
+	Mat4& rotate(const Quaternion& q);
+	Mat4& rotate(Vec3 axis, float ang, bool degrees = false);
+	Mat4& rotate(float x, float y, float z, bool degrees = true);
+
+
+	void transpose(){
+		*this = getTranspose();
+	}
+
+	Mat4 getTranspose() const{
+		return Mat4(
+			values_[0], values_[4], values_[8], values_[12],
+			values_[1], values_[5], values_[9], values_[13],
+			values_[2], values_[6], values_[10], values_[14],
+			values_[3], values_[7], values_[11], values_[15]
+		);
+	}
+
+	// Upper left 3x3 matrix
+	Mat3 getRotation() const{
+		return Mat3(
+			values_[0], values_[1], values_[2],
+			values_[4], values_[5], values_[6],
+			values_[8], values_[9], values_[10]
+		);
+	}
+
+
+	const float* getValuesPtr() const{
+		return values_;
+	}
+
+	float get(int row, int col) const{
+		return values_[row * 4 + col];
+	}
+
+	void set(int row, int col, float value){
+		values_[row * 4 + col] = value;
+	}
+};
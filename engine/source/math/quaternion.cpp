@@ -12,7 +12,7 @@ Quaternion::Quaternion(float x, float y, float z, float w) :
 }
 
 // Quaternion from rotation matrix
-Quaternion::Quaternion(const Matrix& rm) : Quaternion(){
+Quaternion::Quaternion(const Mat3& rm) : Quaternion(){
 	float epsilon	= 0.001f;
 	float epsilon2	= 0.1f;
 
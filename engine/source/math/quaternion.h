@@ -10,7 +10,7 @@
 class Quaternion;
 
 #include"math/vec3.h"
-#include"math/matrix.h"
+#include"math/mat3.h"
 
 
 class Quaternion{
@@ -22,7 +22,7 @@ class Quaternion{
 
 public:
 	Quaternion(float x, float y, float z, float w);
-	Quaternion(const Matrix& rotationMatrix);
+	Quaternion(const Mat3& rotationMatrix);
 	Quaternion();
 
 
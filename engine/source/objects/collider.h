@@ -1,13 +1,28 @@
 #pragma once
 
 #include"objects/object.h"
+#include"math/mat3.h"
 
 class Portal;
 
 
 struct Collider{
 	Hitbox* hitbox;
-	Hitbox hitboxTransformed;
+
+	// Hitbox scaled by the parent object, in the parent's space
+	// Only rebuilt when the scale changes, collision tests bring other hitboxes into this space
+	TransformedHitbox hitboxScaled;
+	Vec3 hitboxScale;
+
+	// Bounds of scaled hitbox
+	// Radius is the distance of the furthest vertex from the center of the bounds
+	Vec3 lowerBound;
+	Vec3 upperBound;
+	float boundRadius;
+
+	// Transform from the parent's space to world space
+	Mat3 rotation;
+	Vec3 position;
 
 	Object* parent;
 	Portal* portal;
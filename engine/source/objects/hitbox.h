@@ -18,18 +18,74 @@ struct SATHalfEdge{
 };
 
 
-struct SATFace{
-	// Position and normal of face plane
+// Position and normal of face plane
+struct SATPlane{
 	Vec3 position;
 	Vec3 normal;
+};
+
 
+struct SATFace : SATPlane{
 	// Indices of edges that make up face (only vertices matter)
 	vector<int> edges;
 };
 
 
+// Shape used for collision tests
+// Primitive shapes have closed form tests, hulls and pairs without one use SAT
+enum class HitboxShape{
+	HULL,
+	SPHERE,
+	CAPSULE,
+	BOX
+};
+
+
+// Dimensions of a primitive shape around its center
+// Capsules lie along the z axis, half height is the distance from the center to either end sphere
+struct HitboxPrimitive{
+	HitboxShape shape;
+	Vec3 center;
+	Vec3 halfExtents;
+	float radius;
+	float halfHeight;
+
+	HitboxPrimitive() : shape(HitboxShape::HULL), radius(0), halfHeight(0) {}
+};
+
+
+// Hitbox topology and geometry in model space, shared by every object using the model
 struct Hitbox{
 	vector<Vec3> vertices;
 	vector<SATHalfEdge> edges;
 	vector<SATFace> faces;
+
+	// Vertices connected to vertex i by an edge are
+	// vertexNeighbours[neighbourStart[i]] up to vertexNeighbours[neighbourStart[i + 1]]
+	vector<int> neighbourStart;
+	vector<int> vertexNeighbours;
+
+	// Unit edge directions for edge axes of hitbox casts, parallel edges are only kept once
+	// Scaling keeps parallel edges parallel, so these stay unique for every scale
+	vector<Vec3> edgeDirections;
+
+	// Primitive the hull was generated from, hull data is still used for bounds, inertia and raycasts
+	HitboxPrimitive primitive;
+};
+
+
+// Hitbox geometry after scaling or moving into another space, indices match the shared hitbox
+// Edges and face edge lists are read from the shared hitbox
+struct TransformedHitbox{
+	const Hitbox* hitbox;
+	vector<Vec3> vertices;
+	vector<SATPlane> faces;
+
+	// Average of vertices
+	Vec3 center;
+
+	// Scaled primitive, a hull if the scale distorts the primitive shape
+	HitboxPrimitive primitive;
+
+	TransformedHitbox() : hitbox(nullptr) {}
 };
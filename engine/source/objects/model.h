@@ -9,5 +9,10 @@ struct Model{
 	vector<float> texCoords;
 	int numVertices;
 
+	// Shape of the generated hitbox, set by primitive model generators
+	HitboxShape hitboxShape;
+
 	vector<Hitbox> colliderHitboxes;
+
+	Model() : numVertices(0), hitboxShape(HitboxShape::HULL) {}
 };
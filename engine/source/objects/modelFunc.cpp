@@ -114,6 +114,16 @@ void ntw::generateHitbox(Model* model){
 	// Create hitbox data
 	Hitbox hitbox;
 
+	// Find index of vertex, vertices within threshold are welded
+	// Generated models can produce the same vertex with rounding differences, which would disconnect the hitbox
+	auto l_findVertex = [&hitbox](const Vec3& v) -> int {
+		for(int i = 0; i < hitbox.vertices.size(); i++)
+			if(hitbox.vertices[i].equalsWithinThreshold(v, 0.00001f))
+				return i;
+
+		return -1;
+	};
+
 	for(const vector<Vec3>& face : faces){
 
 		// Ignore faces with less than 3 vertices
@@ -128,7 +138,7 @@ void ntw::generateHitbox(Model* model){
 
 		// Add all unique vertices
 		for(int i = 0; i < numVerts; i++)
-			if(std::find(hitbox.vertices.begin(), hitbox.vertices.end(), face[i]) == hitbox.vertices.end())
+			if(l_findVertex(face[i]) == -1)
 				hitbox.vertices.push_back(face[i]);
 
 
@@ -143,8 +153,8 @@ void ntw::generateHitbox(Model* model){
 			j = j >= numVerts ? 0 : j;
 
 			// Get vertex indices
-			int v1 = (int)(std::find(hitbox.vertices.begin(), hitbox.vertices.end(), face[i]) - hitbox.vertices.begin());
-			int v2 = (int)(std::find(hitbox.vertices.begin(), hitbox.vertices.end(), face[j]) - hitbox.vertices.begin());
+			int v1 = l_findVertex(face[i]);
+			int v2 = l_findVertex(face[j]);
 
 			// Create half-edge, setting main face to current face
 			SATHalfEdge e = {v1, v2, (int)hitbox.faces.size(), -1};
@@ -222,6 +232,77 @@ void ntw::generateHitbox(Model* model){
 		if(f2 != -1)	hitbox.faces[f2].edges.push_back(i);
 	}
 
+	// Vertex adjacency for support queries, count neighbours of each vertex first
+	hitbox.neighbourStart.assign(hitbox.vertices.size() + 1, 0);
+
+	for(const SATHalfEdge& e : hitbox.edges){
+		hitbox.neighbourStart[e.v1 + 1]++;
+		hitbox.neighbourStart[e.v2 + 1]++;
+	}
+
+	for(int i = 1; i < hitbox.neighbourStart.size(); i++)
+		hitbox.neighbourStart[i] += hitbox.neighbourStart[i - 1];
+
+	hitbox.vertexNeighbours.resize(hitbox.neighbourStart.back());
+	vector<int> neighbourEnd(hitbox.neighbourStart.begin(), hitbox.neighbourStart.end() - 1);
+
+	for(const SATHalfEdge& e : hitbox.edges){
+		hitbox.vertexNeighbours[neighbourEnd[e.v1]++] = e.v2;
+		hitbox.vertexNeighbours[neighbourEnd[e.v2]++] = e.v1;
+	}
+
+	// Unique edge directions, opposite half-edges and parallel edges share a direction
+	for(const SATHalfEdge& e : hitbox.edges){
+		Vec3 d = hitbox.vertices[e.v2] - hitbox.vertices[e.v1];
+
+		if(d.magnitude2() < 0.000001f)
+			continue;
+
+		d = d.unitVector();
+
+		if(std::none_of(hitbox.edgeDirections.begin(), hitbox.edgeDirections.end(), [&d](const Vec3& other){ return abs(d * other) > 0.9999f; }))
+			hitbox.edgeDirections.push_back(d);
+	}
+
+	// Primitive dimensions from the bounds of the hull, round shapes reach the furthest vertex to contain the hull
+	HitboxPrimitive& primitive = hitbox.primitive;
+	primitive.shape = hitbox.vertices.empty() ? HitboxShape::HULL : model->hitboxShape;
+
+	if(primitive.shape != HitboxShape::HULL){
+		Vec3 lower = hitbox.vertices[0];
+		Vec3 upper = lower;
+
+		for(const Vec3& v : hitbox.vertices){
+			for(int i = 0; i < 3; i++){
+				lower[i] = std::min(lower[i], v[i]);
+				upper[i] = std::max(upper[i], v[i]);
+			}
+		}
+
+		primitive.center = (lower + upper) / 2;
+		primitive.halfExtents = (upper - lower) / 2;
+
+		float radius2 = 0;
+
+		for(const Vec3& v : hitbox.vertices){
+			Vec3 d = v - primitive.center;
+
+			// Capsule radius is measured around its axis
+			if(primitive.shape == HitboxShape::CAPSULE)
+				d.setZ(0);
+
+			radius2 = std::max(radius2, d.magnitude2());
+		}
+
+		if(primitive.shape == HitboxShape::SPHERE)
+			primitive.radius = sqrtf(radius2);
+
+		else if(primitive.shape == HitboxShape::CAPSULE){
+			primitive.radius = sqrtf(radius2);
+			primitive.halfHeight = std::max(primitive.halfExtents[2] - primitive.radius, 0.0f);
+		}
+	}
+
 	// Add collider hitbox
 	model->colliderHitboxes.push_back(hitbox);
 }
@@ -304,6 +385,7 @@ Model ntw::getCube(bool smoothNormals){
 	m.normals = createNormals(vertices, smoothNormals);
 	m.texCoords = texCoords;
 	m.numVertices = (int)(vertices.size() / 3);
+	m.hitboxShape = HitboxShape::BOX;
 
 	return m;
 }
@@ -372,6 +454,72 @@ Model ntw::getSphere(int segmentsU, int segmentsV, bool smoothNormals){
 	m.normals = createNormals(vertices, smoothNormals);
 	m.texCoords = texCoords;
 	m.numVertices = (int)(vertices.size() / 3);
+	m.hitboxShape = HitboxShape::SPHERE;
+
+	return m;
+}
+
+Model ntw::getCapsule(int segmentsU, int segmentsV, float halfHeight, bool smoothNormals){
+
+	vector<float> vertices;
+	vector<float> texCoords;
+
+	float angIncU = -360.0f / segmentsU;
+	float angIncV = 180.0f / segmentsV;
+
+	// Sphere vertex moved to the top or bottom end, texture coordinates run along the whole length
+	auto l_addVertex = [&](float angU, float angV, bool top){
+		Vec3 v = Vec3(-angU, 90 + angV) + Vec3(0, 0, top ? halfHeight : -halfHeight);
+		addVertex(v);
+		texCoords.push_back(-angU / 360);
+		texCoords.push_back((1 + halfHeight - v[2]) / (2 + 2 * halfHeight));
+	};
+
+	for(int u = 0; u < segmentsU; u++){
+
+		// Sphere segments with a cylinder segment inserted at the equator
+		for(int v = 0; v <= segmentsV; v++){
+			// Angle values
+			float angU1 = u * angIncU;
+			float angU2 = angU1 + angIncU;
+			float angV1 = (v <= segmentsV / 2 ? v : v - 1) * angIncV;
+			float angV2 = v == segmentsV / 2 ? angV1 : angV1 + angIncV;
+
+			// Half each ring of the segment is on
+			bool top1 = v <= segmentsV / 2;
+			bool top2 = v < segmentsV / 2;
+
+			// First and last segments are triangles
+			if(v == 0){
+				l_addVertex(angU2, angV2, top2);
+				l_addVertex(angU2, angV1, top1);
+				l_addVertex(angU1, angV2, top2);
+			}
+			else if(v == segmentsV){
+				l_addVertex(angU1, angV1, top1);
+				l_addVertex(angU1, angV2, top2);
+				l_addVertex(angU2, angV1, top1);
+			}
+
+			// Other segments are squares
+			else{
+				l_addVertex(angU1, angV1, top1);
+				l_addVertex(angU1, angV2, top2);
+				l_addVertex(angU2, angV1, top1);
+				l_addVertex(angU2, angV2, top2);
+				l_addVertex(angU2, angV1, top1);
+				l_addVertex(angU1, angV2, top2);
+			}
+		}
+	}
+
+
+	Model m;
+	m.vertices = vertices;
+	m.normals = createNormals(vertices, smoothNormals);
+	m.texCoords = texCoords;
+	m.numVertices = (int)(vertices.size() / 3);
+	m.hitboxShape = HitboxShape::CAPSULE;
 
 	return m;
 }
@@ -381,8 +529,7 @@ Model ntw::getTransformedObjectModel(const Object& obj){
 	Vec3 scale		= obj.getScale();
 	Vec3 position	= obj.getPosition();
 
-	Matrix rotation = Matrix(3, 3, true);
-	rotation.rotate(obj.getRotation());
+	Mat3 rotation = Mat3(obj.getRotation());
 
 	Model* m = obj.getModel();
 	vector<float>& vertices = m->vertices;
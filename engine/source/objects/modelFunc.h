@@ -18,6 +18,9 @@ namespace ntw{
 	Model getCube(bool smoothNormals = false);
 	Model getSphere(int segmentsU, int segmentsV, bool smoothNormals = false);
 
+	// Capsule along the z axis with unit radius, segmentsV must be even
+	Model getCapsule(int segmentsU, int segmentsV, float halfHeight, bool smoothNormals = false);
+
 	// Applies object's transformations to its model for rendering
 	Model getTransformedObjectModel(const Object& obj);
 
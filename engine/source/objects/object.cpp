@@ -1,6 +1,12 @@
 #include"object.h"
 
-#include"math/matrix.h"
+#include"math/mat3.h"
+#include<algorithm>
+#include<limits>
+#include<math.h>
+
+using std::min;
+using std::max;
 
 
 Object::Object(World& world, Model* model, Material* material, RenderType renderType, PhysicsType physicsType) :
@@ -14,16 +20,18 @@ Object::Object(World& world, Model* model, Material* material, RenderType render
 			c.hitbox = &hitbox;
 			c.parent = this;
 
-			// Copy hitbox data to transformed hitbox
-			c.hitboxTransformed.vertices	= c.hitbox->vertices;
-			c.hitboxTransformed.edges		= c.hitbox->edges;
-			c.hitboxTransformed.faces		= c.hitbox->faces;
+			// Copy hitbox geometry to scaled hitbox, topology stays shared
+			scaleHitbox(c);
 
 			colliders_.push_back(c);
 		}
 	}
 }
 
+Object::~Object(){
+
+}
+
 void Object::update(float timeDelta){
 
 	// Update sound source position
@@ -64,10 +72,18 @@ void Object::deleteSoundSource(){
 
 
 void Object::setPosition(const Vec3& position){
+
+	// Object is being moved externally, wake it
+	wake();
+
 	position_ = position;
 }
 
 void Object::setPosition(float x, float y, float z){
+
+	// Object is being moved externally, wake it
+	wake();
+
 	position_.setX(x);
 	position_.setY(y);
 	position_.setZ(z);
@@ -173,52 +189,111 @@ void Object::setPhysicsType(PhysicsType physicsType){
 	physicsType_ = physicsType;
 }
 
-bool Object::cacheTransformedHitbox(){
+bool Object::cacheColliderTransform(){
 
-	// Skip if hitbox has already been cached
+	// Skip if transform has already been cached
 	if(hitboxCached_ || colliders_.empty())
 		return false;
 
-	Matrix rotation = Matrix(3, 3, true).rotate(getTRotation());
+	Mat3 rotation = Mat3(getTRotation());
 
 	for(Collider& collider : colliders_){
 
-		// For each vertex
-		for(int i = 0; i < collider.hitbox->vertices.size(); i++){
+		// Vertices are only touched when the scale changes
+		if(collider.hitboxScale != getScale())
+			scaleHitbox(collider);
+
+		collider.rotation = rotation;
+		collider.position = getTPosition();
+	}
+
+	hitboxCached_ = true;
+	return true;
+}
+
+void Object::scaleHitbox(Collider& collider) const{
+
+	const Hitbox& hitbox = *collider.hitbox;
+	TransformedHitbox& scaled = collider.hitboxScaled;
+
+	scaled.hitbox = &hitbox;
+	scaled.vertices.resize(hitbox.vertices.size());
+	scaled.faces.resize(hitbox.faces.size());
+	scaled.center = Vec3();
 
-			Vec3& v = collider.hitboxTransformed.vertices[i];
-			v = collider.hitbox->vertices[i];
+	collider.lowerBound = std::numeric_limits<float>::max();
+	collider.upperBound = -collider.lowerBound;
 
-			// Scale
-			v *= getScale();
+	// Scale vertices and get bounds
+	for(int i = 0; i < hitbox.vertices.size(); i++){
 
-			// Rotate
-			v = rotation * v;
+		Vec3& v = scaled.vertices[i];
+		v = hitbox.vertices[i];
+		v *= getScale();
 
-			// Translate
-			v += getTPosition();
+		for(int j = 0; j < 3; j++){
+			collider.lowerBound[j] = min(collider.lowerBound[j], v[j]);
+			collider.upperBound[j] = max(collider.upperBound[j], v[j]);
 		}
 
-		// For each face
-		for(int i = 0; i < collider.hitbox->faces.size(); i++){
+		scaled.center += v;
+	}
+
+	if(!hitbox.vertices.empty())
+		scaled.center /= (float)hitbox.vertices.size();
+
+	// Bounding sphere keeps rotated bounds of round hitboxes tight
+	Vec3 boundCenter = (collider.lowerBound + collider.upperBound) / 2;
+	float radius2 = 0;
+
+	for(const Vec3& v : scaled.vertices)
+		radius2 = max(radius2, (v - boundCenter).magnitude2());
 
-			SATFace& f = collider.hitboxTransformed.faces[i];
-			f = collider.hitbox->faces[i];
+	collider.boundRadius = sqrtf(radius2);
 
-			// Scale
-			f.position *= getScale();
+	// Normals are scaled by the inverse scale to stay perpendicular to their faces
+	Vec3 scaleInv = Vec3(1 / getScale()[0], 1 / getScale()[1], 1 / getScale()[2]);
 
-			// Rotate
-			f.position = rotation * f.position;
-			f.normal = rotation * f.normal;
+	for(int i = 0; i < hitbox.faces.size(); i++){
 
-			// Translate
-			f.position += getTPosition();
+		SATPlane& f = scaled.faces[i];
+		f.position = hitbox.faces[i].position;
+		f.position *= getScale();
+
+		f.normal = hitbox.faces[i].normal;
+		f.normal *= scaleInv;
+		f.normal.normalize();
+	}
+
+	// Scale primitive, round shapes only stay round under uniform scale
+	scaled.primitive = hitbox.primitive;
+	scaled.primitive.center *= getScale();
+
+	float uniformScale = abs(getScale()[0]);
+	bool uniform = abs(abs(getScale()[1]) - uniformScale) <= uniformScale * 0.0001f &&
+		abs(abs(getScale()[2]) - uniformScale) <= uniformScale * 0.0001f;
+
+	switch(scaled.primitive.shape){
+	case HitboxShape::BOX:
+		for(int i = 0; i < 3; i++)
+			scaled.primitive.halfExtents[i] *= abs(getScale()[i]);
+		break;
+
+	case HitboxShape::SPHERE:
+	case HitboxShape::CAPSULE:
+		if(uniform){
+			scaled.primitive.radius *= uniformScale;
+			scaled.primitive.halfHeight *= uniformScale;
 		}
+		else
+			scaled.primitive.shape = HitboxShape::HULL;
+		break;
+
+	default:
+		break;
 	}
 
-	hitboxCached_ = true;
-	return true;
+	collider.hitboxScale = getScale();
 }
 
 void Object::addContact(ObjectContactInfo contact){
@@ -251,6 +326,14 @@ bool Object::isPlayer() const{
 	return false;
 }
 
+bool Object::isSleeping() const{
+	return false;
+}
+
+void Object::wake(){
+
+}
+
 
 Model* Object::getModel() const{
 	return model_;
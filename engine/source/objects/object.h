@@ -48,8 +48,12 @@ protected:
 
 	ALuint soundSource_;
 
+
+	void scaleHitbox(Collider& collider) const;
+
 public:
 	Object(World& world, Model* model, Material* material, RenderType renderType = RenderType::STATIC, PhysicsType physicsType = PhysicsType::STATIC);
+	virtual ~Object();
 
 	virtual void update(float timeDelta);
 
@@ -91,7 +95,8 @@ public:
 	void setRenderType(RenderType renderType);
 	void setPhysicsType(PhysicsType physicsType);
 
-	bool cacheTransformedHitbox();
+	// Update collider transforms from the t-position and t-rotation, returns false if already up to date
+	bool cacheColliderTransform();
 
 	void addContact(ObjectContactInfo contact);
 
@@ -104,6 +109,10 @@ public:
 	virtual const Quaternion& getTRotation() const;
 
 	virtual bool isPlayer() const;
+	virtual bool isSleeping() const;
+
+	// Wake the object if it is sleeping, its island wakes with it in the next physics update
+	virtual void wake();
 
 	Model* getModel() const;
 	Material* getMaterial() const;
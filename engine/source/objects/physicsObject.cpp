@@ -1,14 +1,16 @@
 #include"physicsObject.h"
 
 #include"physics/physDefine.h"
+#include<algorithm>
+#include<limits>
 
 
 
 
 PhysicsObject::PhysicsObject(World& world, Model* model, Material* material, float mass, PhysicsType physicsType) :
 	Object(world, model, material, model == nullptr ? RenderType::NONE : RenderType::DYNAMIC, physicsType),
-	mass_(mass), massInv_(1 / mass), useGravity_(true), gravityDirection_(Vec3(0, 0, -1)), useFriction_(true),
-	onGround_(false), onGroundClearNextFrame_(false) {
+	mass_(mass), massInv_(1 / mass), useGravity_(true), gravityDirection_(Vec3(0, 0, -1)), useFriction_(true), continuousCollision_(false),
+	characterController_(false), onGround_(false), onGroundClearNextFrame_(false), sleeping_(false), sleepTimer_(0), islandIndex_(-1), solverIndex_(0) {
 	
 }
 
@@ -31,7 +33,7 @@ void PhysicsObject::initPhysics(){
 	float m = mass_ / vertices.size();
 
 	// Base inertia tensor (no rotation)
-	inertiaBase_ = Matrix(3, 3);
+	inertiaBase_ = Mat3::zero();
 
 	// Set each tensor element
 	for(int i = 0; i < 3; i++){
@@ -65,8 +67,11 @@ void PhysicsObject::updatePhysics(){
 	Vec3 prevPosition = position_;
 	Quaternion prevRotation = rotation_;
 
-	// Update velocity and position
-	position_ += velocity_ * NTW_PHYS_TIME_DELTA;
+	// Update velocity and position, characters have already been moved to the end of their motion
+	if(characterController_ && physicsType_ == PhysicsType::SIMPLE)
+		position_ = tPosition_;
+	else
+		position_ += velocity_ * NTW_PHYS_TIME_DELTA;
 
 	// Simple friction
 	if(physicsType_ == PhysicsType::SIMPLE && useFriction_ && onGround_){
@@ -119,12 +124,55 @@ void PhysicsObject::tUpdatePhysics(){
 		hitboxCached_ = false;
 }
 
+void PhysicsObject::setTPosition(const Vec3& tPosition){
+
+	if(tPosition_ != tPosition)
+		hitboxCached_ = false;
+
+	tPosition_ = tPosition;
+}
+
 
 void PhysicsObject::updateTInertia(){
-	Matrix tRot = Matrix(3, 3, true).rotate(tRotation_);
+	Mat3 tRot = Mat3(tRotation_);
 	tInertiaInv_ = tRot * inertiaBaseInv_ * tRot.getTranspose();
 }
 
+void PhysicsObject::updateSleepTimer(){
+
+	// Reset timer while object is moving
+	if(velocity_.magnitude2() > NTW_PHYS_SLEEP_VELOCITY * NTW_PHYS_SLEEP_VELOCITY ||
+		angularVelocity_.magnitude2() > NTW_PHYS_SLEEP_ANGULAR_VELOCITY * NTW_PHYS_SLEEP_ANGULAR_VELOCITY)
+		sleepTimer_ = 0;
+	else
+		sleepTimer_ += NTW_PHYS_TIME_DELTA;
+}
+
+void PhysicsObject::setSleeping(bool sleeping){
+
+	sleeping_ = sleeping;
+	sleepTimer_ = 0;
+
+	// Remaining velocity would be lost anyway, since sleeping objects are not integrated
+	if(sleeping){
+		velocity_ = Vec3(0, 0, 0);
+		angularVelocity_ = Vec3(0, 0, 0);
+	}
+}
+
+void PhysicsObject::wake(){
+	if(sleeping_)
+		setSleeping(false);
+}
+
+void PhysicsObject::setIslandIndex(int islandIndex){
+	islandIndex_ = islandIndex;
+}
+
+void PhysicsObject::setSolverIndex(int solverIndex){
+	solverIndex_ = solverIndex;
+}
+
 void PhysicsObject::setUseGravity(bool useGravity){
 	useGravity_ = useGravity;
 }
@@ -142,19 +190,47 @@ void PhysicsObject::setOnGround(bool onGround){
 	onGround_ = onGround;
 }
 
+void PhysicsObject::setContinuousCollision(bool continuousCollision){
+	continuousCollision_ = continuousCollision;
+}
+
+void PhysicsObject::setCharacterController(bool characterController){
+	characterController_ = characterController;
+}
+
 void PhysicsObject::setVelocity(const Vec3& velocity){
+
+	// Object is being moved externally, wake it
+	if(sleeping_)
+		setSleeping(false);
+
 	velocity_ = velocity;
 }
 
 void PhysicsObject::addVelocity(const Vec3& velocity){
+
+	// Object is being moved externally, wake it
+	if(sleeping_)
+		setSleeping(false);
+
 	velocity_ += velocity;
 }
 
 void PhysicsObject::setAngularVelocity(const Vec3& angularVelocity){
+
+	// Object is being moved externally, wake it
+	if(sleeping_)
+		setSleeping(false);
+
 	angularVelocity_ = angularVelocity;
 }
 
 void PhysicsObject::addAngularVelocity(const Vec3& angularVelocity){
+
+	// Object is being moved externally, wake it
+	if(sleeping_)
+		setSleeping(false);
+
 	angularVelocity_ += angularVelocity;
 }
 
@@ -166,11 +242,11 @@ float PhysicsObject::getMassInv() const{
 	return massInv_;
 }
 
-const Matrix& PhysicsObject::getInertiaBase() const{
+const Mat3& PhysicsObject::getInertiaBase() const{
 	return inertiaBase_;
 }
 
-const Matrix& PhysicsObject::getTInertiaInv() const{
+const Mat3& PhysicsObject::getTInertiaInv() const{
 	return tInertiaInv_;
 }
 
@@ -186,6 +262,51 @@ bool PhysicsObject::onGround() const{
 	return onGround_;
 }
 
+bool PhysicsObject::useContinuousCollision() const{
+	return continuousCollision_;
+}
+
+bool PhysicsObject::isFastMoving() const{
+
+	if(!continuousCollision_ || sleeping_ || physicsType_ != PhysicsType::RIGID_BODY || colliders_.empty())
+		return false;
+
+	// Smallest half extent of the scaled collider bounds
+	float size = std::numeric_limits<float>::max();
+
+	for(const Collider& c : colliders_)
+		for(int i = 0; i < 3; i++)
+			size = std::min(size, (c.upperBound[i] - c.lowerBound[i]) / 2);
+
+	float threshold = size * NTW_PHYS_CCD_MOTION_FAC;
+
+	return (tPosition_ - position_).magnitude2() > threshold * threshold;
+}
+
+bool PhysicsObject::useCharacterController() const{
+	return characterController_;
+}
+
+bool PhysicsObject::canSleep() const{
+	return physicsType_ == PhysicsType::RIGID_BODY;
+}
+
+bool PhysicsObject::isSleeping() const{
+	return sleeping_;
+}
+
+float PhysicsObject::getSleepTimer() const{
+	return sleepTimer_;
+}
+
+int PhysicsObject::getIslandIndex() const{
+	return islandIndex_;
+}
+
+int PhysicsObject::getSolverIndex() const{
+	return solverIndex_;
+}
+
 const Vec3& PhysicsObject::getTPosition() const{
 	return tPosition_;
 }
@@ -10,7 +10,7 @@
 class PhysicsObject;
 
 #include"object.h"
-#include"math/matrix.h"
+#include"math/mat3.h"
 
 
 class PhysicsObject : public Object {
@@ -23,13 +23,19 @@ protected:
 
 	bool useFriction_;
 
+	// Sweep collider between updates when moving fast enough to pass through other objects
+	bool continuousCollision_;
+
+	// Moved by casting its colliders along its motion instead of being pushed out of other objects, for simple objects only
+	bool characterController_;
+
 	// For simple dynamic objects only
 	bool onGround_;
 	bool onGroundClearNextFrame_;
 
-	Matrix inertiaBase_;
-	Matrix inertiaBaseInv_;
-	Matrix tInertiaInv_;
+	Mat3 inertiaBase_;
+	Mat3 inertiaBaseInv_;
+	Mat3 tInertiaInv_;
 
 	Vec3 velocity_;
 	Vec3 angularVelocity_;
@@ -37,6 +43,16 @@ protected:
 	Vec3 tPosition_;
 	Quaternion tRotation_;
 
+	// Sleeping objects are skipped by the physics engine until woken
+	bool sleeping_;
+	float sleepTimer_;
+
+	// Index used while building contact islands
+	int islandIndex_;
+
+	// Index of the object's velocities while its island is batch solved
+	int solverIndex_;
+
 public:
 	PhysicsObject(World& world, Model* model, Material* material, float mass, PhysicsType physicsType = PhysicsType::RIGID_BODY);
 
@@ -49,14 +65,29 @@ public:
 	// Partial update during simulation step
 	void tUpdatePhysics();
 
+	// Move the end of the update's motion, used to stop at the time of impact of a sweep
+	void setTPosition(const Vec3& tPosition);
+
 
 	void updateTInertia();
 
+	// Accumulate time spent below sleep velocity thresholds
+	void updateSleepTimer();
+
+	// Sleeping zeroes velocity, waking resets the sleep timer
+	void setSleeping(bool sleeping);
+	void wake() override;
+	void setIslandIndex(int islandIndex);
+	void setSolverIndex(int solverIndex);
+
 	void setUseGravity(bool useGravity);
 	void setGravityDirection(const Vec3& gravityDirection);
 
 	void setOnGround(bool onGround);
 
+	void setContinuousCollision(bool continuousCollision);
+	void setCharacterController(bool characterController);
+
 
 	void setVelocity(const Vec3& velocity);
 	void addVelocity(const Vec3& velocity);
@@ -66,14 +97,27 @@ public:
 
 	float getMass() const;
 	float getMassInv() const;
-	const Matrix& getInertiaBase() const;
-	const Matrix& getTInertiaInv() const;
+	const Mat3& getInertiaBase() const;
+	const Mat3& getTInertiaInv() const;
 
 	bool useGravity() const;
 	const Vec3& getGravityDirection() const;
 
 	bool onGround() const;
 
+	bool useContinuousCollision() const;
+
+	// Continuous collision is enabled and the object moves further than part of its size this update
+	bool isFastMoving() const;
+
+	bool useCharacterController() const;
+
+	bool canSleep() const;
+	bool isSleeping() const override;
+	float getSleepTimer() const;
+	int getIslandIndex() const;
+	int getSolverIndex() const;
+
 	const Vec3& getTPosition() const override;
 	const Quaternion& getTRotation() const override;
 
@@ -16,6 +16,9 @@ Player::Player(World& world, Model* model, ControlOptions& cOptions, Window& win
 	// Hitbox size
 	setScale(Vec3(0.25f, 0.25f, 0.5f));
 
+	// Slide along and step onto surfaces instead of being pushed out of them
+	setCharacterController(true);
+
 	// Initialize look vectors
 	updateLookVectors();
 }
@@ -155,20 +158,11 @@ void Player::updatePlayer(float timeDelta, bool updatePhysics){
 			const float maxMass = 10;
 
 			// Cast ray and get closest object
-			vector<Object*> objects = world_.getPhysicsEngine().castRay(eyePosition_, look_, maxDistance);
-
+			RaycastHit hit;
 			Object* object = nullptr;
-			float minDistance = std::numeric_limits<float>::max();
-
-			for(int i = 0; i < objects.size(); i++){
 
-				float distance = (position_ - objects[i]->getPosition()).magnitude2();
-
-				if(distance < minDistance && objects[i] != this){
-					object = objects[i];
-					minDistance = distance;
-				}
-			}
+			if(world_.getPhysicsEngine().castRay(eyePosition_, look_, maxDistance, hit, this))
+				object = hit.object;
 
 			// Check that object is valid for holding
 			if(object && (object->getPhysicsType() == PhysicsType::RIGID_BODY || object->getPhysicsType() == PhysicsType::SIMPLE) &&
@@ -222,7 +216,7 @@ void Player::setPitch(float pitch){
 	pitch_ = pitch;
 }
 
-void Player::addPortalRotation(const Matrix& portalRotation){
+void Player::addPortalRotation(const Mat3& portalRotation){
 	portalRotation_ = portalRotation * portalRotation_;
 
 	rotation_ = Quaternion(portalRotation_);
@@ -259,6 +253,6 @@ const Vec3& Player::getLookUpVector() const{
 	return lookUp_;
 }
 
-const Matrix& Player::getPortalRotation() const{
+const Mat3& Player::getPortalRotation() const{
 	return portalRotation_;
 }
@@ -41,7 +41,7 @@ class Player : public PhysicsObject{
     PhysicsType heldObjectPhysicsType_;
 
     // Rotation after moving through portal
-    Matrix portalRotation_;
+    Mat3 portalRotation_;
 
 
 public:
@@ -56,7 +56,7 @@ public:
     void setYaw(float yaw);
     void setPitch(float pitch);
 
-    void addPortalRotation(const Matrix& portalRotation);
+    void addPortalRotation(const Mat3& portalRotation);
 
 
     bool isPlayer() const override;
@@ -70,5 +70,5 @@ public:
     const Vec3& getLookRightVector() const;
     const Vec3& getLookUpVector() const;
 
-    const Matrix& getPortalRotation() const;
+    const Mat3& getPortalRotation() const;
 };
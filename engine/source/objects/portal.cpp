@@ -12,14 +12,14 @@ Portal::Portal(Vec3 position, Quaternion rotation, float width, float height, in
 void Portal::update(){
 
 	// Rotation matrix
-	Matrix rotationMatrix = Matrix(3, 3, true).rotate(rotation_);
+	Mat3 rotationMatrix = Mat3(rotation_);
 
 	// Normal vector
 	normal_	= rotationMatrix * Vec3(0, 1, 0);
 
 
 	// Matrices to transform vectors to paired portal
-	transformationMatrix_ = Matrix();
+	transformationMatrix_ = Mat4::identity();
 
 	if(pairedPortal_){
 		// World to portal space
@@ -27,7 +27,7 @@ void Portal::update(){
 		transformationMatrix_.rotate(-rotation_);
 
 		// Mirroring
-		Matrix mirroringMatrix = Matrix().rotate(Vec3(0, 0, 1), 180.0f, true);
+		Mat4 mirroringMatrix = Mat4().rotate(Vec3(0, 0, 1), 180.0f, true);
 		transformationMatrix_	= mirroringMatrix * transformationMatrix_;
 
 		// Paired portal space to world
@@ -35,10 +35,7 @@ void Portal::update(){
 		transformationMatrix_.translate(pairedPortal_->getPosition());
 
 		// Rotation only matrix
-		rotationMatrix_ = transformationMatrix_;
-		rotationMatrix_.set(0, 3, 0);
-		rotationMatrix_.set(1, 3, 0);
-		rotationMatrix_.set(2, 3, 0);
+		rotationMatrix_ = transformationMatrix_.getRotation();
 	}
 
 
@@ -166,11 +163,11 @@ float Portal::getHeight() const{
 	return height_;
 }
 
-const Matrix& Portal::getTransformationMatrix() const{
+const Mat4& Portal::getTransformationMatrix() const{
 	return transformationMatrix_;
 }
 
-const Matrix& Portal::getRotationMatrix() const{
+const Mat3& Portal::getRotationMatrix() const{
 	return rotationMatrix_;
 }
 
@@ -10,7 +10,8 @@
 class Portal;
 
 #include"math/vec3.h"
-#include"math/matrix.h"
+#include"math/mat3.h"
+#include"math/mat4.h"
 #include"math/quaternion.h"
 #include"objects/collider.h"
 #include<vector>
@@ -41,8 +42,8 @@ class Portal{
 
 	vector<Vec3> vertices_;
 
-	Matrix transformationMatrix_;
-	Matrix rotationMatrix_;
+	Mat4 transformationMatrix_;
+	Mat3 rotationMatrix_;
 
 	vector<ClipPlane> clipPlanes_;
 
@@ -83,8 +84,8 @@ public:
 	float getWidth() const;
 	float getHeight() const;
 
-	const Matrix& getTransformationMatrix() const;
-	const Matrix& getRotationMatrix() const;
+	const Mat4& getTransformationMatrix() const;
+	const Mat3& getRotationMatrix() const;
 
 	const vector<Vec3>& getVertices() const;
 	const Collider& getCollider() const;
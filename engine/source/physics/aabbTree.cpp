@@ -2,57 +2,113 @@
 
 #include"physics/physDefine.h"
 #include"objects/portal.h"
+#include"objects/physicsObject.h"
 #include<algorithm>
 #include<limits>
+#include<cmath>
 
 using std::min;
 using std::max;
 
 
-AABBTree::AABBTree() : root_(nullptr) {
+AABBTree::AABBTree() : freeList_(NTW_AABB_NULL_NODE), root_(NTW_AABB_NULL_NODE), staticRoot_(NTW_AABB_NULL_NODE), staticChanged_(false) {
 
 }
 
+int AABBTree::allocateNode(){
+
+	int node;
+
+	// Reuse free node
+	if(freeList_ != NTW_AABB_NULL_NODE){
+		node = freeList_;
+		freeList_ = nodes_[node].parent;
+		nodes_[node] = Node();
+	}
+
+	// Grow pool
+	else{
+		node = (int)nodes_.size();
+		nodes_.emplace_back();
+	}
+
+	return node;
+}
+
+void AABBTree::freeNode(int node){
+	nodes_[node].parent = freeList_;
+	nodes_[node].child1 = NTW_AABB_NULL_NODE;
+	nodes_[node].collider = nullptr;
+	freeList_ = node;
+}
+
 void AABBTree::update(){
 
-	if(!root_)
-		return;
+	// Clear events reported by the previous update, and by removals since then
+	addedPairs_.clear();
+	removedPairs_.clear();
+
+	// Rebuild the static tree after static colliders have been added or removed
+	bool staticRebuilt = staticChanged_;
+
+	if(staticChanged_)
+		buildStatic();
+
+	if(root_ != NTW_AABB_NULL_NODE){
 
-	// Clear invalid nodes
-	invalid_.clear();
+		// Clear invalid nodes
+		invalid_.clear();
 
-	// Update tree
-	updateNode(root_);
+		// Update tree
+		updateNode(root_);
 
-	// Re-insert invaild nodes
-	for(Node* node : invalid_){
+		// Re-insert invaild nodes
+		for(int node : invalid_){
 
-		// Update large AABB
-		node->aabbMargin->lowerBound = node->aabb->lowerBound - NTW_AABB_MARGIN;
-		node->aabbMargin->upperBound = node->aabb->upperBound + NTW_AABB_MARGIN;
+			// Update large AABB
+			Node& n = nodes_[node];
+			n.aabbMargin.lowerBound = n.aabb.lowerBound - NTW_AABB_MARGIN;
+			n.aabbMargin.upperBound = n.aabb.upperBound + NTW_AABB_MARGIN;
 
-		// Remove and add again
-		removeNode(node, false);
-		addNode(node, root_);
+			// Remove and add again
+			removeNode(node, false);
+			insertLeaf(node);
+
+			// Insertion can grow the pool, so the node is accessed by index
+			if(!nodes_[node].moved){
+				nodes_[node].moved = true;
+				moved_.push_back(node);
+			}
+		}
 	}
+
+	updatePairs(staticRebuilt);
 }
 
-void AABBTree::updateNode(Node* node){
+void AABBTree::updateNode(int node){
+
+	Node& n = nodes_[node];
 
 	// Node is leaf
-	if(node->isLeaf()){
+	if(n.isLeaf()){
+
+		// Sleeping objects do not move, skip them
+		Object* parent = n.collider->parent;
+
+		if(parent && parent->isSleeping())
+			return;
 
 		// Update AABB is collider's parent object's hitbox has been updated
-		if(node->aabb->collider->parent && node->aabb->collider->parent->cacheTransformedHitbox()){
+		if(parent && parent->cacheColliderTransform()){
 			updateAABB(node);
 
 			// If AABB has moved outside margin, mark it invalid
-			if(	node->aabb->lowerBound[0] < node->aabbMargin->lowerBound[0] ||
-				node->aabb->lowerBound[1] < node->aabbMargin->lowerBound[1] ||
-				node->aabb->lowerBound[2] < node->aabbMargin->lowerBound[2] ||
-				node->aabb->upperBound[0] > node->aabbMargin->upperBound[0] ||
-				node->aabb->upperBound[1] > node->aabbMargin->upperBound[1] ||
-				node->aabb->upperBound[2] > node->aabbMargin->upperBound[2]){
+			if(	n.aabb.lowerBound[0] < n.aabbMargin.lowerBound[0] ||
+				n.aabb.lowerBound[1] < n.aabbMargin.lowerBound[1] ||
+				n.aabb.lowerBound[2] < n.aabbMargin.lowerBound[2] ||
+				n.aabb.upperBound[0] > n.aabbMargin.upperBound[0] ||
+				n.aabb.upperBound[1] > n.aabbMargin.upperBound[1] ||
+				n.aabb.upperBound[2] > n.aabbMargin.upperBound[2]){
 
 				invalid_.push_back(node);
 			}
@@ -61,108 +117,203 @@ void AABBTree::updateNode(Node* node){
 
 	// Node is branch, update children
 	else{
-		updateNode(node->child1);
-		updateNode(node->child2);
+		updateNode(n.child1);
+		updateNode(n.child2);
 	}
 }
 
-void AABBTree::updateAABB(Node* node){
+void AABBTree::updateAABB(int node){
 
-	AABB* aabb = node->aabb;
+	Node& n = nodes_[node];
+	AABB& aabb = n.aabb;
 
 	// Leaf node, update based on AABB's collider
-	if(node->isLeaf()){
+	if(n.isLeaf()){
+
+		const Collider* c = n.collider;
+
+		// Object collider, transform bounds of scaled hitbox
+		if(c->parent){
+			getColliderAABB(c, aabb);
+
+			// Fast objects are swept back to where they start the update
+			if(c->parent->getPhysicsType() == PhysicsType::RIGID_BODY && ((PhysicsObject*)c->parent)->isFastMoving()){
+				Vec3 sweep = c->parent->getTPosition() - c->parent->getPosition();
+
+				for(int i = 0; i < 3; i++){
+					aabb.lowerBound[i] = min(aabb.lowerBound[i], aabb.lowerBound[i] - sweep[i]);
+					aabb.upperBound[i] = max(aabb.upperBound[i], aabb.upperBound[i] - sweep[i]);
+				}
+			}
+
+			return;
+		}
 
 		// Min/max coordinate values
-		aabb->lowerBound = std::numeric_limits<float>::max();
-		aabb->upperBound = -aabb->lowerBound;
+		aabb.lowerBound = std::numeric_limits<float>::max();
+		aabb.upperBound = -aabb.lowerBound;
 
-		bool isPortal = aabb->collider->portal;
+		bool isPortal = c->portal;
 
-		// Get transformed collider vertices or portal vertices
-		const vector<Vec3>& vertices =	aabb->collider->parent ? aabb->collider->hitboxTransformed.vertices :
-										isPortal ? aabb->collider->portal->getVertices() :
-										aabb->collider->hitbox->vertices;
+		// Get portal vertices
+		const vector<Vec3>& vertices = isPortal ? c->portal->getVertices() : c->hitbox->vertices;
 
 		// Get bounding coordinates
 		for(const Vec3& v : vertices){
-			aabb->lowerBound[0] = min(aabb->lowerBound[0], v[0]);
-			aabb->lowerBound[1] = min(aabb->lowerBound[1], v[1]);
-			aabb->lowerBound[2] = min(aabb->lowerBound[2], v[2]);
+			aabb.lowerBound[0] = min(aabb.lowerBound[0], v[0]);
+			aabb.lowerBound[1] = min(aabb.lowerBound[1], v[1]);
+			aabb.lowerBound[2] = min(aabb.lowerBound[2], v[2]);
 
-			aabb->upperBound[0] = max(aabb->upperBound[0], v[0]);
-			aabb->upperBound[1] = max(aabb->upperBound[1], v[1]);
-			aabb->upperBound[2] = max(aabb->upperBound[2], v[2]);
+			aabb.upperBound[0] = max(aabb.upperBound[0], v[0]);
+			aabb.upperBound[1] = max(aabb.upperBound[1], v[1]);
+			aabb.upperBound[2] = max(aabb.upperBound[2], v[2]);
 		}
 
 		// Add margin for portals
 		if(isPortal){
-			aabb->lowerBound -= NTW_AABB_PORTAL_MARGIN;
-			aabb->upperBound += NTW_AABB_PORTAL_MARGIN;
+			aabb.lowerBound -= NTW_AABB_PORTAL_MARGIN;
+			aabb.upperBound += NTW_AABB_PORTAL_MARGIN;
 		}
 	}
 
 	// Branch node, take min/max of child AABBs
 	else{
-		for(int i = 0; i < 3; i++){
+		const Node& c1 = nodes_[n.child1];
+		const Node& c2 = nodes_[n.child2];
 
-			// Use enlarged AABB for children that have them
-			float cl1 = node->child1->aabbMargin ? node->child1->aabbMargin->lowerBound[i] : node->child1->aabb->lowerBound[i];
-			float cl2 = node->child2->aabbMargin ? node->child2->aabbMargin->lowerBound[i] : node->child2->aabb->lowerBound[i];
-			float cu1 = node->child1->aabbMargin ? node->child1->aabbMargin->upperBound[i] : node->child1->aabb->upperBound[i];
-			float cu2 = node->child2->aabbMargin ? node->child2->aabbMargin->upperBound[i] : node->child2->aabb->upperBound[i];
+		// Use enlarged AABB for children that have them
+		aabb = combine(c1.getMarginAABB(), c2.getMarginAABB());
 
-			aabb->lowerBound[i] = min(cl1, cl2);
-			aabb->upperBound[i] = max(cu1, cu2);
-		}
+		n.height = 1 + max(c1.height, c2.height);
+		n.isStatic = c1.isStatic && c2.isStatic;
 	}
 }
 
-void AABBTree::clear(){
-	
-	if(!root_)
-		return;
+void AABBTree::getColliderAABB(const Collider* collider, AABB& aabb){
 
-	if(root_->isLeaf())
-		delete root_;
+	const Collider* c = collider;
 
-	// Recursively delete nodes
-	else
-		clear(root_);
+	Vec3 center = (c->lowerBound + c->upperBound) / 2;
+	Vec3 extents = c->upperBound - center;
+	center = c->rotation * center + c->position;
+
+	// Extents of rotated box along each world axis, limited by the bounding sphere
+	for(int i = 0; i < 3; i++){
+		float e =	std::abs(c->rotation.get(i, 0)) * extents[0] +
+					std::abs(c->rotation.get(i, 1)) * extents[1] +
+					std::abs(c->rotation.get(i, 2)) * extents[2];
+
+		e = min(e, c->boundRadius);
 
-	root_ = nullptr;
+		aabb.lowerBound[i] = center[i] - e;
+		aabb.upperBound[i] = center[i] + e;
+	}
 }
 
-void AABBTree::clear(Node* node){
+AABB AABBTree::combine(const AABB& a, const AABB& b){
 
-	// Delete leaf children and recursively clear branch children
-	if(node->child1->isLeaf())
-		delete node->child1;
-	else
-		clear(node->child1);
+	AABB aabb;
 
-	if(node->child2->isLeaf())
-		delete node->child2;
-	else
-		clear(node->child2);
+	for(int i = 0; i < 3; i++){
+		aabb.lowerBound[i] = min(a.lowerBound[i], b.lowerBound[i]);
+		aabb.upperBound[i] = max(a.upperBound[i], b.upperBound[i]);
+	}
+
+	return aabb;
+}
+
+float AABBTree::getArea(const AABB& aabb){
+
+	float x = aabb.upperBound[0] - aabb.lowerBound[0];
+	float y = aabb.upperBound[1] - aabb.lowerBound[1];
+	float z = aabb.upperBound[2] - aabb.lowerBound[2];
+
+	return 2 * ((x * y) + (y * z) + (z * x));
+}
+
+AABBTreeQuality AABBTree::getQuality() const{
+
+	AABBTreeQuality quality;
+
+	if(staticRoot_ != NTW_AABB_NULL_NODE){
+		quality.staticMaxDepth = staticNodes_[staticRoot_].height;
+
+		for(const Node& n : staticNodes_)
+			if(n.isLeaf() && n.collider)
+				quality.numStaticLeaves++;
+	}
+
+	if(root_ == NTW_AABB_NULL_NODE)
+		return quality;
+
+	quality.maxDepth = nodes_[root_].height;
+	quality.rootArea = getArea(nodes_[root_].getMarginAABB());
+
+	// Sum areas of all nodes in use
+	vector<int> stack = {root_};
+
+	while(!stack.empty()){
+		const Node& n = nodes_[stack.back()];
+		stack.pop_back();
+
+		if(n.isLeaf()){
+			quality.numLeaves++;
+			continue;
+		}
+
+		quality.internalArea += getArea(n.aabb);
+		stack.push_back(n.child1);
+		stack.push_back(n.child2);
+	}
+
+	return quality;
+}
+
+void AABBTree::clear(){
+
+	// Nodes are owned by the pool
+	nodes_.clear();
+	freeList_ = NTW_AABB_NULL_NODE;
+	root_ = NTW_AABB_NULL_NODE;
+
+	pairs_.clear();
+	pairIndices_.clear();
+	moved_.clear();
+
+	staticColliders_.clear();
+	staticNodes_.clear();
+	staticRoot_ = NTW_AABB_NULL_NODE;
+	staticChanged_ = false;
+	staticPairs_.clear();
+	staticPairIndices_.clear();
+
+	overlapping_.clear();
+	addedPairs_.clear();
+	removedPairs_.clear();
 }
 
 
 void AABBTree::add(const Collider* collider){
 
+	// Static object colliders are built into the static tree in the next update
+	if(collider->parent && collider->parent->getPhysicsType() == PhysicsType::STATIC){
+		collider->parent->cacheColliderTransform();
+		staticColliders_.push_back(collider);
+		staticChanged_ = true;
+		return;
+	}
+
 	// Create node for this collider
-	Node* node = new Node();
-	node->aabb->collider = collider;
-	node->aabb->isStatic = true;
+	int node = allocateNode();
+	Node& n = nodes_[node];
+	n.collider = collider;
+	n.isStatic = true;
 
 	// Cache parent object's transformed hitbox and update AABB
 	if(collider->parent){
-		collider->parent->cacheTransformedHitbox();
+		collider->parent->cacheColliderTransform();
 		updateAABB(node);
-
-		// Set non-static if necessary
-		if(collider->parent->getPhysicsType() != PhysicsType::STATIC)
-			node->aabb->isStatic = false;
+		n.isStatic = false;
 	}
 
 	// Collider belongs to portal
@@ -170,261 +321,675 @@ void AABBTree::add(const Collider* collider){
 		updateAABB(node);
 
 	// Set large AABB for dynamic objects
-	if(!node->aabb->isStatic){
-		node->aabbMargin = new AABB();
-		node->aabbMargin->lowerBound = node->aabb->lowerBound - NTW_AABB_MARGIN;
-		node->aabbMargin->upperBound = node->aabb->upperBound + NTW_AABB_MARGIN;
+	if(!n.isStatic){
+		n.hasMargin = true;
+		n.aabbMargin.lowerBound = n.aabb.lowerBound - NTW_AABB_MARGIN;
+		n.aabbMargin.upperBound = n.aabb.upperBound + NTW_AABB_MARGIN;
 	}
 
+	insertLeaf(node);
+
+	// Find pairs of new leaf in the next update
+	nodes_[node].moved = true;
+	moved_.push_back(node);
+}
+
+void AABBTree::insertLeaf(int leaf){
+
 	// First node
-	if(!root_)
-		root_ = node;
+	if(root_ == NTW_AABB_NULL_NODE){
+		root_ = leaf;
+		return;
+	}
+
+	int sibling = findBestSibling(nodes_[leaf].getMarginAABB());
+
+	// Create new branch node, pool may grow so nodes are accessed by index afterwards
+	int newNode = allocateNode();
+	int grandparent = nodes_[sibling].parent;
+
+	nodes_[newNode].parent = grandparent;
+	nodes_[newNode].child1 = leaf;
+	nodes_[newNode].child2 = sibling;
+
+	// Update grandparent child
+	if(grandparent != NTW_AABB_NULL_NODE){
+		if(nodes_[grandparent].child1 == sibling)
+			nodes_[grandparent].child1 = newNode;
+		else
+			nodes_[grandparent].child2 = newNode;
+	}
+
+	// No grandparent, sibling is root
 	else
-		addNode(node, root_);
+		root_ = newNode;
+
+	// Set child parents
+	nodes_[leaf].parent = newNode;
+	nodes_[sibling].parent = newNode;
+
+	updateAABB(newNode);
+
+	// Enlarge and rebalance ancestors
+	refitAncestors(grandparent);
 }
 
-void AABBTree::addNode(Node* node, Node* parent){
+int AABBTree::findBestSibling(const AABB& aabb){
 
-	// Parent is leaf
-	if(parent->isLeaf()){
+	// Branch and bound search for the sibling with the lowest surface area cost
+	// Cost of a sibling is the area of the new parent plus the area added to every ancestor
+	float area = getArea(aabb);
 
-		// Create new branch node
-		Node* newNode = new Node();
-		newNode->parent = parent->parent;
-		newNode->child1 = node;
-		newNode->child2 = parent;
+	int best = root_;
+	float bestCost = getArea(combine(nodes_[root_].getMarginAABB(), aabb));
 
-		// Update grandparent child
-		if(parent->parent){
-			if(parent->parent->child1 == parent)
-				parent->parent->child1 = newNode;
-			else
-				parent->parent->child2 = newNode;
-		}
+	searchStack_.clear();
+	searchStack_.push_back({root_, 0.0f});
 
-		// No grandparent, parent is root
-		else
-			root_ = newNode;
+	while(!searchStack_.empty()){
+
+		SearchEntry entry = searchStack_.back();
+		searchStack_.pop_back();
 
-		// Set child parents
-		newNode->child1->parent = newNode;
-		newNode->child2->parent = newNode;
+		const Node& n = nodes_[entry.node];
+		float directCost = getArea(combine(n.getMarginAABB(), aabb));
+		float cost = directCost + entry.inheritedCost;
+
+		if(cost < bestCost){
+			bestCost = cost;
+			best = entry.node;
+		}
 
-		// Set this AABB as static if both children are static
-		newNode->aabb->isStatic = newNode->child1->aabb->isStatic && newNode->child2->aabb->isStatic;
+		// Area this node would grow by is added to the cost of every sibling below it
+		float inheritedCost = entry.inheritedCost + directCost - getArea(n.getMarginAABB());
 
-		updateAABB(newNode);
+		// Children can not cost less than the new node's own area plus the inherited cost
+		if(!n.isLeaf() && area + inheritedCost < bestCost){
+			searchStack_.push_back({n.child1, inheritedCost});
+			searchStack_.push_back({n.child2, inheritedCost});
+		}
 	}
 
-	// Parent is branch
-	else{
-		// Compute volume difference if node is added to either child
-		AABB* box	= node->aabb;
-		AABB* box1	= parent->child1->aabb;
-		AABB* box2	= parent->child2->aabb;
-
-		Vec3 aabbSize1 = Vec3(
-			box1->upperBound[0] - box1->lowerBound[0],
-			box1->upperBound[1] - box1->lowerBound[1],
-			box1->upperBound[2] - box1->lowerBound[2]
-		);
-		Vec3 aabbNewSize1 = Vec3(
-			max(box->upperBound[0], box1->upperBound[0]) - min(box->lowerBound[0], box1->lowerBound[0]),
-			max(box->upperBound[1], box1->upperBound[1]) - min(box->lowerBound[1], box1->lowerBound[1]),
-			max(box->upperBound[2], box1->upperBound[2]) - min(box->lowerBound[2], box1->lowerBound[2])
-		);
-		Vec3 aabbSize2 = Vec3(
-			box1->upperBound[0] - box1->lowerBound[0],
-			box1->upperBound[1] - box1->lowerBound[1],
-			box1->upperBound[2] - box1->lowerBound[2]
-		);
-		Vec3 aabbNewSize2 = Vec3(
-			max(box->upperBound[0], box2->upperBound[0]) - min(box->lowerBound[0], box2->lowerBound[0]),
-			max(box->upperBound[1], box2->upperBound[1]) - min(box->lowerBound[1], box2->lowerBound[1]),
-			max(box->upperBound[2], box2->upperBound[2]) - min(box->lowerBound[2], box2->lowerBound[2])
-		);
-
-		float volumeDifference1 = (aabbNewSize1[0] * aabbNewSize1[1] * aabbNewSize1[2]) - (aabbSize1[0] * aabbSize1[1] * aabbSize1[2]);
-		float volumeDifference2 = (aabbNewSize2[0] * aabbNewSize2[1] * aabbNewSize2[2]) - (aabbSize2[0] * aabbSize2[1] * aabbSize2[2]);
-
-		// Add node to child that has less volume increase
-		if(volumeDifference1 < volumeDifference2)
-			addNode(node, parent->child1);
-		else
-			addNode(node, parent->child2);
+	return best;
+}
+
+void AABBTree::refitAncestors(int node){
 
-		// Update parent
-		updateAABB(parent);
+	while(node != NTW_AABB_NULL_NODE){
+		node = balance(node);
+		updateAABB(node);
+		node = nodes_[node].parent;
 	}
 }
 
-void AABBTree::remove(const Collider* collider){
+int AABBTree::balance(int node){
 
-	if(!root_)
-		return;
+	const Node& n = nodes_[node];
 
-	// Root node contains collider
-	if(root_->isLeaf() && root_->aabb->collider == collider)
-		removeNode(root_);
+	if(n.isLeaf() || n.height < 2)
+		return node;
 
-	// Search for and remove collider node
-	else
-		remove(collider, root_);
+	int heightDifference = nodes_[n.child2].height - nodes_[n.child1].height;
+
+	// Promote taller child if the heights differ by more than one
+	if(heightDifference > 1)
+		return rotate(node, n.child2);
+
+	if(heightDifference < -1)
+		return rotate(node, n.child1);
+
+	return node;
 }
 
-void AABBTree::remove(const Collider* collider, Node* node){
+int AABBTree::rotate(int node, int child){
 
-	// Check leaf children and recursively check branch children
-	if(node->child1->isLeaf()){
-		if(node->child1->aabb->collider == collider){
-			removeNode(node->child1);
-			return;
-		}
+	// Child takes the place of node, node takes the place of the child's shorter child
+	Node& a = nodes_[node];
+	Node& c = nodes_[child];
+
+	int f = c.child1;
+	int g = c.child2;
+
+	// Taller grandchild stays with child
+	if(nodes_[f].height < nodes_[g].height)
+		std::swap(f, g);
+
+	// Replace node with child in the parent
+	c.parent = a.parent;
+
+	if(c.parent != NTW_AABB_NULL_NODE){
+		if(nodes_[c.parent].child1 == node)
+			nodes_[c.parent].child1 = child;
+		else
+			nodes_[c.parent].child2 = child;
 	}
 	else
-		remove(collider, node->child1);
+		root_ = child;
+
+	// Node becomes a child of child, shorter grandchild moves to node
+	c.child1 = node;
+	c.child2 = f;
+	a.parent = child;
+
+	if(a.child1 == child)
+		a.child1 = g;
+	else
+		a.child2 = g;
+
+	nodes_[g].parent = node;
+
+	updateAABB(node);
+	updateAABB(child);
+
+	return child;
+}
+
+void AABBTree::remove(const Collider* collider){
+
+	// Static collider, its leaf is kept without a collider until the static tree is rebuilt
+	auto s = std::find(staticColliders_.begin(), staticColliders_.end(), collider);
+
+	if(s != staticColliders_.end()){
+		staticColliders_.erase(s);
+		staticChanged_ = true;
+
+		for(int node = 0; node < (int)staticNodes_.size(); node++){
+			if(!staticNodes_[node].isLeaf() || staticNodes_[node].collider != collider)
+				continue;
+
+			for(int i = (int)staticPairs_.size() - 1; i >= 0; i--)
+				if(staticPairs_[i].node2 == node)
+					removeStaticPair(i);
+
+			staticNodes_[node].collider = nullptr;
+		}
 
-	if(node->child2->isLeaf()){
-		if(node->child2->aabb->collider == collider)
-			removeNode(node->child2);
 		return;
 	}
-	else
-		remove(collider, node->child2);
+
+	if(root_ == NTW_AABB_NULL_NODE)
+		return;
+
+	// Search for and remove collider node
+	int node = findLeaf(collider, root_);
+
+	if(node == NTW_AABB_NULL_NODE)
+		return;
+
+	// Remove pairs of node
+	for(int i = (int)pairs_.size() - 1; i >= 0; i--)
+		if(pairs_[i].node1 == node || pairs_[i].node2 == node)
+			removePair(i);
+
+	for(int i = (int)staticPairs_.size() - 1; i >= 0; i--)
+		if(staticPairs_[i].node1 == node)
+			removeStaticPair(i);
+
+	if(nodes_[node].moved)
+		moved_.erase(std::find(moved_.begin(), moved_.end(), node));
+
+	removeNode(node);
 }
 
-void AABBTree::removeNode(Node* node, bool deleteNode){
+int AABBTree::findLeaf(const Collider* collider, int node) const{
+
+	const Node& n = nodes_[node];
+
+	if(n.isLeaf())
+		return n.collider == collider ? node : NTW_AABB_NULL_NODE;
+
+	// Recursively check children
+	int leaf = findLeaf(collider, n.child1);
+
+	if(leaf == NTW_AABB_NULL_NODE)
+		leaf = findLeaf(collider, n.child2);
+
+	return leaf;
+}
+
+void AABBTree::removeNode(int node, bool release){
+
+	int parent = nodes_[node].parent;
 
 	// Node is root
-	if(!node->parent){
-		root_ = nullptr;
+	if(parent == NTW_AABB_NULL_NODE){
+		root_ = NTW_AABB_NULL_NODE;
 
-		if(deleteNode)
-			delete node;
+		if(release)
+			freeNode(node);
 
 		return;
 	}
 
 	// Get sibling
-	Node* sibling = node->parent->child1;
-
-	if(node->parent->child1 == node)
-		sibling = node->parent->child2;
+	int sibling = nodes_[parent].child1 == node ? nodes_[parent].child2 : nodes_[parent].child1;
+	int grandparent = nodes_[parent].parent;
 
 
 	// Node has grandparent
-	if(node->parent->parent){
-		sibling->parent = node->parent->parent;
-		
+	if(grandparent != NTW_AABB_NULL_NODE){
+		nodes_[sibling].parent = grandparent;
+
 		// Replace grandparent child
-		if(sibling->parent->child1 == node->parent)
-			sibling->parent->child1 = sibling;
+		if(nodes_[grandparent].child1 == parent)
+			nodes_[grandparent].child1 = sibling;
 		else
-			sibling->parent->child2 = sibling;
+			nodes_[grandparent].child2 = sibling;
+
+		// Shrink and rebalance ancestors
+		refitAncestors(grandparent);
 	}
 
 	// Parent is root
 	else{
 		root_ = sibling;
-		sibling->parent = nullptr;
+		nodes_[sibling].parent = NTW_AABB_NULL_NODE;
 	}
 
-	delete node->parent;
+	freeNode(parent);
 
-	if(deleteNode)
-		delete node;
+	if(release)
+		freeNode(node);
 	else
-		node->parent = nullptr;
+		nodes_[node].parent = NTW_AABB_NULL_NODE;
 }
 
 
-const vector<AABBPair>& AABBTree::getOverlapping(){
+void AABBTree::updatePairs(bool staticRebuilt){
 
+	// Remove pairs that no longer overlap, which requires one of the leaves to have moved
+	for(int i = 0; i < (int)pairs_.size();){
+		const Node& n1 = nodes_[pairs_[i].node1];
+		const Node& n2 = nodes_[pairs_[i].node2];
+
+		if((n1.moved || n2.moved) && !overlapping(n1.getMarginAABB(), n2.getMarginAABB()))
+			removePair(i);
+		else
+			i++;
+	}
+
+	// Every pair is checked again with a rebuilt static tree, since static colliders have new AABBs
+	for(int i = 0; i < (int)staticPairs_.size();){
+		const Node& n = nodes_[staticPairs_[i].node1];
+
+		if((n.moved || staticRebuilt) && !overlapping(n.getMarginAABB(), staticNodes_[staticPairs_[i].node2].aabb))
+			removeStaticPair(i);
+		else
+			i++;
+	}
+
+	// Find new pairs of moved leaves
+	for(int node : moved_)
+		queryPairs(node);
+
+	// Mark branches above moved leaves, pairs with the static tree are only searched for below them
+	for(int node : moved_)
+		for(int p = nodes_[node].parent; p != NTW_AABB_NULL_NODE && !nodes_[p].moved; p = nodes_[p].parent)
+			nodes_[p].moved = true;
+
+	// Every leaf is paired again with a rebuilt static tree
+	queryStaticPairs(staticRebuilt);
+
+	for(int node : moved_)
+		for(int n = node; n != NTW_AABB_NULL_NODE && nodes_[n].moved; n = nodes_[n].parent)
+			nodes_[n].moved = false;
+
+	moved_.clear();
+
+
+	// Collect pairs with overlapping AABBs
 	overlapping_.clear();
 
-	// No root or root is leaf, return
-	if(!root_ || root_->isLeaf())
-		return overlapping_;
+	for(const LeafPair& p : pairs_){
+		const Node& n1 = nodes_[p.node1];
+		const Node& n2 = nodes_[p.node2];
 
+		if(overlapping(n1.aabb, n2.aabb))
+			overlapping_.push_back({n1.collider, n2.collider});
+	}
 
-	// Reset branch checked flags for entire tree
-	resetBranchChecked(root_);
+	for(const LeafPair& p : staticPairs_){
+		const Node& n = nodes_[p.node1];
+		const Node& s = staticNodes_[p.node2];
 
-	// Check tree recusively
-	checkOverlap(root_->child1, root_->child2);
+		if(overlapping(n.aabb, s.aabb))
+			overlapping_.push_back({n.collider, s.collider});
+	}
+}
 
-	return overlapping_;
+void AABBTree::queryPairs(int leaf){
+
+	const Node& l = nodes_[leaf];
+	const AABB& aabb = l.getMarginAABB();
+
+	queryStack_.clear();
+	queryStack_.push_back(root_);
+
+	while(!queryStack_.empty()){
+
+		int node = queryStack_.back();
+		queryStack_.pop_back();
+
+		const Node& n = nodes_[node];
+
+		// Portal leaves can skip branches with only portal leaves
+		if((l.isStatic && n.isStatic) || !overlapping(n.getMarginAABB(), aabb))
+			continue;
+
+		if(!n.isLeaf()){
+			queryStack_.push_back(n.child1);
+			queryStack_.push_back(n.child2);
+		}
+		else if(node != leaf && canPair(leaf, node))
+			addPair(leaf, node);
+	}
 }
 
-void AABBTree::resetBranchChecked(Node* node){
-	node->branchChecked = false;
+void AABBTree::addPair(int node1, int node2){
+
+	// Skip pairs that already exist, pairs between two moved leaves are found twice
+	if(!pairIndices_.emplace(getPairKey(node1, node2), (int)pairs_.size()).second)
+		return;
 
-	if(!node->isLeaf()){
-		if(!node->child1->isLeaf()) resetBranchChecked(node->child1);
-		if(!node->child2->isLeaf()) resetBranchChecked(node->child2);
+	pairs_.push_back({node1, node2});
+	addedPairs_.push_back({nodes_[node1].collider, nodes_[node2].collider});
+}
+
+void AABBTree::removePair(int index){
+
+	const LeafPair& p = pairs_[index];
+
+	removedPairs_.push_back({nodes_[p.node1].collider, nodes_[p.node2].collider});
+	pairIndices_.erase(getPairKey(p.node1, p.node2));
+
+	// Move last pair into the removed pair's place
+	if(index != (int)pairs_.size() - 1){
+		pairs_[index] = pairs_.back();
+		pairIndices_[getPairKey(pairs_[index].node1, pairs_[index].node2)] = index;
 	}
+
+	pairs_.pop_back();
 }
 
-void AABBTree::checkOverlap(Node* node1, Node* node2){
+bool AABBTree::canPair(int node1, int node2) const{
 
-	// Two leaf nodes
-	if(node1->isLeaf() && node2->isLeaf()){
+	const Node& n1 = nodes_[node1];
+	const Node& n2 = nodes_[node2];
 
-		// Add to list if overlapping
-		if(overlapping(node1->aabb, node2->aabb))
-			overlapping_.push_back({*node1->aabb, *node2->aabb});
+	// Disable overlaps between AABBs belonging to the same object
+	if(n1.collider && n2.collider &&
+		n1.collider->parent && n2.collider->parent &&
+		n1.collider->parent == n2.collider->parent)
+		return false;
 
-		return;
+	// Disable overlaps between two portal AABBs
+	return !(n1.isStatic && n2.isStatic);
+}
+
+uint64_t AABBTree::getPairKey(int node1, int node2){
+
+	// Key is the same for either order
+	if(node1 > node2)
+		std::swap(node1, node2);
+
+	return ((uint64_t)node1 << 32) | (uint32_t)node2;
+}
+
+bool AABBTree::overlapping(const AABB& a, const AABB& b){
+
+	// Check if AABBs are not overlapping on each axis
+	for(int i = 0; i < 3; i++)
+		if(a.lowerBound[i] > b.upperBound[i] || b.lowerBound[i] > a.upperBound[i])
+			return false;
+
+	return true;
+}
+
+
+float AABBTree::castRay(const AABB& aabb, const Vec3& position, const Vec3& invDirection, float maxDistance){
+
+	float enter = 0;
+	float exit = maxDistance;
+
+	// Intersect distances between each pair of slabs
+	for(int i = 0; i < 3; i++){
+		float t1 = (aabb.lowerBound[i] - position[i]) * invDirection[i];
+		float t2 = (aabb.upperBound[i] - position[i]) * invDirection[i];
+
+		if(t1 > t2)
+			std::swap(t1, t2);
+
+		enter = max(enter, t1);
+		exit = min(exit, t2);
+
+		if(enter > exit)
+			return -1;
 	}
 
-	// Check overlaps in children
-	if(!node1->isLeaf() && !node1->branchChecked){
-		checkOverlap(node1->child1, node1->child2);
-		node1->branchChecked = true;
+	return enter;
+}
+
+float AABBTree::castBox(const vector<Node>& nodes, int root, const Vec3& position, const Vec3& extents, const Vec3& invDirection, float maxDistance,
+	const std::function<float(const Collider*)>& callback){
+
+	if(root == NTW_AABB_NULL_NODE)
+		return maxDistance;
+
+	// Box touches a node when its center is inside the node grown by the box's extents
+	auto l_cast = [&](const AABB& aabb) -> float {
+		AABB grown = {aabb.upperBound + extents, aabb.lowerBound - extents};
+		return castRay(grown, position, invDirection, maxDistance);
+	};
+
+	QueryStack<int> stack;
+	stack.push(root);
+
+	while(!stack.empty()){
+
+		int node = stack.pop();
+
+		const Node& n = nodes[node];
+
+		if(l_cast(n.aabb) < 0)
+			continue;
+
+		if(n.isLeaf()){
+
+			// Static leaves of removed colliders are skipped until the static tree is rebuilt
+			if(n.collider)
+				maxDistance = callback(n.collider);
+
+			continue;
+		}
+
+		// Visit the nearer child first so its hits can skip the further child
+		float distance1 = l_cast(nodes[n.child1].aabb);
+		float distance2 = l_cast(nodes[n.child2].aabb);
+
+		int near	= distance1 <= distance2 ? n.child1 : n.child2;
+		int far		= distance1 <= distance2 ? n.child2 : n.child1;
+
+		if(max(distance1, distance2) >= 0)
+			stack.push(far);
+
+		if(min(distance1, distance2) >= 0)
+			stack.push(near);
 	}
 
-	if(!node2->isLeaf() && !node2->branchChecked){
-		checkOverlap(node2->child1, node2->child2);
-		node2->branchChecked = true;
+	return maxDistance;
+}
+
+void AABBTree::queryAABB(const vector<Node>& nodes, int root, const AABB& aabb, const std::function<void(const Collider*)>& callback){
+
+	if(root == NTW_AABB_NULL_NODE)
+		return;
+
+	QueryStack<int> stack;
+	stack.push(root);
+
+	while(!stack.empty()){
+
+		int node = stack.pop();
+
+		const Node& n = nodes[node];
+
+		if(!overlapping(n.aabb, aabb))
+			continue;
+
+		if(n.isLeaf()){
+			if(n.collider)
+				callback(n.collider);
+		}
+		else{
+			stack.push(n.child2);
+			stack.push(n.child1);
+		}
 	}
+}
+
+void AABBTree::querySphere(const vector<Node>& nodes, int root, const Vec3& center, float radius, const std::function<void(const Collider*)>& callback){
+
+	if(root == NTW_AABB_NULL_NODE)
+		return;
+
+	QueryStack<int> stack;
+	stack.push(root);
+
+	while(!stack.empty()){
+
+		int node = stack.pop();
 
+		const Node& n = nodes[node];
 
-	// Check overlaps between children
-	if(!node1->isLeaf()){
-		if(!node2->isLeaf()){
-			// Both nodes are branches, check them against each other
-			checkOverlap(node1->child1, node2->child1);
-			checkOverlap(node1->child1, node2->child2);
-			checkOverlap(node1->child2, node2->child1);
-			checkOverlap(node1->child2, node2->child2);
+		// Squared distance from the center to the closest point of the AABB
+		float distance2 = 0;
+
+		for(int i = 0; i < 3; i++){
+			float d = max(n.aabb.lowerBound[i] - center[i], 0.0f) + max(center[i] - n.aabb.upperBound[i], 0.0f);
+			distance2 += d * d;
+		}
+
+		if(distance2 > radius * radius)
+			continue;
+
+		if(n.isLeaf()){
+			if(n.collider)
+				callback(n.collider);
 		}
 		else{
-			checkOverlap(node1->child1, node2);
-			checkOverlap(node1->child2, node2);
+			stack.push(n.child2);
+			stack.push(n.child1);
 		}
 	}
-	else{
-		checkOverlap(node1, node2->child1);
-		checkOverlap(node1, node2->child2);
+}
+
+void AABBTree::castRays(const vector<Node>& nodes, int root, const Vec3* positions, const Vec3* invDirections, float* maxDistances, int numRays,
+	vector<int>& indices, const std::function<float(int, const Collider*)>& callback){
+
+	if(root == NTW_AABB_NULL_NODE)
+		return;
+
+	indices.resize(numRays);
+
+	for(int i = 0; i < numRays; i++)
+		indices[i] = i;
+
+	QueryStack<RayStackEntry> stack;
+	stack.push({root, 0, numRays});
+
+	while(!stack.empty()){
+
+		RayStackEntry entry = stack.pop();
+
+		// Ray lists after this entry's belong to subtrees that have been visited
+		indices.resize(entry.start + entry.count);
+
+		const Node& n = nodes[entry.node];
+
+		// Rays that reach this node, children share the list
+		int start = (int)indices.size();
+
+		for(int i = entry.start; i < entry.start + entry.count; i++){
+			int ray = indices[i];
+
+			if(castRay(n.aabb, positions[ray], invDirections[ray], maxDistances[ray]) >= 0)
+				indices.push_back(ray);
+		}
+
+		int count = (int)indices.size() - start;
+
+		if(count == 0)
+			continue;
+
+		if(n.isLeaf()){
+			if(n.collider)
+				for(int i = start; i < start + count; i++)
+					maxDistances[indices[i]] = callback(indices[i], n.collider);
+
+			continue;
+		}
+
+		stack.push({n.child2, start, count});
+		stack.push({n.child1, start, count});
 	}
 }
 
-bool AABBTree::overlapping(AABB* aabb1, AABB* aabb2){
 
-	// Disable overlaps between AABBs belonging to the same object
-	if(aabb1->collider && aabb2->collider &&
-		aabb1->collider->parent && aabb2->collider->parent &&
-		aabb1->collider->parent == aabb2->collider->parent)
-		return false;
+void AABBTree::castBox(const Vec3& position, const Vec3& extents, const Vec3& direction, float maxDistance, const std::function<float(const Collider*)>& callback) const{
 
-	// Disable overlaps between two static object AABBs
-	if(aabb1->isStatic && aabb2->isStatic)
-		return false;
+	// Axes the ray does not move along have infinite slab distances
+	Vec3 invDirection(1 / direction[0], 1 / direction[1], 1 / direction[2]);
 
-	// Check if AABBs are not overlapping on each axis
-	for(int i = 0; i < 3; i++)
-		if(aabb1->lowerBound[i] > aabb2->upperBound[i] || aabb2->lowerBound[i] > aabb1->upperBound[i])
-			return false;
+	// Hits in the static tree shorten the cast through the dynamic tree
+	maxDistance = castBox(staticNodes_, staticRoot_, position, extents, invDirection, maxDistance, callback);
+	castBox(nodes_, root_, position, extents, invDirection, maxDistance, callback);
+}
 
-	return true;
+void AABBTree::castRay(const Vec3& position, const Vec3& direction, float maxDistance, const std::function<float(const Collider*)>& callback) const{
+	castBox(position, Vec3(), direction, maxDistance, callback);
+}
+
+void AABBTree::castAABB(const AABB& aabb, const Vec3& sweep, const std::function<float(const Collider*)>& callback) const{
+	Vec3 center = (aabb.lowerBound + aabb.upperBound) / 2;
+	castBox(center, aabb.upperBound - center, sweep, 1, callback);
+}
+
+void AABBTree::castRays(const Vec3* positions, const Vec3* directions, float* maxDistances, int numRays,
+	const std::function<float(int, const Collider*)>& callback) const{
+
+	if(numRays == 0)
+		return;
+
+	// Traversal state is local, so callbacks can start other queries
+	vector<Vec3> invDirections(numRays);
+	vector<int> indices;
+
+	for(int i = 0; i < numRays; i++)
+		invDirections[i] = Vec3(1 / directions[i][0], 1 / directions[i][1], 1 / directions[i][2]);
+
+	castRays(staticNodes_, staticRoot_, positions, invDirections.data(), maxDistances, numRays, indices, callback);
+	castRays(nodes_, root_, positions, invDirections.data(), maxDistances, numRays, indices, callback);
+}
+
+void AABBTree::queryAABB(const AABB& aabb, const std::function<void(const Collider*)>& callback) const{
+	queryAABB(staticNodes_, staticRoot_, aabb, callback);
+	queryAABB(nodes_, root_, aabb, callback);
+}
+
+void AABBTree::querySphere(const Vec3& center, float radius, const std::function<void(const Collider*)>& callback) const{
+	querySphere(staticNodes_, staticRoot_, center, radius, callback);
+	querySphere(nodes_, root_, center, radius, callback);
+}
+
+
+const vector<AABBPair>& AABBTree::getOverlapping() const{
+	return overlapping_;
+}
+
+const vector<AABBPair>& AABBTree::getAddedPairs() const{
+	return addedPairs_;
+}
+
+const vector<AABBPair>& AABBTree::getRemovedPairs() const{
+	return removedPairs_;
 }
@@ -4,25 +4,63 @@
  *	aabbTree.h
  *
  *	Dynamic AABB tree for collision broadphase.
+ *	Colliders of static objects are built top-down into a separate tree that never changes,
+ *	it is rebuilt in the update after static colliders are added or removed, such as after loading a level.
+ *	The incremental tree only holds colliders of moving objects and portals.
+ *	Nodes are stored in a contiguous pool and refer to each other by index.
+ *	Leaves are inserted next to the sibling with the lowest surface area cost,
+ *	and ancestors are rotated to keep the tree balanced.
+ *	Overlapping leaf pairs persist between updates, only leaves that have been
+ *	re-inserted or added are queried against the tree for new pairs.
+ *	Pairs with static colliders are found by traversing both trees together below the moved leaves.
+ *	Leaves of fast objects with continuous collision cover their whole motion over the update.
+ *	Rays are traversed with slab tests, groups of rays share one traversal of the tree.
+ *	Swept AABBs are traversed as rays against nodes grown by the AABB's extents.
+ *	Overlap queries visit every leaf touching an AABB or sphere.
+ *	Queries keep their traversal state on the caller's stack, so callbacks can start
+ *	other queries, and queries can run on several threads while the tree is not being changed.
  *
  */
 
 #include"physics/physStruct.h"
 #include"objects/collider.h"
+#include<unordered_map>
+#include<functional>
+#include<cstdint>
+
+using std::unordered_map;
+
+
+// Index of a missing node
+#define NTW_AABB_NULL_NODE -1
+
+// Entries a query keeps in place before its traversal stack moves to the heap
+#define NTW_AABB_QUERY_STACK_SIZE 64
 
 
 struct AABB{
-	const Collider* collider;
 	Vec3 upperBound;
 	Vec3 lowerBound;
-	bool isStatic;
-
-	AABB() : collider(nullptr) {}
 };
 
 struct AABBPair{
-	AABB& aabb1;
-	AABB& aabb2;
+	const Collider* collider1;
+	const Collider* collider2;
+};
+
+// Measures of how well the tree is balanced
+// Internal area is the surface area cost of the tree, lower is better
+struct AABBTreeQuality{
+	float internalArea;
+	float rootArea;
+	int maxDepth;
+	int numLeaves;
+
+	// Static tree
+	int staticMaxDepth;
+	int numStaticLeaves;
+
+	AABBTreeQuality() : internalArea(0), rootArea(0), maxDepth(0), numLeaves(0), staticMaxDepth(0), numStaticLeaves(0) {}
 };
 
 
@@ -30,46 +68,205 @@ class AABBTree{
 
 public:
 	struct Node{
-		AABB* aabb;
-		AABB* aabbMargin;
-		Node* parent;
-		Node* child1;
-		Node* child2;
-		bool branchChecked;
-
-		Node() : aabb(new AABB()), aabbMargin(nullptr), parent(nullptr), child1(nullptr), child2(nullptr), branchChecked(false) {}
-
-		~Node(){
-			delete aabb;
-			delete aabbMargin;
+		AABB aabb;
+
+		// Enlarged AABB, only used by dynamic leaves
+		AABB aabbMargin;
+
+		// Leaf collider
+		const Collider* collider;
+
+		int parent;
+		int child1;
+		int child2;
+
+		// Leaves have height 0
+		int height;
+
+		bool isStatic;
+		bool hasMargin;
+
+		// Leaf has been added or re-inserted since the last update
+		// Branches above moved leaves are marked while finding pairs with the static tree
+		bool moved;
+
+		Node() : collider(nullptr), parent(NTW_AABB_NULL_NODE), child1(NTW_AABB_NULL_NODE), child2(NTW_AABB_NULL_NODE),
+			height(0), isStatic(false), hasMargin(false), moved(false) {}
+
+		bool isLeaf() const{
+			return child1 == NTW_AABB_NULL_NODE;
 		}
 
-		bool isLeaf(){
-			return child1 == nullptr;
+		// Enlarged AABB if the node has one
+		const AABB& getMarginAABB() const{
+			return hasMargin ? aabbMargin : aabb;
 		}
 	};
 
 
 private:
-	Node* root_;
+	// Node to visit during sibling search, with the area its ancestors would grow by
+	struct SearchEntry{
+		int node;
+		float inheritedCost;
+	};
+
+	// Node to visit with a group of rays, rays that reached the node are indices[start] up to indices[start + count]
+	struct RayStackEntry{
+		int node;
+		int start;
+		int count;
+	};
+
+	// Traversal stack of a query, kept in place up to a fixed size then continued on the heap
+	template<class T>
+	class QueryStack{
+		T fixed_[NTW_AABB_QUERY_STACK_SIZE];
+		vector<T> heap_;
+		int size_;
+
+	public:
+		QueryStack() : size_(0) {}
+
+		void push(const T& entry){
+			if(size_ < NTW_AABB_QUERY_STACK_SIZE)
+				fixed_[size_] = entry;
+			else
+				heap_.push_back(entry);
+
+			size_++;
+		}
+
+		T pop(){
+			size_--;
+
+			if(size_ < NTW_AABB_QUERY_STACK_SIZE)
+				return fixed_[size_];
+
+			T entry = heap_.back();
+			heap_.pop_back();
+			return entry;
+		}
+
+		bool empty() const{
+			return size_ == 0;
+		}
+	};
+
+	// Leaves with overlapping enlarged AABBs
+	struct LeafPair{
+		int node1;
+		int node2;
+	};
+
+	// Static colliders with centers in part of the range being split while building the static tree
+	struct BuildBin{
+		AABB aabb;
+		int count;
+	};
+
+	// Node pool, free nodes are linked through their parent index
+	vector<Node> nodes_;
+	int freeList_;
+
+	int root_;
+	vector<int> invalid_;
+	vector<SearchEntry> searchStack_;
+
+	// Persistent pairs, indexed by a key made from both leaf indices
+	vector<LeafPair> pairs_;
+	unordered_map<uint64_t, int> pairIndices_;
+
+	// Leaves to query for new pairs in the next update
+	vector<int> moved_;
+	vector<int> queryStack_;
+
+	// Static object colliders, and the tree built from them with one collider per leaf
+	// Leaves of colliders removed since the tree was built have no collider
+	vector<const Collider*> staticColliders_;
+	vector<Node> staticNodes_;
+	int staticRoot_;
+	bool staticChanged_;
+
+	// Order, AABBs and centers of static colliders while building
+	vector<int> buildIndices_;
+	vector<AABB> buildAABBs_;
+	vector<Vec3> buildCenters_;
+
+	// Persistent pairs of a leaf of this tree and a leaf of the static tree
+	vector<LeafPair> staticPairs_;
+	unordered_map<uint64_t, int> staticPairIndices_;
+
+	// Node of this tree and node of the static tree to visit while finding pairs between them
+	vector<LeafPair> pairStack_;
+
+	// Pairs with overlapping AABBs in the last update
 	vector<AABBPair> overlapping_;
-	vector<Node*> invalid_;
 
+	// Pairs added and removed by the last update
+	// Pairs removed with their colliders are added by remove(), until the next update
+	vector<AABBPair> addedPairs_;
+	vector<AABBPair> removedPairs_;
+
+
+	int allocateNode();
+	void freeNode(int node);
 
-	void updateNode(Node* node);
-	void updateAABB(Node* node);
+	void updateNode(int node);
+	void updateAABB(int node);
 
-	void clear(Node* node);
+	// World AABB of an object collider's scaled hitbox
+	static void getColliderAABB(const Collider* collider, AABB& aabb);
 
-	void addNode(Node* node, Node* parent);
+	void insertLeaf(int leaf);
+	int findBestSibling(const AABB& aabb);
 
-	void remove(const Collider* collider, Node* node);
-	void removeNode(Node* node, bool deleteNode = true);
+	// Refit and rotate nodes from given node up to the root
+	void refitAncestors(int node);
+	int balance(int node);
+	int rotate(int node, int child);
 
+	int findLeaf(const Collider* collider, int node) const;
+	void removeNode(int node, bool release = true);
 
-	void resetBranchChecked(Node* node);
-	void checkOverlap(Node* node1, Node* node2);
-	bool overlapping(AABB* aabb1, AABB* aabb2);
+	static AABB combine(const AABB& a, const AABB& b);
+	static float getArea(const AABB& aabb);
+
+
+	void updatePairs(bool staticRebuilt);
+	void queryPairs(int leaf);
+	void addPair(int node1, int node2);
+	void removePair(int index);
+	bool canPair(int node1, int node2) const;
+
+	static uint64_t getPairKey(int node1, int node2);
+	static bool overlapping(const AABB& a, const AABB& b);
+
+	// Static tree (in aabbTreeStatic.cpp)
+	// Build the static tree with binned surface area heuristic splits, moving pairs to the new leaves
+	void buildStatic();
+	int buildStaticNode(int start, int end);
+
+	// Find pairs between both trees, below moved leaves or for every leaf
+	void queryStaticPairs(bool allLeaves);
+	void addStaticPair(int node, int staticNode);
+	void removeStaticPair(int index);
+
+	static uint64_t getStaticPairKey(int node, int staticNode);
+
+	// Distance at which a ray enters an AABB, -1 if it misses within the maximum distance
+	static float castRay(const AABB& aabb, const Vec3& position, const Vec3& invDirection, float maxDistance);
+
+	// Visit leaves touched by a box with the given extents moving along a ray
+	void castBox(const Vec3& position, const Vec3& extents, const Vec3& direction, float maxDistance, const std::function<float(const Collider*)>& callback) const;
+
+	// Queries of either tree, ray queries return the maximum distance after visiting the tree
+	static float castBox(const vector<Node>& nodes, int root, const Vec3& position, const Vec3& extents, const Vec3& invDirection, float maxDistance,
+		const std::function<float(const Collider*)>& callback);
+	static void castRays(const vector<Node>& nodes, int root, const Vec3* positions, const Vec3* invDirections, float* maxDistances, int numRays,
+		vector<int>& indices, const std::function<float(int, const Collider*)>& callback);
+	static void queryAABB(const vector<Node>& nodes, int root, const AABB& aabb, const std::function<void(const Collider*)>& callback);
+	static void querySphere(const vector<Node>& nodes, int root, const Vec3& center, float radius, const std::function<void(const Collider*)>& callback);
 
 public:
 	AABBTree();
@@ -77,8 +274,35 @@ public:
 	void update();
 	void clear();
 
+	// Static colliders are found by pairs and queries after the next update
+	// Pairs of a removed collider are reported as removed immediately
 	void add(const Collider* collider);
 	void remove(const Collider* collider);
 
-	const vector<AABBPair>& getOverlapping();
+	// Visit leaves whose AABBs a ray passes through, nearer children first
+	// Callback returns the ray's new maximum distance, so leaves behind the closest hit found so far are skipped
+	// Callbacks of any query can start other queries, but must not change the tree
+	void castRay(const Vec3& position, const Vec3& direction, float maxDistance, const std::function<float(const Collider*)>& callback) const;
+
+	// Visit leaves whose AABBs overlap an AABB or a sphere
+	void queryAABB(const AABB& aabb, const std::function<void(const Collider*)>& callback) const;
+	void querySphere(const Vec3& center, float radius, const std::function<void(const Collider*)>& callback) const;
+
+	// Visit leaves an AABB touches moving along a sweep, callback returns the new maximum fraction of the sweep
+	void castAABB(const AABB& aabb, const Vec3& sweep, const std::function<float(const Collider*)>& callback) const;
+
+	// Visit leaves for a group of rays in one traversal, maximum distances are updated with the callback's results
+	// Callback is given the index of the ray and the leaf collider
+	void castRays(const Vec3* positions, const Vec3* directions, float* maxDistances, int numRays,
+		const std::function<float(int, const Collider*)>& callback) const;
+
+	const vector<AABBPair>& getOverlapping() const;
+	const vector<AABBPair>& getAddedPairs() const;
+
+	// Pairs removed by the last update, followed by pairs removed with their colliders since then
+	// Colliders of pairs removed by remove() are only valid until their owner is destroyed,
+	// read them before deleting the owner, or compare the pointers without dereferencing them
+	const vector<AABBPair>& getRemovedPairs() const;
+
+	AABBTreeQuality getQuality() const;
 };
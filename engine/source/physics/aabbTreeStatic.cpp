@@ -0,0 +1,232 @@
+#include"aabbTree.h"
+
+#include"physics/physDefine.h"
+#include<algorithm>
+
+using std::min;
+using std::max;
+
+
+void AABBTree::buildStatic(){
+
+	// Static collider of each pair, pairs are moved to the collider's leaf in the new tree
+	// Pairs of removed colliders were removed with them, so every pair's collider is still in the tree
+	vector<const Collider*> pairColliders(staticPairs_.size());
+
+	for(int i = 0; i < (int)staticPairs_.size(); i++)
+		pairColliders[i] = staticNodes_[staticPairs_[i].node2].collider;
+
+	staticNodes_.clear();
+	staticRoot_ = NTW_AABB_NULL_NODE;
+	staticChanged_ = false;
+
+	int numColliders = (int)staticColliders_.size();
+
+	if(numColliders == 0)
+		return;
+
+	buildIndices_.resize(numColliders);
+	buildAABBs_.resize(numColliders);
+	buildCenters_.resize(numColliders);
+
+	for(int i = 0; i < numColliders; i++){
+		buildIndices_[i] = i;
+		getColliderAABB(staticColliders_[i], buildAABBs_[i]);
+		buildCenters_[i] = (buildAABBs_[i].lowerBound + buildAABBs_[i].upperBound) / 2;
+	}
+
+	// One collider per leaf, so the tree has a known number of nodes
+	staticNodes_.reserve(2 * numColliders - 1);
+	staticRoot_ = buildStaticNode(0, numColliders);
+
+	// Move pairs to their new leaves without reporting them again
+	// Pairs that no longer overlap are removed, and new pairs added, when all leaves are paired again
+	unordered_map<const Collider*, int> leaves;
+
+	for(int node = 0; node < (int)staticNodes_.size(); node++)
+		if(staticNodes_[node].isLeaf())
+			leaves[staticNodes_[node].collider] = node;
+
+	staticPairIndices_.clear();
+
+	for(int i = 0; i < (int)staticPairs_.size(); i++){
+		staticPairs_[i].node2 = leaves[pairColliders[i]];
+		staticPairIndices_[getStaticPairKey(staticPairs_[i].node1, staticPairs_[i].node2)] = i;
+	}
+}
+
+int AABBTree::buildStaticNode(int start, int end){
+
+	int node = (int)staticNodes_.size();
+	staticNodes_.emplace_back();
+	staticNodes_[node].isStatic = true;
+
+	// Single collider, node is leaf
+	if(end - start == 1){
+		staticNodes_[node].collider = staticColliders_[buildIndices_[start]];
+		staticNodes_[node].aabb = buildAABBs_[buildIndices_[start]];
+		return node;
+	}
+
+	// Bounds of the colliders, and of their centers
+	AABB bounds = buildAABBs_[buildIndices_[start]];
+	AABB centerBounds = {buildCenters_[buildIndices_[start]], buildCenters_[buildIndices_[start]]};
+
+	for(int i = start + 1; i < end; i++){
+		const Vec3& center = buildCenters_[buildIndices_[i]];
+		bounds = combine(bounds, buildAABBs_[buildIndices_[i]]);
+
+		for(int j = 0; j < 3; j++){
+			centerBounds.lowerBound[j] = min(centerBounds.lowerBound[j], center[j]);
+			centerBounds.upperBound[j] = max(centerBounds.upperBound[j], center[j]);
+		}
+	}
+
+	// Split along the axis the centers are spread furthest along
+	Vec3 spread = centerBounds.upperBound - centerBounds.lowerBound;
+	int axis = spread[0] > spread[1] ? (spread[0] > spread[2] ? 0 : 2) : (spread[1] > spread[2] ? 1 : 2);
+
+	// Centers in the same place can not be split, take half of the colliders
+	int mid = start + ((end - start) / 2);
+
+	if(spread[axis] > 0){
+
+		// Sort colliders into bins by their centers
+		BuildBin bins[NTW_AABB_STATIC_BINS];
+		float scale = NTW_AABB_STATIC_BINS / spread[axis];
+
+		auto l_bin = [&](int i) -> int {
+			return min(NTW_AABB_STATIC_BINS - 1, (int)((buildCenters_[i][axis] - centerBounds.lowerBound[axis]) * scale));
+		};
+
+		for(BuildBin& b : bins)
+			b.count = 0;
+
+		for(int i = start; i < end; i++){
+			BuildBin& b = bins[l_bin(buildIndices_[i])];
+			b.aabb = b.count == 0 ? buildAABBs_[buildIndices_[i]] : combine(b.aabb, buildAABBs_[buildIndices_[i]]);
+			b.count++;
+		}
+
+		// Cost of splitting after each bin is the area of each side times its number of colliders
+		// First and last bins hold the outermost centers, so both sides of every split have colliders
+		float costs[NTW_AABB_STATIC_BINS - 1];
+
+		AABB side;
+		int count = 0;
+
+		for(int i = 0; i < NTW_AABB_STATIC_BINS - 1; i++){
+			if(bins[i].count > 0){
+				side = count == 0 ? bins[i].aabb : combine(side, bins[i].aabb);
+				count += bins[i].count;
+			}
+
+			costs[i] = count == 0 ? 0 : getArea(side) * count;
+		}
+
+		count = 0;
+
+		for(int i = NTW_AABB_STATIC_BINS - 1; i > 0; i--){
+			if(bins[i].count > 0){
+				side = count == 0 ? bins[i].aabb : combine(side, bins[i].aabb);
+				count += bins[i].count;
+			}
+
+			costs[i - 1] += count == 0 ? 0 : getArea(side) * count;
+		}
+
+		int split = (int)(std::min_element(costs, costs + NTW_AABB_STATIC_BINS - 1) - costs);
+
+		mid = (int)(std::partition(buildIndices_.begin() + start, buildIndices_.begin() + end, [&](int i){
+			return l_bin(i) <= split;
+		}) - buildIndices_.begin());
+	}
+
+	// Children are built first, adding nodes may move this one
+	int child1 = buildStaticNode(start, mid);
+	int child2 = buildStaticNode(mid, end);
+
+	Node& n = staticNodes_[node];
+	n.child1 = child1;
+	n.child2 = child2;
+	n.aabb = bounds;
+	n.height = 1 + max(staticNodes_[child1].height, staticNodes_[child2].height);
+
+	staticNodes_[child1].parent = node;
+	staticNodes_[child2].parent = node;
+
+	return node;
+}
+
+
+void AABBTree::queryStaticPairs(bool allLeaves){
+
+	if(root_ == NTW_AABB_NULL_NODE || staticRoot_ == NTW_AABB_NULL_NODE || (!allLeaves && moved_.empty()))
+		return;
+
+	// Descend both trees together from their roots
+	pairStack_.clear();
+	pairStack_.push_back({root_, staticRoot_});
+
+	while(!pairStack_.empty()){
+
+		LeafPair p = pairStack_.back();
+		pairStack_.pop_back();
+
+		const Node& n = nodes_[p.node1];
+		const Node& s = staticNodes_[p.node2];
+
+		// Portals do not pair with static colliders, and leaves that have not moved already have their pairs
+		if(n.isStatic || (!allLeaves && !n.moved) || !overlapping(n.getMarginAABB(), s.aabb))
+			continue;
+
+		if(n.isLeaf() && s.isLeaf()){
+			if(s.collider)
+				addStaticPair(p.node1, p.node2);
+
+			continue;
+		}
+
+		// Descend into the larger node
+		if(s.isLeaf() || (!n.isLeaf() && getArea(n.getMarginAABB()) >= getArea(s.aabb))){
+			pairStack_.push_back({n.child1, p.node2});
+			pairStack_.push_back({n.child2, p.node2});
+		}
+		else{
+			pairStack_.push_back({p.node1, s.child1});
+			pairStack_.push_back({p.node1, s.child2});
+		}
+	}
+}
+
+void AABBTree::addStaticPair(int node, int staticNode){
+
+	// Skip pairs that already exist, moved leaves are searched again
+	if(!staticPairIndices_.emplace(getStaticPairKey(node, staticNode), (int)staticPairs_.size()).second)
+		return;
+
+	staticPairs_.push_back({node, staticNode});
+	addedPairs_.push_back({nodes_[node].collider, staticNodes_[staticNode].collider});
+}
+
+void AABBTree::removeStaticPair(int index){
+
+	const LeafPair& p = staticPairs_[index];
+
+	removedPairs_.push_back({nodes_[p.node1].collider, staticNodes_[p.node2].collider});
+	staticPairIndices_.erase(getStaticPairKey(p.node1, p.node2));
+
+	// Move last pair into the removed pair's place
+	if(index != (int)staticPairs_.size() - 1){
+		staticPairs_[index] = staticPairs_.back();
+		staticPairIndices_[getStaticPairKey(staticPairs_[index].node1, staticPairs_[index].node2)] = index;
+	}
+
+	staticPairs_.pop_back();
+}
+
+uint64_t AABBTree::getStaticPairKey(int node, int staticNode){
+
+	// Nodes are from different trees, so the order is kept
+	return ((uint64_t)node << 32) | (uint32_t)staticNode;
+}
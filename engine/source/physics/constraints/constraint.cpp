@@ -19,25 +19,19 @@ void Constraint::init(){
 	PhysicsObject* pObj2 = obj2Phys ? (PhysicsObject*)object2_ : nullptr;
 
 	if(firstSolve_){
-		// Initialize jacobian, it will be set by the specific constraint
-		jac_ = Matrix(1, 12);
-
-		vel_ = Matrix(12, 1);
-
 		// Inverted mass matrix (use zero matrix for immovable static and semi-dynamic objects)
 		// Individual mass values to speed up mass matrix multiplication
 		invMass1_ = obj1Dynamic ? pObj1->getMassInv() : 0;
 		invMass2_ = obj2Dynamic ? pObj2->getMassInv() : 0;
+		invInertia1_ = obj1Dynamic ? pObj1->getTInertiaInv() : Mat3::zero();
+		invInertia2_ = obj2Dynamic ? pObj2->getTInertiaInv() : Mat3::zero();
 	}
 
 	// Velocity vector
-	vel_.place(0, 0, obj1Phys ? pObj1->getVelocity()		: Vec3());
-	vel_.place(3, 0, obj1Phys ? pObj1->getAngularVelocity()	: Vec3());
-	vel_.place(6, 0, obj2Phys ? pObj2->getVelocity()		: Vec3());
-	vel_.place(9, 0, obj2Phys ? pObj2->getAngularVelocity()	: Vec3());
-
-	invInertia1_ = obj1Dynamic ? pObj1->getTInertiaInv() : Matrix(3, 3);
-	invInertia2_ = obj2Dynamic ? pObj2->getTInertiaInv() : Matrix(3, 3);
+	vel_.linear1	= obj1Phys ? pObj1->getVelocity()			: Vec3();
+	vel_.angular1	= obj1Phys ? pObj1->getAngularVelocity()	: Vec3();
+	vel_.linear2	= obj2Phys ? pObj2->getVelocity()			: Vec3();
+	vel_.angular2	= obj2Phys ? pObj2->getAngularVelocity()	: Vec3();
 }
 
 void Constraint::solve(){
@@ -55,7 +49,7 @@ void Constraint::solve(){
 
 bool Constraint::calcConstraint(){
 	// Calculate
-	constraint_ = (jac_ * vel_).get(0, 0) + bias_;
+	constraint_ = jac_ * vel_ + bias_;
 
 	// Return true if constraint is satisfied
 	return abs(constraint_) < NTW_PHYS_CONSTRAINT_THRESHOLD || (constrainGreaterThanZero_ && constraint_ > 0);
@@ -64,30 +58,18 @@ bool Constraint::calcConstraint(){
 void Constraint::calcInvMassJt(){
 
 	// Get inverse mass matrix times jacobian transpose
-	invMassJt_ = Matrix(12, 1);
-	invMassJt_.place(0, 0, Vec3(jac_.get(0, 0) * invMass1_, jac_.get(0, 1) * invMass1_, jac_.get(0, 2) * invMass1_));
-	invMassJt_.place(3, 0, invInertia1_ * Vec3(jac_.get(0, 3), jac_.get(0, 4), jac_.get(0, 5)));
-	invMassJt_.place(6, 0, Vec3(jac_.get(0, 6) * invMass2_, jac_.get(0, 7) * invMass2_, jac_.get(0, 8) * invMass2_));
-	invMassJt_.place(9, 0, invInertia2_ * Vec3(jac_.get(0, 9), jac_.get(0, 10), jac_.get(0, 11)));
-
-	/*
-	Matrix tmp = Matrix(12, 12);
-	tmp.set(0, 0, invMass1_);
-	tmp.set(1, 1, invMass1_);
-	tmp.set(2, 2, invMass1_);
-	tmp.place(3, 3, invInertia1_);
-	tmp.set(4, 4, invMass2_);
-	tmp.set(5, 5, invMass2_);
-	tmp.set(6, 6, invMass2_);
-	tmp.place(9, 9, invInertia2_);
-
-	Matrix tmp2 = tmp * jac_.getTranspose();
-	//invMassJt_ = tmp2;
-	*/
+	// Mass matrix is block diagonal, so apply each block separately
+	invMassJt_.linear1	= jac_.linear1 * invMass1_;
+	invMassJt_.angular1	= invInertia1_ * jac_.angular1;
+	invMassJt_.linear2	= jac_.linear2 * invMass2_;
+	invMassJt_.angular2	= invInertia2_ * jac_.angular2;
+
+	// Effective mass is constant while the jacobian is unchanged
+	effectiveMass_ = 1 / (jac_ * invMassJt_);
 }
 
 void Constraint::calcLambda(){
-	lambda_ = -constraint_ / ((jac_ * invMassJt_).get(0, 0));
+	lambda_ = -constraint_ * effectiveMass_;
 }
 
 void Constraint::calcVelCor(){
@@ -101,13 +83,13 @@ void Constraint::apply(){
 	// Apply corrective velocities if object is dymamic
 	if(object1_->getPhysicsType() == PhysicsType::RIGID_BODY){
 		PhysicsObject* obj = (PhysicsObject*)object1_;
-		obj->addVelocity(Vec3(velCor_.get(0, 0), velCor_.get(1, 0), velCor_.get(2, 0)));
-		obj->addAngularVelocity(Vec3(velCor_.get(3, 0), velCor_.get(4, 0), velCor_.get(5, 0)));
+		obj->addVelocity(velCor_.linear1);
+		obj->addAngularVelocity(velCor_.angular1);
 	}
 	if(object2_->getPhysicsType() == PhysicsType::RIGID_BODY){
 		PhysicsObject* obj = (PhysicsObject*)object2_;
-		obj->addVelocity(Vec3(velCor_.get(6, 0), velCor_.get(7, 0), velCor_.get(8, 0)));
-		obj->addAngularVelocity(Vec3(velCor_.get(9, 0), velCor_.get(10, 0), velCor_.get(11, 0)));
+		obj->addVelocity(velCor_.linear2);
+		obj->addAngularVelocity(velCor_.angular2);
 	}
 }
 
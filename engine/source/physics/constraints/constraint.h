@@ -11,11 +11,39 @@ class Constraint;
 
 #include"objects/physicsObject.h"
 #include"physics/physStruct.h"
+#include"math/mat3.h"
 #include<vector>
 
 using std::vector;
 
 
+// 12 dimensional vector split into linear and angular blocks for each object
+// Used for jacobians and velocities so solving does not require any allocation
+struct Vec12{
+	Vec3 linear1;
+	Vec3 angular1;
+	Vec3 linear2;
+	Vec3 angular2;
+
+	// Dot product
+	float operator*(const Vec12& a) const{
+		return linear1 * a.linear1 + angular1 * a.angular1 + linear2 * a.linear2 + angular2 * a.angular2;
+	}
+
+	Vec12 operator*(float a) const{
+		return {linear1 * a, angular1 * a, linear2 * a, angular2 * a};
+	}
+
+	Vec12& operator+=(const Vec12& a){
+		linear1 += a.linear1;
+		angular1 += a.angular1;
+		linear2 += a.linear2;
+		angular2 += a.angular2;
+		return *this;
+	}
+};
+
+
 class Constraint{
 protected:
 
@@ -25,26 +53,29 @@ protected:
 	// Individual mass values to speed up mass matrix multiplication
 	float invMass1_;
 	float invMass2_;
-	Matrix invInertia1_;
-	Matrix invInertia2_;
+	Mat3 invInertia1_;
+	Mat3 invInertia2_;
 
 	// Velocity vector
-	Matrix vel_;
+	Vec12 vel_;
 
 	// Jacobian
-	Matrix jac_;
+	Vec12 jac_;
 
 	// Constraint value
 	float constraint_;
 
 	// Inverse mass times jacobian
-	Matrix invMassJt_;
+	Vec12 invMassJt_;
+
+	// Inverse of jacobian times inverse mass times jacobian transpose
+	float effectiveMass_;
 	
 	// Lagrangian multiplied
 	float lambda_;
 
 	// Corrective velocity
-	Matrix velCor_;
+	Vec12 velCor_;
 
 	float bias_;
 
@@ -0,0 +1,347 @@
+#include"contactBatchSolver.h"
+
+#include"physics/physDefine.h"
+#include<algorithm>
+#include<xmmintrin.h>
+
+using std::max;
+
+
+// Number of colors tracked per body, constraints that do not fit are solved in batches of their own
+#define NTW_PHYS_BATCH_MAX_COLORS 64
+
+
+ContactBatchSolver::ContactBatchSolver() : numBodies_(0) {
+
+}
+
+int ContactBatchSolver::solve(ContactConstraint* constraints, const vector<int>& indices, const vector<PhysicsObject*>& objects){
+
+	// Copy body velocities, body 0 is left at zero
+	numBodies_ = (int)objects.size() + 1;
+
+	for(int k = 0; k < 6; k++)
+		velocities_[k].assign(numBodies_, 0.0f);
+
+	for(int i = 0; i < (int)objects.size(); i++){
+		PhysicsObject* obj = objects[i];
+		obj->setSolverIndex(i + 1);
+
+		const Vec3& vel = obj->getVelocity();
+		const Vec3& angVel = obj->getAngularVelocity();
+
+		for(int k = 0; k < 3; k++){
+			velocities_[k][i + 1]		= vel[k];
+			velocities_[k + 3][i + 1]	= angVel[k];
+		}
+	}
+
+	// Contact vectors, jacobians and effective masses are calculated once from positions after warm starting
+	for(int i : indices)
+		constraints[i].init();
+
+	colorConstraints(constraints, indices);
+
+
+	// Solve until no batch applies a noticeable impulse
+	int iter = 0;
+
+	do{
+		float maxLambda = solveBatches();
+		iter++;
+
+		if(maxLambda < NTW_PHYS_CONSTRAINT_THRESHOLD)
+			break;
+
+	} while(iter < NTW_PHYS_MAX_CONSTRAINT_ITER);
+
+
+	// Store accumulated impulses for warm starting
+	for(const ContactBatch& batch : batches_){
+		for(int lane = 0; lane < NTW_PHYS_BATCH_WIDTH; lane++){
+
+			if(batch.constraints[lane] == -1)
+				continue;
+
+			ContactConstraint& c = constraints[batch.constraints[lane]];
+			Contact& contact = c.contact_;
+
+			contact.lambdaSum		= batch.lambdaSum[0][lane];
+			contact.lambdaSumTan1	= batch.lambdaSum[1][lane];
+			contact.lambdaSumTan2	= batch.lambdaSum[2][lane];
+			contact.lambdaAvg		= batch.lambdaAvg[lane];
+			contact.numSolves		= (int)batch.numSolves[lane];
+			contact.closingSpeed	= batch.closingSpeed[lane];
+
+			c.firstSolve_ = false;
+		}
+	}
+
+	// Copy velocities back to dynamic objects
+	for(int i = 0; i < (int)objects.size(); i++){
+		PhysicsObject* obj = objects[i];
+
+		if(obj->getPhysicsType() != PhysicsType::RIGID_BODY)
+			continue;
+
+		obj->setVelocity(Vec3(velocities_[0][i + 1], velocities_[1][i + 1], velocities_[2][i + 1]));
+		obj->setAngularVelocity(Vec3(velocities_[3][i + 1], velocities_[4][i + 1], velocities_[5][i + 1]));
+		obj->tUpdatePhysics();
+	}
+
+	return iter;
+}
+
+int ContactBatchSolver::getBody(Object* object) const{
+	if(object->getPhysicsType() != PhysicsType::RIGID_BODY && object->getPhysicsType() != PhysicsType::SIMPLE)
+		return 0;
+
+	return ((PhysicsObject*)object)->getSolverIndex();
+}
+
+void ContactBatchSolver::colorConstraints(ContactConstraint* constraints, const vector<int>& indices){
+
+	int numConstraints = (int)indices.size();
+
+	bodyColors_.assign(numBodies_, 0);
+	constraintColors_.resize(numConstraints);
+
+	int colorCounts[NTW_PHYS_BATCH_MAX_COLORS + 1] = {};
+
+	// Only rigid bodies are changed by constraints, other bodies can be shared within a color
+	auto l_rigidBody = [this](Object* object) -> int {
+		return object->getPhysicsType() == PhysicsType::RIGID_BODY ? getBody(object) : 0;
+	};
+
+	// Give each constraint the first color neither of its bodies is used in
+	for(int i = 0; i < numConstraints; i++){
+		ObjectPair objects = constraints[indices[i]].getObjects();
+		int body1 = l_rigidBody(objects.object1);
+		int body2 = l_rigidBody(objects.object2);
+
+		unsigned long long used = bodyColors_[body1] | bodyColors_[body2];
+		int color = 0;
+
+		while(color < NTW_PHYS_BATCH_MAX_COLORS && (used & (1ull << color)))
+			color++;
+
+		if(color < NTW_PHYS_BATCH_MAX_COLORS){
+			if(body1 != 0)	bodyColors_[body1] |= 1ull << color;
+			if(body2 != 0)	bodyColors_[body2] |= 1ull << color;
+		}
+
+		constraintColors_[i] = color;
+		colorCounts[color]++;
+	}
+
+	// Sort constraints by color, keeping their order within each color
+	int colorStarts[NTW_PHYS_BATCH_MAX_COLORS + 1];
+	int start = 0;
+
+	for(int c = 0; c <= NTW_PHYS_BATCH_MAX_COLORS; c++){
+		colorStarts[c] = start;
+		start += colorCounts[c];
+	}
+
+	colorOrder_.resize(numConstraints);
+
+	for(int i = 0; i < numConstraints; i++)
+		colorOrder_[colorStarts[constraintColors_[i]]++] = i;
+
+
+	// Fill batches from each color, unused lanes have no bodies and zero jacobians
+	batches_.clear();
+
+	int prevColor = -1;
+	int lane = NTW_PHYS_BATCH_WIDTH;
+
+	for(int i : colorOrder_){
+		int color = constraintColors_[i];
+
+		if(lane == NTW_PHYS_BATCH_WIDTH || color != prevColor || color == NTW_PHYS_BATCH_MAX_COLORS){
+			batches_.push_back(ContactBatch());
+			std::fill(batches_.back().constraints, batches_.back().constraints + NTW_PHYS_BATCH_WIDTH, -1);
+			lane = 0;
+		}
+
+		setLane(batches_.back(), lane, constraints[indices[i]], indices[i]);
+
+		prevColor = color;
+		lane++;
+	}
+}
+
+void ContactBatchSolver::setLane(ContactBatch& batch, int lane, ContactConstraint& constraint, int index){
+
+	ObjectPair objects = constraint.getObjects();
+	const Contact& contact = constraint.contact_;
+
+	batch.constraints[lane]	= index;
+	batch.bodies1[lane]		= getBody(objects.object1);
+	batch.bodies2[lane]		= getBody(objects.object2);
+	batch.invMass1[lane]	= constraint.invMass1_;
+	batch.invMass2[lane]	= constraint.invMass2_;
+
+	for(int d = 0; d < 3; d++){
+		const Vec12& jac = constraint.jacobians_[d];
+		const Vec12& invMassJt = constraint.invMassJts_[d];
+
+		for(int k = 0; k < 3; k++){
+			batch.dir[d][k][lane]				= jac.linear2[k];
+			batch.angular1[d][k][lane]			= jac.angular1[k];
+			batch.angular2[d][k][lane]			= jac.angular2[k];
+			batch.invMassAngular1[d][k][lane]	= invMassJt.angular1[k];
+			batch.invMassAngular2[d][k][lane]	= invMassJt.angular2[k];
+		}
+
+		batch.effectiveMass[d][lane] = constraint.effectiveMasses_[d];
+	}
+
+	batch.lambdaSum[0][lane] = contact.lambdaSum;
+	batch.lambdaSum[1][lane] = contact.lambdaSumTan1;
+	batch.lambdaSum[2][lane] = contact.lambdaSumTan2;
+
+	// Baumgarte stabilization, as in ContactConstraint::init
+	batch.baumgarte[lane] = -(NTW_PHYS_BAUMGARTE_FAC / NTW_PHYS_TIME_DELTA) * max(contact.depth - NTW_PHYS_PENETRATION_SLOP, 0.0f);
+
+	batch.lambdaAvg[lane]		= contact.lambdaAvg;
+	batch.numSolves[lane]		= (float)contact.numSolves;
+	batch.closingSpeed[lane]	= contact.closingSpeed;
+}
+
+float ContactBatchSolver::solveBatches(){
+
+	__m128 zero			= _mm_setzero_ps();
+	__m128 one			= _mm_set1_ps(1.0f);
+	__m128 threshold	= _mm_set1_ps(NTW_PHYS_CONSTRAINT_THRESHOLD);
+	__m128 signMask		= _mm_set1_ps(-0.0f);
+	__m128 maxLambda	= zero;
+
+	auto l_abs = [signMask](__m128 a) -> __m128 {
+		return _mm_andnot_ps(signMask, a);
+	};
+
+	// Velocity components of 4 bodies
+	auto l_gather = [](const vector<float>& component, const int* bodies) -> __m128 {
+		return _mm_set_ps(component[bodies[3]], component[bodies[2]], component[bodies[1]], component[bodies[0]]);
+	};
+
+	auto l_scatter = [](vector<float>& component, const int* bodies, __m128 a) -> void {
+		float values[NTW_PHYS_BATCH_WIDTH];
+		_mm_storeu_ps(values, a);
+
+		for(int lane = 0; lane < NTW_PHYS_BATCH_WIDTH; lane++)
+			component[bodies[lane]] = values[lane];
+	};
+
+	// Dot product of a direction stored per component with 3 velocity components
+	auto l_dot = [](const float (&a)[3][NTW_PHYS_BATCH_WIDTH], const __m128* v) -> __m128 {
+		return _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(a[0]), v[0]),
+			_mm_mul_ps(_mm_loadu_ps(a[1]), v[1])),
+			_mm_mul_ps(_mm_loadu_ps(a[2]), v[2]));
+	};
+
+
+	for(ContactBatch& batch : batches_){
+
+		// Linear and angular velocities of object 1, then object 2
+		__m128 v1[3], w1[3], v2[3], w2[3];
+
+		for(int k = 0; k < 3; k++){
+			v1[k] = l_gather(velocities_[k],		batch.bodies1);
+			w1[k] = l_gather(velocities_[k + 3],	batch.bodies1);
+			v2[k] = l_gather(velocities_[k],		batch.bodies2);
+			w2[k] = l_gather(velocities_[k + 3],	batch.bodies2);
+		}
+
+		__m128 invMass1 = _mm_loadu_ps(batch.invMass1);
+		__m128 invMass2 = _mm_loadu_ps(batch.invMass2);
+
+		// Normal, then friction clamped by the new normal impulse
+		for(int d = 0; d < 3; d++){
+
+			// Relative velocity along the jacobian
+			__m128 relVel[3];
+
+			for(int k = 0; k < 3; k++)
+				relVel[k] = _mm_sub_ps(v2[k], v1[k]);
+
+			__m128 jv = _mm_add_ps(_mm_add_ps(
+				l_dot(batch.dir[d], relVel),
+				l_dot(batch.angular1[d], w1)),
+				l_dot(batch.angular2[d], w2));
+
+			__m128 bias = zero;
+
+			// Normal jacobian times velocity is the closing speed, restitution as in ContactConstraint::init
+			if(d == 0){
+				_mm_storeu_ps(batch.closingSpeed, jv);
+
+				bias = _mm_add_ps(_mm_loadu_ps(batch.baumgarte), _mm_mul_ps(_mm_set1_ps(0.1f),
+					_mm_max_ps(_mm_sub_ps(jv, _mm_set1_ps(NTW_PHYS_RESTITUTION_SLOP)), zero)));
+			}
+
+			__m128 constraint = _mm_add_ps(jv, bias);
+			__m128 lambda = _mm_mul_ps(_mm_sub_ps(zero, constraint), _mm_loadu_ps(batch.effectiveMass[d]));
+
+			// Clamp lambda sum
+			__m128 lambdaSum = _mm_loadu_ps(batch.lambdaSum[d]);
+			__m128 newLambdaSum = _mm_add_ps(lambdaSum, lambda);
+
+			if(d == 0)
+				newLambdaSum = _mm_max_ps(newLambdaSum, zero);
+			else{
+				__m128 clamp = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_loadu_ps(batch.lambdaSum[0]));
+				newLambdaSum = _mm_min_ps(_mm_max_ps(newLambdaSum, _mm_sub_ps(zero, clamp)), clamp);
+			}
+
+			lambda = _mm_sub_ps(newLambdaSum, lambdaSum);
+
+			// Skip constraints that are satisfied or would barely change
+			__m128 enforced = _mm_and_ps(_mm_cmpge_ps(l_abs(constraint), threshold), _mm_cmpge_ps(l_abs(lambda), threshold));
+			lambda = _mm_and_ps(enforced, lambda);
+
+			_mm_storeu_ps(batch.lambdaSum[d], _mm_add_ps(lambdaSum, lambda));
+			maxLambda = _mm_max_ps(maxLambda, l_abs(lambda));
+
+			// Add lambda to average
+			if(d == 0){
+				__m128 avg = _mm_loadu_ps(batch.lambdaAvg);
+				__m128 times = _mm_loadu_ps(batch.numSolves);
+				__m128 newAvg = _mm_div_ps(_mm_add_ps(_mm_mul_ps(avg, times), lambda), _mm_add_ps(times, one));
+
+				_mm_storeu_ps(batch.lambdaAvg, _mm_or_ps(_mm_and_ps(enforced, newAvg), _mm_andnot_ps(enforced, avg)));
+			}
+
+			// Apply corrective velocities
+			__m128 lambda1 = _mm_mul_ps(lambda, invMass1);
+			__m128 lambda2 = _mm_mul_ps(lambda, invMass2);
+
+			for(int k = 0; k < 3; k++){
+				__m128 dir = _mm_loadu_ps(batch.dir[d][k]);
+
+				v1[k] = _mm_sub_ps(v1[k], _mm_mul_ps(dir, lambda1));
+				v2[k] = _mm_add_ps(v2[k], _mm_mul_ps(dir, lambda2));
+				w1[k] = _mm_add_ps(w1[k], _mm_mul_ps(_mm_loadu_ps(batch.invMassAngular1[d][k]), lambda));
+				w2[k] = _mm_add_ps(w2[k], _mm_mul_ps(_mm_loadu_ps(batch.invMassAngular2[d][k]), lambda));
+			}
+		}
+
+		_mm_storeu_ps(batch.numSolves, _mm_add_ps(_mm_loadu_ps(batch.numSolves), one));
+
+		// No two lanes share a rigid body, lanes sharing other bodies write back their unchanged velocities
+		for(int k = 0; k < 3; k++){
+			l_scatter(velocities_[k],		batch.bodies1, v1[k]);
+			l_scatter(velocities_[k + 3],	batch.bodies1, w1[k]);
+			l_scatter(velocities_[k],		batch.bodies2, v2[k]);
+			l_scatter(velocities_[k + 3],	batch.bodies2, w2[k]);
+		}
+	}
+
+	// Largest lambda over all lanes
+	float lambdas[NTW_PHYS_BATCH_WIDTH];
+	_mm_storeu_ps(lambdas, maxLambda);
+
+	return max(max(lambdas[0], lambdas[1]), max(lambdas[2], lambdas[3]));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ *	contactBatchSolver.h
+ *
+ *	Solves the contact constraints of an island 4 at a time with SSE.
+ *	Constraints are colored so no two constraints in a color share a rigid body,
+ *	and each color is split into batches of 4 that can be solved together.
+ *	Body velocities are copied into arrays for solving and written back at the end,
+ *	so iterations do not touch any objects.
+ *
+ */
+
+class ContactBatchSolver;
+
+#include"contactConstraint.h"
+#include"physics/physStruct.h"
+
+
+// Number of constraints solved together
+#define NTW_PHYS_BATCH_WIDTH 4
+
+
+class ContactBatchSolver{
+
+	// Contact data of 4 constraints, one lane each
+	// Jacobians are stored per direction (normal, tangent 1, tangent 2), linear parts are -dir for object 1 and dir for object 2
+	struct ContactBatch{
+		int bodies1[NTW_PHYS_BATCH_WIDTH];
+		int bodies2[NTW_PHYS_BATCH_WIDTH];
+
+		float dir[3][3][NTW_PHYS_BATCH_WIDTH];
+		float angular1[3][3][NTW_PHYS_BATCH_WIDTH];
+		float angular2[3][3][NTW_PHYS_BATCH_WIDTH];
+
+		// Inverse inertia times angular jacobians, linear parts are the jacobian times inverse mass
+		float invMassAngular1[3][3][NTW_PHYS_BATCH_WIDTH];
+		float invMassAngular2[3][3][NTW_PHYS_BATCH_WIDTH];
+		float invMass1[NTW_PHYS_BATCH_WIDTH];
+		float invMass2[NTW_PHYS_BATCH_WIDTH];
+
+		float effectiveMass[3][NTW_PHYS_BATCH_WIDTH];
+		float lambdaSum[3][NTW_PHYS_BATCH_WIDTH];
+
+		// Baumgarte part of the normal bias, restitution is added from the current velocity
+		float baumgarte[NTW_PHYS_BATCH_WIDTH];
+
+		// Only the normal average is kept, for sound
+		float lambdaAvg[NTW_PHYS_BATCH_WIDTH];
+		float numSolves[NTW_PHYS_BATCH_WIDTH];
+		float closingSpeed[NTW_PHYS_BATCH_WIDTH];
+
+		// Index into the solved constraints, -1 for unused lanes
+		int constraints[NTW_PHYS_BATCH_WIDTH];
+	};
+
+	// Body linear and angular velocities, one array per component
+	// Body 0 is a static body with zero velocity, for immovable objects and unused lanes
+	vector<float> velocities_[6];
+	int numBodies_;
+
+	vector<ContactBatch> batches_;
+
+	// Colors used by each body as a bit mask, and constraints sorted by color
+	vector<unsigned long long> bodyColors_;
+	vector<int> constraintColors_;
+	vector<int> colorOrder_;
+
+
+	int getBody(Object* object) const;
+
+	void colorConstraints(ContactConstraint* constraints, const vector<int>& indices);
+	void setLane(ContactBatch& batch, int lane, ContactConstraint& constraint, int index);
+
+	// Solve each batch once, returns the largest impulse applied
+	float solveBatches();
+
+public:
+	ContactBatchSolver();
+
+	// Solve an island's contact constraints after warm starting, returns the number of iterations
+	int solve(ContactConstraint* constraints, const vector<int>& indices, const vector<PhysicsObject*>& objects);
+};
@@ -3,14 +3,15 @@
 #include"physics/physDefine.h"
 #include"core/error.h"
 #include<algorithm>
+#include<math.h>
 
 using ntw::crossProduct;
 using std::min;
 using std::max;
 
 
-ContactConstraint::ContactConstraint(Contact& contact, ObjectPair& objects) :
-	Constraint(objects.object1, objects.object2, true), contact_(contact) {
+ContactConstraint::ContactConstraint(Contact& contact, ObjectPair& objects, int manifoldIndex, int manifoldSize) :
+	Constraint(objects.object1, objects.object2, true), contact_(contact), manifoldIndex_(manifoldIndex), manifoldSize_(manifoldSize) {
 
 }
 
@@ -18,51 +19,55 @@ void ContactConstraint::init(){
 
 	Constraint::init();
 
-	// Initialize jacobians
-	if(firstSolve_)
-		jacNormal_ = jacTangent1_ = jacTangent2_ = jac_;
-	
 	// Recalculate contact vectors
-	contact_.obj1ContactVector = contact_.obj1ContactGlobal - object1_->getTPosition();
-	contact_.obj2ContactVector = contact_.obj2ContactGlobal - object2_->getTPosition();
-
-	bool obj1Phys = object1_->getPhysicsType() == PhysicsType::RIGID_BODY || object1_->getPhysicsType() == PhysicsType::SIMPLE;
-	bool obj2Phys = object2_->getPhysicsType() == PhysicsType::RIGID_BODY || object2_->getPhysicsType() == PhysicsType::SIMPLE;
-
-	// Normal constraint
-	Vec3 vel1		= obj1Phys ? ((PhysicsObject*)object1_)->getVelocity()			: Vec3();
-	Vec3 angVel1	= obj1Phys ? ((PhysicsObject*)object1_)->getAngularVelocity()	: Vec3();
-	Vec3 vel2		= obj2Phys ? ((PhysicsObject*)object2_)->getVelocity()			: Vec3();
-	Vec3 angVel2	= obj2Phys ? ((PhysicsObject*)object2_)->getAngularVelocity()	: Vec3();
+	if(firstSolve_){
+		contact_.obj1ContactVector = contact_.obj1ContactGlobal - object1_->getTPosition();
+		contact_.obj2ContactVector = contact_.obj2ContactGlobal - object2_->getTPosition();
+	}
 
 	// Baumgarte stabilization
 	biasNormal_ = -(NTW_PHYS_BAUMGARTE_FAC / NTW_PHYS_TIME_DELTA) * max(contact_.depth - NTW_PHYS_PENETRATION_SLOP, 0.0f);
 
 	// Restitution
-	contact_.closingSpeed = ((-vel1 - crossProduct(angVel1, contact_.obj1ContactVector)
-		+ (vel2 + crossProduct(angVel2, contact_.obj2ContactVector))) * -contact_.normal);
+	contact_.closingSpeed = ((-vel_.linear1 - crossProduct(vel_.angular1, contact_.obj1ContactVector)
+		+ (vel_.linear2 + crossProduct(vel_.angular2, contact_.obj2ContactVector))) * -contact_.normal);
 	// TODO: change multiplier (0.5f) to factor determined by material elasticity
 	biasNormal_ += 0.1f * max(contact_.closingSpeed - NTW_PHYS_RESTITUTION_SLOP, 0.0f);
 
+	// Jacobians only depend on contact geometry, which does not change between iterations
+	if(!firstSolve_)
+		return;
+
 	// Set jacobians
-	auto l_setJacobian = [](Matrix& jac, const Contact& contact, const Vec3& direction) -> void {
-		jac.place(0, 0, -direction, true);
-		jac.place(0, 3, crossProduct(-contact.obj1ContactVector, direction), true);
-		jac.place(0, 6, direction, true);
-		jac.place(0, 9, crossProduct(contact.obj2ContactVector, direction), true);
+	auto l_setJacobian = [](Vec12& jac, const Contact& contact, const Vec3& direction) -> void {
+		jac.linear1		= -direction;
+		jac.angular1	= crossProduct(-contact.obj1ContactVector, direction);
+		jac.linear2		= direction;
+		jac.angular2	= crossProduct(contact.obj2ContactVector, direction);
 	};
 
-	l_setJacobian(jacNormal_, contact_, -contact_.normal);
-	l_setJacobian(jacTangent1_, contact_, contact_.tangent1);
-	l_setJacobian(jacTangent2_, contact_, contact_.tangent2);
+	l_setJacobian(jacobians_[0], contact_, -contact_.normal);
+	l_setJacobian(jacobians_[1], contact_, contact_.tangent1);
+	l_setJacobian(jacobians_[2], contact_, contact_.tangent2);
+
+	// Precompute effective mass for each direction
+	for(int i = 0; i < 3; i++){
+		jac_ = jacobians_[i];
+		calcInvMassJt();
+		invMassJts_[i] = invMassJt_;
+		effectiveMasses_[i] = effectiveMass_;
+	}
 }
 
 // Set constraint properties for each constraint direction
 void ContactConstraint::setProperties(int type){
 
+	jac_			= jacobians_[type];
+	invMassJt_		= invMassJts_[type];
+	effectiveMass_	= effectiveMasses_[type];
+
 	// Normal direction
 	if(type == 0){
-		jac_ = jacNormal_;
 		bias_ = biasNormal_;
 		constrainGreaterThanZero_ = true;
 		return;
@@ -70,92 +75,278 @@ void ContactConstraint::setProperties(int type){
 
 	// Tangent directions
 	else{
-		jac_ = type == 1 ? jacTangent1_ : jacTangent2_;
 		bias_ = 0;
 		constrainGreaterThanZero_ = false;
 		return;
 	}
 }
 
+// Get lambda sum according to constraint type
+float& ContactConstraint::getLambdaSum(int type){
+	switch(type){
+	case 1:	return contact_.lambdaSumTan1;
+	case 2:	return contact_.lambdaSumTan2;
+	}
+
+	return contact_.lambdaSum;
+}
+
+// Calculate lambda and limit it so the lambda sum stays within its bounds
+void ContactConstraint::calcClampedLambda(int type){
+
+	calcLambda();
+
+	float lambdaSum = getLambdaSum(type);
+	float newLambdaSum = lambdaSum + lambda_;
+
+	// Clamp according to constraint type
+	if(type == 0)
+		newLambdaSum = max(newLambdaSum, 0.0f);
+	else{
+		// TODO: change multiplier to coefficient of friction
+		float clamp = 0.5f * contact_.lambdaSum;
+		newLambdaSum = max(newLambdaSum, -clamp);
+		newLambdaSum = min(newLambdaSum, clamp);
+	}
+
+	// Compute actual lambda
+	lambda_ = newLambdaSum - lambdaSum;
+}
+
 void ContactConstraint::solve(){
 
 	init();
 
 	// For each constraint direction
-	for(int i = 0; i < 3; i++){
+	for(int i = 0; i < 3; i++)
+		solveDirection(i);
 
-		// Set constraint properties
-		setProperties(i);
+	firstSolve_ = false;
+	contact_.numSolves++;
+}
 
-		// Calculate individual constraint value and check if it should be enforced
-		if(calcConstraint())
-			continue;
+void ContactConstraint::solveDirection(int type){
 
+	// Set constraint properties
+	setProperties(type);
 
-		calcInvMassJt();
+	// Calculate individual constraint value and check if it should be enforced
+	// Separating contacts are still solved, since a warm started impulse may need to be reduced
+	calcConstraint();
 
-		// If this is the first solve and the contact is persistent, use previous lambda sum as current lambda
-		/*
-		if(firstSolve_ && !contact_.updated){
-			switch(i){
-			case 0:	lambda_ = contact_.lambdaSum		* PHYS_WARM_START_LAMBDA_MULTIPLIER;	break;
-			case 1:	lambda_ = contact_.lambdaSumTan1	* PHYS_WARM_START_LAMBDA_MULTIPLIER;	break;
-			case 2:	lambda_ = contact_.lambdaSumTan2	* PHYS_WARM_START_LAMBDA_MULTIPLIER;	break;
-			}
+	if(abs(constraint_) < NTW_PHYS_CONSTRAINT_THRESHOLD)
+		return;
+
+	// Calculate current lambda
+	calcClampedLambda(type);
+
+	// If lambda is small enough, it will not have much effect so consider the constraint solved
+	if(abs(lambda_) < NTW_PHYS_CONSTRAINT_THRESHOLD)
+		return;
+
+	// Add to sum
+	getLambdaSum(type) += lambda_;
+
+
+	// Add lambda to average
+	auto l_addToAvg = [](float& avg, float val, int times) -> void {
+		avg = ((avg * times) + val) / (times + 1);
+	};
+
+	switch(type){
+	case 0:	l_addToAvg(contact_.lambdaAvg,		lambda_, contact_.numSolves);	break;
+	case 1:	l_addToAvg(contact_.lambdaAvgTan1,	lambda_, contact_.numSolves);	break;
+	case 2:	l_addToAvg(contact_.lambdaAvgTan2,	lambda_, contact_.numSolves);	break;
+	}
+
+
+	// Solve and apply
+	calcVelCor();
+	apply();
+}
+
+void ContactConstraint::solveBlock(ContactConstraint* constraints, int count){
+
+	const int maxCount = NTW_PHYS_MAX_MANIFOLD_CONTACTS;
+
+	if(count < 2 || count > maxCount){
+		for(int i = 0; i < count; i++)
+			constraints[i].solve();
+		return;
+	}
+
+	// Friction first, clamped by the normal impulses of the previous iteration
+	for(int i = 0; i < count; i++){
+		constraints[i].init();
+		constraints[i].solveDirection(1);
+		constraints[i].solveDirection(2);
+	}
+
+	// Contacts share both objects, so one velocity gives every normal constraint value
+	ContactConstraint& first = constraints[0];
+	first.init();
+
+	// Coupling between normal impulses, and constraint values with the accumulated impulses removed
+	// Coplanar contacts make the matrix singular, a small diagonal term spreads impulses evenly between them
+	float a[maxCount][maxCount];
+	float b[maxCount];
+	float lambdaSums[maxCount];
+
+	for(int i = 0; i < count; i++){
+		const Vec12& jac = constraints[i].jacobians_[0];
+
+		for(int j = 0; j < count; j++)
+			a[i][j] = jac * constraints[j].invMassJts_[0];
+
+		a[i][i] *= 1 + NTW_PHYS_BLOCK_REGULARIZATION;
+
+		lambdaSums[i] = constraints[i].contact_.lambdaSum;
+		b[i] = jac * first.vel_ + constraints[i].biasNormal_;
+	}
+
+	for(int i = 0; i < count; i++)
+		for(int j = 0; j < count; j++)
+			b[i] -= a[i][j] * lambdaSums[j];
+
+
+	// Solve the active contacts' constraints for zero, returns false if the system is singular
+	auto l_solve = [&a, &b, count](int active, float* x) -> bool {
+
+		int indices[maxCount];
+		int n = 0;
+
+		for(int i = 0; i < count; i++)
+			if(active & (1 << i))
+				indices[n++] = i;
+
+		// Augmented matrix of the active contacts
+		float m[maxCount][maxCount + 1];
+
+		for(int i = 0; i < n; i++){
+			for(int j = 0; j < n; j++)
+				m[i][j] = a[indices[i]][indices[j]];
+
+			m[i][n] = -b[indices[i]];
 		}
-		*/
-		// Calculate current lambda
-		//else
-			calcLambda();
-
-		// Get lambda sum according to constraint type
-		float* lambdaSum = &contact_.lambdaSum;
-		switch(i){
-		case 1:	lambdaSum = &contact_.lambdaSumTan1;	break;
-		case 2:	lambdaSum = &contact_.lambdaSumTan2;	break;
+
+		// Gaussian elimination with partial pivoting
+		for(int col = 0; col < n; col++){
+
+			int pivot = col;
+
+			for(int row = col + 1; row < n; row++)
+				if(abs(m[row][col]) > abs(m[pivot][col]))
+					pivot = row;
+
+			if(abs(m[pivot][col]) < 0.000001f)
+				return false;
+
+			for(int j = col; j <= n; j++)
+				std::swap(m[col][j], m[pivot][j]);
+
+			for(int row = col + 1; row < n; row++){
+				float f = m[row][col] / m[col][col];
+
+				for(int j = col; j <= n; j++)
+					m[row][j] -= f * m[col][j];
+			}
 		}
 
-		// Copy and add to sum
-		float lambdaSumCopy = *lambdaSum;
-		*lambdaSum += lambda_;
-
-		// Clamp according to constraint type
-		if(i == 0)
-			*lambdaSum = max(*lambdaSum, 0.0f);
-		else{
-			// TODO: change multiplier to coefficient of friction
-			float clamp = 0.5f * contact_.lambdaSum;
-			*lambdaSum = max(*lambdaSum, -clamp);
-			*lambdaSum = min(*lambdaSum, clamp);
+		// Back substitution
+		for(int i = 0; i < count; i++)
+			x[i] = 0;
+
+		for(int i = n - 1; i >= 0; i--){
+			float sum = m[i][n];
+
+			for(int j = i + 1; j < n; j++)
+				sum -= m[i][j] * x[indices[j]];
+
+			x[indices[i]] = sum / m[i][i];
 		}
 
-		// Compute actual lambda
-		lambda_ = *lambdaSum - lambdaSumCopy;
+		return true;
+	};
+
 
-		// If lambda is small enough, it will not have much effect so consider the constraint solved
-		if(abs(lambda_) < NTW_PHYS_CONSTRAINT_THRESHOLD)
+	// Try sets of active contacts, starting with all of them
+	// A set is valid if its impulses push apart and every inactive contact is separating
+	float x[maxCount];
+	bool found = false;
+
+	for(int active = (1 << count) - 1; active >= 0 && !found; active--){
+
+		if(!l_solve(active, x))
 			continue;
 
+		found = true;
+
+		for(int i = 0; i < count && found; i++){
+			if(active & (1 << i))
+				found = x[i] >= 0;
+			else{
+				float w = b[i];
+
+				for(int j = 0; j < count; j++)
+					w += a[i][j] * x[j];
+
+				found = w >= -NTW_PHYS_CONSTRAINT_THRESHOLD;
+			}
+		}
+	}
+
+	if(!found){
+		for(int i = 0; i < count; i++){
+			constraints[i].init();
+			constraints[i].solveDirection(0);
+		}
+	}
+	else{
+		// Apply the change in accumulated impulses in one go
+		first.velCor_ = Vec12();
+
+		for(int i = 0; i < count; i++){
+			Contact& contact = constraints[i].contact_;
+			float lambda = x[i] - lambdaSums[i];
 
-		// Add lambda to average
-		auto l_addToAvg = [](float& avg, float val, int times) -> void {
-			avg = ((avg * times) + val) / (times + 1);
-		};
+			first.velCor_ += constraints[i].invMassJts_[0] * lambda;
 
-		switch(i){
-		case 0:	l_addToAvg(contact_.lambdaAvg,		lambda_, contact_.numSolves);	break;
-		case 1:	l_addToAvg(contact_.lambdaAvgTan1,	lambda_, contact_.numSolves);	break;
-		case 2:	l_addToAvg(contact_.lambdaAvgTan2,	lambda_, contact_.numSolves);	break;
+			contact.lambdaAvg = ((contact.lambdaAvg * contact.numSolves) + lambda) / (contact.numSolves + 1);
+			contact.lambdaSum = x[i];
 		}
 
+		first.apply();
+	}
+
+	for(int i = 0; i < count; i++){
+		constraints[i].firstSolve_ = false;
+		constraints[i].contact_.numSolves++;
+	}
+}
+
+void ContactConstraint::warmStart(){
+
+	// New contacts have no impulses to carry over
+	if(contact_.isNew)
+		return;
+
+	init();
+
+	float lambdaSums[3] = {contact_.lambdaSum, contact_.lambdaSumTan1, contact_.lambdaSumTan2};
+
+	// Apply the accumulated impulse of each constraint direction
+	// Sums are kept so the solver clamps the total impulse rather than the correction
+	for(int i = 0; i < 3; i++){
+
+		if(lambdaSums[i] == 0)
+			continue;
+
+		setProperties(i);
+		lambda_ = lambdaSums[i];
 
-		// Solve and apply
 		calcVelCor();
 		apply();
 	}
-
-	firstSolve_ = false;
-	contact_.numSolves++;
 }
 
 bool ContactConstraint::isSolved(){
@@ -163,10 +354,17 @@ bool ContactConstraint::isSolved(){
 	init();
 
 	// Check that all 3 constraints are solved
+	// A constraint is solved if solving it again would not change its lambda sum
 	for(int i = 0; i < 3; i++){
 		setProperties(i);
+		calcConstraint();
 
-		if(!Constraint::isSolved())
+		if(abs(constraint_) < NTW_PHYS_CONSTRAINT_THRESHOLD)
+			continue;
+
+		calcClampedLambda(i);
+
+		if(abs(lambda_) >= NTW_PHYS_CONSTRAINT_THRESHOLD)
 			return false;
 	}
 
@@ -183,3 +381,11 @@ ContactConstraint& ContactConstraint::operator=(const ContactConstraint& a){
 Contact& ContactConstraint::getContactPoints() const{
 	return contact_;
 }
+
+int ContactConstraint::getManifoldIndex() const{
+	return manifoldIndex_;
+}
+
+int ContactConstraint::getManifoldSize() const{
+	return manifoldSize_;
+}
@@ -4,6 +4,8 @@
  *	contactConstraint.h
  *
  *	Non-penetration and friction impulse constraint.
+ *	Contacts of a face-face manifold can also be solved as a block,
+ *	finding all normal impulses at once by trying each set of active contacts.
  *
  */
 
@@ -14,26 +16,50 @@ class ContactConstraint;
 
 class ContactConstraint : public Constraint{
 
+	// Copies contact data into batches for solving with SSE
+	friend class ContactBatchSolver;
+
 	Contact& contact_;
 
-	Matrix jacNormal_;
-	Matrix jacTangent1_;
-	Matrix jacTangent2_;
+	// Jacobians and effective masses for normal, tangent 1 and tangent 2 directions
+	Vec12 jacobians_[3];
+	Vec12 invMassJts_[3];
+	float effectiveMasses_[3];
 
 	float biasNormal_;
 
+	// Position in the manifold the contact came from, block solving starts at the first contact
+	int manifoldIndex_;
+	int manifoldSize_;
+
 	void setProperties(int type);
 
+	float& getLambdaSum(int type);
+	void calcClampedLambda(int type);
+
+	// Solve a single constraint direction
+	void solveDirection(int type);
+
 public:
-	ContactConstraint(Contact& contact, ObjectPair& objects);
+	ContactConstraint(Contact& contact, ObjectPair& objects, int manifoldIndex = 0, int manifoldSize = 1);
 
 	void init() override;
 	void solve() override;
 
+	// Solve the normal impulses of a manifold's contacts together as a small LCP, friction is solved per contact
+	// Falls back to solving each contact on its own if no set of active contacts is valid
+	static void solveBlock(ContactConstraint* constraints, int count);
+
+	// Apply accumulated impulses carried over from the previous update
+	void warmStart();
+
 	bool isSolved() override;
 
 	// Necessary for some reason
 	ContactConstraint& operator=(const ContactConstraint& a);
 
 	Contact& getContactPoints() const;
+
+	int getManifoldIndex() const;
+	int getManifoldSize() const;
 };
@@ -0,0 +1,578 @@
+#include"gjkCollision.h"
+
+#include"physics/physFunc.h"
+#include<algorithm>
+#include<limits>
+#include<math.h>
+
+using ntw::crossProduct;
+
+
+GJKCollision::GJKCollision(const Collider* collider1, const Collider* collider2, GJKBuffers& buffers) :
+	collider1_(collider1), collider2_(collider2), buffers_(buffers), depth_(0),
+	contactInfo_({0, false, -1, -1}), supportVertex1_(0), supportVertex2_(0) {}
+
+
+bool GJKCollision::testCollision(){
+
+	GJKVertex* v = simplex_.vertices;
+
+	// Move vertices of a cached simplex to where the hitboxes are now, dropping it if they no longer fit the hitboxes
+	for(int i = 0; i < simplex_.size; i++){
+		if(v[i].vertex1 < 0 || v[i].vertex1 >= collider1_->hitboxScaled.vertices.size() ||
+			v[i].vertex2 < 0 || v[i].vertex2 >= collider2_->hitboxScaled.vertices.size()){
+			simplex_.size = 0;
+			break;
+		}
+
+		v[i].support1 = collider1_->rotation * collider1_->hitboxScaled.vertices[v[i].vertex1] + collider1_->position;
+		v[i].support2 = collider2_->rotation * collider2_->hitboxScaled.vertices[v[i].vertex2] + collider2_->position;
+		v[i].point = v[i].support1 - v[i].support2;
+	}
+
+	// Start from the support point along the offset between the colliders
+	if(simplex_.size == 0){
+		Vec3 direction = collider1_->position - collider2_->position;
+		v[simplex_.size++] = getSupport(direction.isZero() ? Vec3(1, 0, 0) : direction);
+	}
+
+	for(int i = 0; i < NTW_GJK_MAX_ITERATIONS; i++){
+
+		Vec3 closest = reduceSimplex();
+
+		// Origin inside the simplex or on its surface, hitboxes overlap
+		if(simplex_.size == 4 || closest.magnitude2() < 0.0000000001f)
+			return expandSimplex() && expandPolytope() && depth_ >= NTW_GJK_THRESHOLD;
+
+		GJKVertex w = getSupport(-closest);
+
+		// Whole Minkowski difference is beyond the plane through w, hitboxes are separated
+		if(w.point * closest > 0)
+			return false;
+
+		// Support vertex already in the simplex, no progress towards the origin can be made
+		for(int j = 0; j < simplex_.size; j++)
+			if(v[j].vertex1 == w.vertex1 && v[j].vertex2 == w.vertex2)
+				return false;
+
+		v[simplex_.size++] = w;
+	}
+
+	return false;
+}
+
+
+ContactManifold GJKCollision::getContactPoints(){
+
+	ContactManifold m;
+	m.objects = {collider1_->parent, collider2_->parent};
+	m.maxDistance = depth_;
+
+	// Face of each hitbox facing the other most directly
+	float alignment1;
+	float alignment2;
+	int face1 = findFace(collider1_->hitboxScaled, collider1_->rotation.getTranspose() * normal_, alignment1);
+	int face2 = findFace(collider2_->hitboxScaled, collider2_->rotation.getTranspose() * -normal_, alignment2);
+
+	// Neither face is aligned with the normal, hitboxes touch edge to edge at the deepest points
+	if(alignment1 < NTW_GJK_FACE_ALIGNMENT && alignment2 < NTW_GJK_FACE_ALIGNMENT){
+		contactInfo_ = {-depth_, true, -1, -1};
+
+		Contact c;
+		c.obj1ContactGlobal = witness1_;
+		c.obj2ContactGlobal = witness2_;
+		c.normal = -normal_;
+
+		if(ntw::setContactProperties(c, collider1_->parent, collider2_->parent))
+			m.contacts.push_back(c);
+
+		return m;
+	}
+
+	// Reference face is the better aligned face, preferring the first hitbox
+	bool reference1 = alignment1 >= NTW_GJK_FACE_ALIGNMENT && alignment1 + NTW_EPA_TOLERANCE >= alignment2;
+
+	const Collider* reference = reference1 ? collider1_ : collider2_;
+	const Collider* incident = reference1 ? collider2_ : collider1_;
+	int referenceFace = reference1 ? face1 : face2;
+
+	contactInfo_ = {-depth_, false, reference1 ? referenceFace : -1, reference1 ? -1 : referenceFace};
+
+	// Incident face is the face most opposed to the reference face, found in the incident hitbox's space
+	Mat3 incidentToReference = reference->rotation.getTranspose() * incident->rotation;
+	Mat3 referenceToIncident = incidentToReference.getTranspose();
+	Vec3 incidentOffset = reference->rotation.getTranspose() * (incident->position - reference->position);
+
+	const SATPlane& f1 = reference->hitboxScaled.faces[referenceFace];
+
+	float alignment;
+	int incidentFace = findFace(incident->hitboxScaled, referenceToIncident * -f1.normal, alignment);
+
+	// Move incident face into the reference hitbox's space and clip it there
+	SATPlane f2 = incident->hitboxScaled.faces[incidentFace];
+	f2.position = incidentToReference * f2.position + incidentOffset;
+	f2.normal = incidentToReference * f2.normal;
+
+	vector<ClipPoint> points = ntw::getFaceVertices(incident->hitboxScaled, incidentFace);
+
+	for(ClipPoint& p : points)
+		p.position = incidentToReference * p.position + incidentOffset;
+
+	points = ntw::clipPolygon(points, ntw::getClippingPlanes(reference->hitboxScaled, referenceFace));
+
+	// Normal points from the second collider towards the first
+	Vec3 normal = reference->rotation * f1.normal;
+
+	if(reference1)
+		normal = -normal;
+
+	for(const ClipPoint& p : points){
+
+		Contact c;
+		const Vec3& v = p.position;
+
+		// Contact points for each object are clipped points projected onto each object's respective face
+		auto l_project = [](const Vec3& v, const SATPlane& f){
+			const Vec3& p = f.position;
+			const Vec3& n = f.normal;
+			return v + (n * (((n * p) - (n * v)) / n.magnitude2()));
+		};
+
+		Vec3 onReference = reference->rotation * l_project(v, f1) + reference->position;
+		Vec3 onIncident = reference->rotation * l_project(v, f2) + reference->position;
+
+		c.obj1ContactGlobal = reference1 ? onReference : onIncident;
+		c.obj2ContactGlobal = reference1 ? onIncident : onReference;
+		c.normal = normal;
+		c.feature = p.feature;
+
+		// Set contact properties and check its validity before adding
+		if(ntw::setContactProperties(c, collider1_->parent, collider2_->parent))
+			m.contacts.push_back(c);
+	}
+
+	ntw::reduceContacts(m.contacts);
+
+	return m;
+}
+
+
+GJKVertex GJKCollision::getSupport(const Vec3& direction){
+
+	GJKVertex w;
+	w.support1 = getSupportPoint(collider1_, direction, supportVertex1_);
+	w.support2 = getSupportPoint(collider2_, -direction, supportVertex2_);
+	w.vertex1 = supportVertex1_;
+	w.vertex2 = supportVertex2_;
+	w.point = w.support1 - w.support2;
+
+	return w;
+}
+
+Vec3 GJKCollision::getSupportPoint(const Collider* collider, const Vec3& direction, int& vertex) const{
+	const Mat3& rotation = collider->rotation;
+	return rotation * ntw::getSupportPoint(collider->hitboxScaled, rotation.getTranspose() * direction, vertex) + collider->position;
+}
+
+
+Vec3 GJKCollision::reduceSimplex(){
+
+	GJKVertex* v = simplex_.vertices;
+	int& size = simplex_.size;
+
+	if(size == 1)
+		return v[0].point;
+
+	if(size == 2)
+		return getClosestOnSegment(v[0], v[1], v, size);
+
+	if(size == 3)
+		return getClosestOnTriangle(v[0], v[1], v[2], v, size);
+
+
+	// Tetrahedron, closest point is on a face the origin is outside of
+	GJKVertex tetrahedron[4] = {v[0], v[1], v[2], v[3]};
+
+	// Vertices of each face followed by the vertex opposite it
+	const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+
+	// Flat tetrahedron has no inside, closest point is on one of its faces
+	const Vec3& a = tetrahedron[0].point;
+	bool flat = abs(crossProduct(tetrahedron[1].point - a, tetrahedron[2].point - a) * (tetrahedron[3].point - a)) < 0.0000000001f;
+
+	Vec3 closest;
+	float closestDistance2 = std::numeric_limits<float>::max();
+	GJKVertex faceSimplex[3];
+	int faceSize;
+
+	for(const int* f : faces){
+		const Vec3& p1 = tetrahedron[f[0]].point;
+		Vec3 n = crossProduct(tetrahedron[f[1]].point - p1, tetrahedron[f[2]].point - p1);
+
+		// Origin on the same side as the opposite vertex is inside this face
+		if(!flat && (-p1 * n) * ((tetrahedron[f[3]].point - p1) * n) >= 0)
+			continue;
+
+		Vec3 point = getClosestOnTriangle(tetrahedron[f[0]], tetrahedron[f[1]], tetrahedron[f[2]], faceSimplex, faceSize);
+		float distance2 = point.magnitude2();
+
+		if(distance2 < closestDistance2){
+			closest = point;
+			closestDistance2 = distance2;
+			size = faceSize;
+			std::copy(faceSimplex, faceSimplex + faceSize, v);
+		}
+	}
+
+	// Origin inside every face, keep the whole tetrahedron
+	return closestDistance2 == std::numeric_limits<float>::max() ? Vec3() : closest;
+}
+
+bool GJKCollision::expandSimplex(){
+
+	GJKVertex* v = simplex_.vertices;
+	int& size = simplex_.size;
+
+	const Vec3 axes[3] = {Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1)};
+
+	// Point, add a second point along any axis
+	for(int i = 0; i < 6 && size == 1; i++){
+		GJKVertex w = getSupport(i % 2 == 0 ? axes[i / 2] : -axes[i / 2]);
+
+		if((w.point - v[0].point).magnitude2() > 0.0000000001f)
+			v[size++] = w;
+	}
+
+	// Segment, add a point off its line
+	if(size == 2){
+		Vec3 line = (v[1].point - v[0].point).unitVector();
+
+		// Perpendicular directions from the axis least aligned with the line
+		int axis = 0;
+
+		for(int i = 1; i < 3; i++)
+			if(abs(line[i]) < abs(line[axis]))
+				axis = i;
+
+		Vec3 perpendicular1 = crossProduct(line, axes[axis]).normalize();
+		Vec3 perpendicular2 = crossProduct(line, perpendicular1);
+		const Vec3 directions[4] = {perpendicular1, -perpendicular1, perpendicular2, -perpendicular2};
+
+		for(int i = 0; i < 4 && size == 2; i++){
+			GJKVertex w = getSupport(directions[i]);
+
+			if(crossProduct(line, w.point - v[0].point).magnitude2() > 0.0000000001f)
+				v[size++] = w;
+		}
+	}
+
+	// Triangle, add a point off its plane
+	if(size == 3){
+		Vec3 normal = crossProduct(v[1].point - v[0].point, v[2].point - v[0].point).normalize();
+
+		for(int i = 0; i < 2 && size == 3; i++){
+			GJKVertex w = getSupport(i == 0 ? normal : -normal);
+
+			if(abs((w.point - v[0].point) * normal) > 0.00001f)
+				v[size++] = w;
+		}
+	}
+
+	return size == 4;
+}
+
+bool GJKCollision::expandPolytope(){
+
+	vector<GJKVertex>& polytope = buffers_.polytope;
+	vector<EPAFace>& faces = buffers_.faces;
+	vector<std::pair<int, int>>& horizon = buffers_.horizon;
+
+	polytope.assign(simplex_.vertices, simplex_.vertices + 4);
+	faces.clear();
+
+	// Point inside the polytope for orienting faces, stays inside since the polytope only grows
+	Vec3 interior = (polytope[0].point + polytope[1].point + polytope[2].point + polytope[3].point) / 4;
+
+	addFace(0, 1, 2, interior);
+	addFace(0, 3, 1, interior);
+	addFace(0, 2, 3, interior);
+	addFace(1, 3, 2, interior);
+
+	int closest = 0;
+
+	for(int i = 0; i < NTW_EPA_MAX_ITERATIONS && !faces.empty(); i++){
+
+		// Face closest to the origin
+		closest = 0;
+
+		for(int j = 1; j < faces.size(); j++)
+			if(faces[j].distance < faces[closest].distance)
+				closest = j;
+
+		EPAFace face = faces[closest];
+		GJKVertex w = getSupport(face.normal);
+
+		// Face is on the surface of the Minkowski difference
+		if(w.point * face.normal - face.distance < NTW_EPA_TOLERANCE)
+			break;
+
+		// Remove faces the new vertex can see, edges of only one removed face make the horizon
+		horizon.clear();
+
+		for(int j = 0; j < faces.size();){
+			if(faces[j].normal * (w.point - polytope[faces[j].vertices[0]].point) <= 0){
+				j++;
+				continue;
+			}
+
+			for(int k = 0; k < 3; k++){
+				std::pair<int, int> edge(faces[j].vertices[k], faces[j].vertices[(k + 1) % 3]);
+
+				auto shared = std::find_if(horizon.begin(), horizon.end(), [&edge](const std::pair<int, int>& e){
+					return (e.first == edge.first && e.second == edge.second) || (e.first == edge.second && e.second == edge.first);
+				});
+
+				if(shared != horizon.end()){
+					*shared = horizon.back();
+					horizon.pop_back();
+				}
+				else
+					horizon.push_back(edge);
+			}
+
+			faces[j] = faces.back();
+			faces.pop_back();
+		}
+
+		// Connect the horizon to the new vertex
+		int vertex = (int)polytope.size();
+		polytope.push_back(w);
+
+		for(const std::pair<int, int>& edge : horizon)
+			addFace(edge.first, edge.second, vertex, interior);
+
+		closest = -1;
+	}
+
+	if(faces.empty())
+		return false;
+
+	// Ran out of iterations after an expansion, use the closest face found
+	if(closest == -1){
+		closest = 0;
+
+		for(int j = 1; j < faces.size(); j++)
+			if(faces[j].distance < faces[closest].distance)
+				closest = j;
+	}
+
+	const EPAFace& face = faces[closest];
+	const GJKVertex& a = polytope[face.vertices[0]];
+	const GJKVertex& b = polytope[face.vertices[1]];
+	const GJKVertex& c = polytope[face.vertices[2]];
+
+	normal_ = face.normal;
+	depth_ = face.distance;
+
+	// Barycentric coordinates of the origin projected onto the face give the deepest point of each hitbox
+	Vec3 ab = b.point - a.point;
+	Vec3 ac = c.point - a.point;
+	Vec3 ap = normal_ * depth_ - a.point;
+
+	float d00 = ab * ab;
+	float d01 = ab * ac;
+	float d11 = ac * ac;
+	float d20 = ap * ab;
+	float d21 = ap * ac;
+	float denom = d00 * d11 - d01 * d01;
+
+	float u = 0;
+	float v = 0;
+
+	if(denom > 0.0000000001f){
+		u = (d11 * d20 - d01 * d21) / denom;
+		v = (d00 * d21 - d01 * d20) / denom;
+	}
+
+	witness1_ = a.support1 + (b.support1 - a.support1) * u + (c.support1 - a.support1) * v;
+	witness2_ = a.support2 + (b.support2 - a.support2) * u + (c.support2 - a.support2) * v;
+
+	return true;
+}
+
+void GJKCollision::addFace(int vertex1, int vertex2, int vertex3, const Vec3& interior){
+
+	const Vec3& a = buffers_.polytope[vertex1].point;
+	const Vec3& b = buffers_.polytope[vertex2].point;
+	const Vec3& c = buffers_.polytope[vertex3].point;
+
+	EPAFace face = {{vertex1, vertex2, vertex3}, Vec3(), 0};
+	face.normal = crossProduct(b - a, c - a);
+
+	// Degenerate faces point directly away from the inside
+	if(face.normal.magnitude2() < 0.0000000001f)
+		face.normal = a - interior;
+
+	face.normal.normalize();
+
+	if(face.normal * (a - interior) < 0){
+		face.normal = -face.normal;
+		std::swap(face.vertices[1], face.vertices[2]);
+	}
+
+	face.distance = face.normal * a;
+	buffers_.faces.push_back(face);
+}
+
+
+Vec3 GJKCollision::getClosestOnSegment(const GJKVertex& a, const GJKVertex& b, GJKVertex* simplex, int& size){
+
+	Vec3 ab = b.point - a.point;
+	float length2 = ab.magnitude2();
+	float t = length2 > 0 ? -(a.point * ab) / length2 : 0;
+
+	if(t <= 0){
+		simplex[0] = a;
+		size = 1;
+		return a.point;
+	}
+
+	if(t >= 1){
+		simplex[0] = b;
+		size = 1;
+		return b.point;
+	}
+
+	GJKVertex va = a;
+	GJKVertex vb = b;
+	simplex[0] = va;
+	simplex[1] = vb;
+	size = 2;
+
+	return va.point + ab * t;
+}
+
+Vec3 GJKCollision::getClosestOnTriangle(const GJKVertex& a, const GJKVertex& b, const GJKVertex& c, GJKVertex* simplex, int& size){
+
+	// Copy vertices, the output simplex may be the input
+	GJKVertex va = a;
+	GJKVertex vb = b;
+	GJKVertex vc = c;
+
+	auto l_set = [simplex, &size](const GJKVertex* vertices, int num){
+		for(int i = 0; i < num; i++)
+			simplex[i] = vertices[i];
+
+		size = num;
+	};
+
+	// Voronoi regions of the triangle's vertices, edges and face, with the origin as the query point
+	Vec3 ab = vb.point - va.point;
+	Vec3 ac = vc.point - va.point;
+
+	float d1 = ab * -va.point;
+	float d2 = ac * -va.point;
+
+	if(d1 <= 0 && d2 <= 0){
+		l_set(&va, 1);
+		return va.point;
+	}
+
+	float d3 = ab * -vb.point;
+	float d4 = ac * -vb.point;
+
+	if(d3 >= 0 && d4 <= d3){
+		l_set(&vb, 1);
+		return vb.point;
+	}
+
+	float regionC = d1 * d4 - d3 * d2;
+
+	if(regionC <= 0 && d1 >= 0 && d3 <= 0){
+		GJKVertex edge[2] = {va, vb};
+		l_set(edge, 2);
+		return va.point + ab * (d1 / (d1 - d3));
+	}
+
+	float d5 = ab * -vc.point;
+	float d6 = ac * -vc.point;
+
+	if(d6 >= 0 && d5 <= d6){
+		l_set(&vc, 1);
+		return vc.point;
+	}
+
+	float regionB = d5 * d2 - d1 * d6;
+
+	if(regionB <= 0 && d2 >= 0 && d6 <= 0){
+		GJKVertex edge[2] = {va, vc};
+		l_set(edge, 2);
+		return va.point + ac * (d2 / (d2 - d6));
+	}
+
+	float regionA = d3 * d6 - d5 * d4;
+
+	if(regionA <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0){
+		GJKVertex edge[2] = {vb, vc};
+		l_set(edge, 2);
+		return vb.point + (vc.point - vb.point) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	// Degenerate triangle has no face region, use its longest edge
+	float sum = regionA + regionB + regionC;
+
+	if(sum <= 0.0000000001f){
+		if(ab.magnitude2() >= ac.magnitude2())
+			return getClosestOnSegment(va, vb, simplex, size);
+
+		return getClosestOnSegment(va, vc, simplex, size);
+	}
+
+	GJKVertex face[3] = {va, vb, vc};
+	l_set(face, 3);
+
+	return va.point + ab * (regionB / sum) + ac * (regionC / sum);
+}
+
+int GJKCollision::findFace(const TransformedHitbox& hitbox, const Vec3& direction, float& alignment){
+
+	int face = 0;
+	alignment = -std::numeric_limits<float>::max();
+
+	for(int i = 0; i < hitbox.faces.size(); i++){
+		float dot = hitbox.faces[i].normal * direction;
+
+		if(dot > alignment){
+			face = i;
+			alignment = dot;
+		}
+	}
+
+	return face;
+}
+
+
+void GJKCollision::setSimplex(const GJKSimplex& simplex){
+	simplex_ = simplex;
+}
+
+void GJKCollision::setSupportVertices(int vertex1, int vertex2){
+	supportVertex1_ = vertex1;
+	supportVertex2_ = vertex2;
+}
+
+const GJKSimplex& GJKCollision::getSimplex() const{
+	return simplex_;
+}
+
+SATContactInfo GJKCollision::getContactInfo() const{
+	return contactInfo_;
+}
+
+int GJKCollision::getSupportVertex1() const{
+	return supportVertex1_;
+}
+
+int GJKCollision::getSupportVertex2() const{
+	return supportVertex2_;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+ *	gjkCollision.h
+ *
+ *	GJK intersection and EPA penetration tester, an alternative to SATCollision for pairs of hulls.
+ *	Support points are found on each collider's scaled hitbox by climbing vertex adjacency,
+ *	so neither hitbox is transformed and the cost grows slowly with vertex count.
+ *	Each test can start from the simplex of the pair's previous test,
+ *	and face contacts are clipped the same way as SAT contacts.
+ *
+ */
+
+class GJKCollision;
+
+#include"objects/object.h"
+#include"physics/physStruct.h"
+
+// Penetration depth needed to register collision, matches SAT tests
+#define NTW_GJK_THRESHOLD	0.0001f
+
+// Iteration limits of GJK and EPA
+#define NTW_GJK_MAX_ITERATIONS	32
+#define NTW_EPA_MAX_ITERATIONS	64
+
+// EPA stops once a new support point is closer than this to the nearest polytope face
+#define NTW_EPA_TOLERANCE	0.0001f
+
+// Cosine between a face normal and the penetration normal for contacts to be clipped from that face
+// Pairs without such a face touch edge to edge and get a single contact
+#define NTW_GJK_FACE_ALIGNMENT	0.999f
+
+
+class GJKCollision{
+
+	// Colliders
+	const Collider* collider1_;
+	const Collider* collider2_;
+
+	GJKBuffers& buffers_;
+
+	// Simplex of the Minkowski difference of the first hitbox minus the second
+	GJKSimplex simplex_;
+
+	// Penetration normal pointing from the first collider towards the second, and depth along it
+	Vec3 normal_;
+	float depth_;
+
+	// Deepest point of each collider inside the other
+	Vec3 witness1_;
+	Vec3 witness2_;
+
+	SATContactInfo contactInfo_;
+
+	// Last support vertex found on each hitbox, support queries climb from here
+	int supportVertex1_;
+	int supportVertex2_;
+
+
+	GJKVertex getSupport(const Vec3& direction);
+	Vec3 getSupportPoint(const Collider* collider, const Vec3& direction, int& vertex) const;
+
+	// Reduce simplex to the vertices supporting its point closest to the origin, and return that point
+	Vec3 reduceSimplex();
+
+	// Grow a simplex touching the origin into a tetrahedron, returns false if the hitboxes only touch
+	bool expandSimplex();
+
+	// Expand the simplex into a polytope until its face closest to the origin is on the Minkowski difference
+	bool expandPolytope();
+	void addFace(int vertex1, int vertex2, int vertex3, const Vec3& interior);
+
+	static Vec3 getClosestOnSegment(const GJKVertex& a, const GJKVertex& b, GJKVertex* simplex, int& size);
+	static Vec3 getClosestOnTriangle(const GJKVertex& a, const GJKVertex& b, const GJKVertex& c, GJKVertex* simplex, int& size);
+
+	// Face with the normal closest to direction, and the cosine between them
+	static int findFace(const TransformedHitbox& hitbox, const Vec3& direction, float& alignment);
+
+public:
+	GJKCollision(const Collider* collider1, const Collider* collider2, GJKBuffers& buffers);
+
+	// Test collision, returns true if objects are colliding
+	bool testCollision();
+
+	// Get penetration vector and object contact points in world space
+	ContactManifold getContactPoints();
+
+	// Start the next test from a simplex found by an earlier test of the same colliders
+	void setSimplex(const GJKSimplex& simplex);
+	void setSupportVertices(int vertex1, int vertex2);
+
+	const GJKSimplex& getSimplex() const;
+	SATContactInfo getContactInfo() const;
+	int getSupportVertex1() const;
+	int getSupportVertex2() const;
+};
@@ -15,6 +15,16 @@
 // Margin to enlarge portal AABBs by
 #define NTW_AABB_PORTAL_MARGIN 0.25f
 
+// Number of bins static colliders are sorted into along the split axis when building the static tree
+#define NTW_AABB_STATIC_BINS 16
+
+
+// Number of threads for narrowphase and solving islands, 0 to use one per hardware thread
+#define NTW_PHYS_THREADS 0
+
+// Number of broadphase pairs tested by a thread at a time
+#define NTW_PHYS_NARROWPHASE_BATCH 16
+
 
 // Maximum number of constraint resolution iterations for rigid bodies
 #define NTW_PHYS_MAX_CONSTRAINT_ITER 10
@@ -22,6 +32,53 @@
 // Threshold for considering a constraint solved
 #define NTW_PHYS_CONSTRAINT_THRESHOLD 0.0001f
 
+// Fraction of the previous update's accumulated impulse applied when warm starting contacts
+#define NTW_PHYS_WARM_START_FAC 1.0f
+
+// Maximum distance a contact point can move between updates and still be warm started
+#define NTW_PHYS_WARM_START_DISTANCE 0.05f
+
+// Maximum number of contacts kept between a pair of colliders
+#define NTW_PHYS_MAX_MANIFOLD_CONTACTS 4
+
+// Fraction added to the diagonal of a manifold's normal impulse matrix when block solving
+// Keeps coplanar contacts solvable and spreads their impulses evenly
+#define NTW_PHYS_BLOCK_REGULARIZATION 0.001f
+
+// Minimum number of contact constraints in an island for solving it in batches
+#define NTW_PHYS_BATCH_MIN_CONSTRAINTS 32
+
+
+// Fraction of its smallest half extent an object with continuous collision must move in an update to be swept
+#define NTW_PHYS_CCD_MOTION_FAC 0.5f
+
+
+// Maximum number of casts sliding a character along the surfaces it hits in an update
+#define NTW_PHYS_CHARACTER_MAX_CASTS 3
+
+// Distance characters stop short of surfaces, so they start the next update without touching them
+#define NTW_PHYS_CHARACTER_SKIN 0.01f
+
+// Height of obstacles characters step onto while moving along the ground
+#define NTW_PHYS_CHARACTER_STEP_HEIGHT 0.2f
+
+// Minimum cosine of the angle between a surface normal and up for characters to stand on it
+#define NTW_PHYS_CHARACTER_WALKABLE 0.707f
+
+
+// Maximum number of portals a ray query passes through, rays reaching another portal after this end there
+#define NTW_PHYS_RAY_MAX_PORTALS 4
+
+
+// Velocity below which an object starts counting towards sleeping
+#define NTW_PHYS_SLEEP_VELOCITY 0.05f
+
+// Angular velocity below which an object starts counting towards sleeping
+#define NTW_PHYS_SLEEP_ANGULAR_VELOCITY 0.05f
+
+// Time every object in an island must be resting before the island sleeps (seconds)
+#define NTW_PHYS_SLEEP_TIME 0.5f
+
 
 // Baumgarte stabilization factor for collisions
 #define NTW_PHYS_BAUMGARTE_FAC 0.1f
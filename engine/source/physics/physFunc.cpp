@@ -1,20 +1,32 @@
 #include"physFunc.h"
 
+#include"physics/physDefine.h"
 #include"core/error.h"
+#include<algorithm>
+#include<math.h>
+#include<limits>
 
+using std::min;
+using std::max;
 
 
 
-float ntw::getFaceToPointDistance(const SATFace& f, const Vec3& v){
+
+float ntw::getFaceToPointDistance(const SATPlane& f, const Vec3& v){
 	return f.normal * (v - f.position);
 }
 
-float ntw::getEdgeToEdgeDistance(const Hitbox& hitbox1, int edgeIndex1, const Hitbox& hitbox2, int edgeIndex2){
+float ntw::getEdgeToEdgeDistance(const TransformedHitbox& hitbox1, int edgeIndex1, const TransformedHitbox& hitbox2, int edgeIndex2){
+
+	const SATHalfEdge& e1 = hitbox1.hitbox->edges[edgeIndex1];
+	const SATHalfEdge& e2 = hitbox2.hitbox->edges[edgeIndex2];
+
+	return getEdgeToEdgeDistance(hitbox1.vertices[e1.v1], hitbox1.vertices[e1.v2], hitbox1.center, hitbox2.vertices[e2.v1], hitbox2.vertices[e2.v2]);
+}
 
-	const SATHalfEdge& e1 = hitbox1.edges[edgeIndex1];
-	const SATHalfEdge& e2 = hitbox2.edges[edgeIndex2];
+float ntw::getEdgeToEdgeDistance(const Vec3& a1, const Vec3& a2, const Vec3& center1, const Vec3& b1, const Vec3& b2){
 
-	Vec3 cross = ntw::crossProduct(hitbox1.vertices[e1.v1] - hitbox1.vertices[e1.v2], hitbox2.vertices[e2.v1] - hitbox2.vertices[e2.v2]);
+	Vec3 cross = ntw::crossProduct(a1 - a2, b1 - b2);
 
 	// Ignore parallel edges
 	if(cross.magnitude2() < 0.00001f)
@@ -23,37 +35,33 @@ float ntw::getEdgeToEdgeDistance(const Hitbox& hitbox1, int edgeIndex1, const Hi
 
 	cross.normalize();
 
-	// Get hitbox center
-	Vec3 center;
-
-	for(const Vec3& v : hitbox1.vertices)
-		center += v;
-
-	center /= (float)hitbox1.vertices.size();
-
 	// Check normal direction
-	if(cross * (hitbox1.vertices[e1.v1] - center) < 0)
+	if(cross * (a1 - center1) < 0)
 		cross = -cross;
 
-	return cross * (hitbox2.vertices[e2.v1] - hitbox1.vertices[e1.v1]);
+	return cross * (b1 - a1);
 }
 
 
-vector<SATFace> ntw::getClippingPlanes(const Hitbox& hitbox, int faceIndex){
+vector<SATPlane> ntw::getClippingPlanes(const TransformedHitbox& hitbox, int faceIndex){
 
-	const SATFace& face = hitbox.faces[faceIndex];
-	vector<SATFace> clippingPlanes;
+	const SATPlane& face = hitbox.faces[faceIndex];
+	vector<SATPlane> clippingPlanes;
 
-	for(int edgeIndex : face.edges){
+	for(int edgeIndex : hitbox.hitbox->faces[faceIndex].edges){
 
 		// Current edge
-		const SATHalfEdge& e = hitbox.edges[edgeIndex];
+		const SATHalfEdge& e = hitbox.hitbox->edges[edgeIndex];
 
 		// Create clipping plane
-		SATFace plane;
+		SATPlane plane;
 		plane.position = hitbox.vertices[e.v1];
 		plane.normal = ntw::crossProduct(hitbox.vertices[e.v2] - plane.position, face.normal);
 
+		// Edges welded to a single vertex have no direction, and would clip away every point
+		if(plane.normal.magnitude2() < 0.00001f * 0.00001f)
+			continue;
+
 		// Check normal direction, normal should face towards center of original face
 		if(plane.normal * (face.position - plane.position) < 0)
 			plane.normal = -plane.normal;
@@ -64,65 +72,80 @@ vector<SATFace> ntw::getClippingPlanes(const Hitbox& hitbox, int faceIndex){
 	return clippingPlanes;
 }
 
-vector<Vec3> ntw::clipFaces(const Hitbox& hitbox1, int faceIndex1, const Hitbox& hitbox2, int faceIndex2){
+vector<ClipPoint> ntw::getFaceVertices(const TransformedHitbox& hitbox, int faceIndex){
 
-	const SATFace& f1 = hitbox1.faces[faceIndex1];
-	const SATFace& f2 = hitbox2.faces[faceIndex2];
+	vector<ClipPoint> points;
 
-	// Get clipping planes
-	vector<SATFace> clippingPlanes = ntw::getClippingPlanes(hitbox1, faceIndex1);
+	// Make a copy of face edges
+	vector<SATHalfEdge> faceEdges;
 
-	// Points to clip
-	vector<Vec3> points;
+	for(int edgeIndex : hitbox.hitbox->faces[faceIndex].edges)
+		faceEdges.push_back(hitbox.hitbox->edges[edgeIndex]);
 
-	// Make a copy of second face edges
-	vector<SATHalfEdge> f2Edges;
 
-	for(int edgeIndex : f2.edges)
-		f2Edges.push_back(hitbox2.edges[edgeIndex]);
+	// Check if a vertex has already been added
+	auto l_contains = [&points](int vertex){
+		for(const ClipPoint& p : points)
+			if(p.feature == vertex)
+				return true;
 
+		return false;
+	};
 
-	// Get vertices of second face, adding them in a cyclic order
-	while(!f2Edges.empty()){
+
+	// Add vertices in a cyclic order
+	while(!faceEdges.empty()){
+
+		size_t numEdges = faceEdges.size();
 
 		// Loop through remaining edges, adding one when its vertices overlap with the last added vertex
-		for(auto i = f2Edges.begin(); i != f2Edges.end(); i++){
+		for(auto i = faceEdges.begin(); i != faceEdges.end(); i++){
 
 			// Edge vertices
-			const Vec3& v1 = hitbox2.vertices[(*i).v1];
-			const Vec3& v2 = hitbox2.vertices[(*i).v2];
+			const Vec3& v1 = hitbox.vertices[(*i).v1];
+			const Vec3& v2 = hitbox.vertices[(*i).v2];
 
 			// Initial points
 			if(points.empty()){
-				points.push_back(v1);
-				points.push_back(v2);
-				f2Edges.erase(i);
+				points.push_back({v1, (*i).v1});
+				points.push_back({v2, (*i).v2});
+				faceEdges.erase(i);
 				break;
 			}
 
 			// v1 overlaps with last vertex and v2 not present in list
-			if(v1.equalsWithinThreshold(points[points.size() - 1], 0.00001f)){
-				if(std::find(points.begin(), points.end(), v2) == points.end())
-					points.push_back(v2);
-				f2Edges.erase(i);
+			if(v1.equalsWithinThreshold(points[points.size() - 1].position, 0.00001f)){
+				if(!l_contains((*i).v2))
+					points.push_back({v2, (*i).v2});
+				faceEdges.erase(i);
 				break;
 			}
 
 			// v2 overlaps with last vertex and v1 not present in list
-			else if(v2.equalsWithinThreshold(points[points.size() - 1], 0.00001f)){
-				if(std::find(points.begin(), points.end(), v1) == points.end())
-					points.push_back(v1);
-				f2Edges.erase(i);
+			else if(v2.equalsWithinThreshold(points[points.size() - 1].position, 0.00001f)){
+				if(!l_contains((*i).v1))
+					points.push_back({v1, (*i).v1});
+				faceEdges.erase(i);
 				break;
 			}
 		}
+
+		// Remaining edges are not connected to the last vertex, stop to avoid looping forever
+		if(faceEdges.size() == numEdges)
+			break;
 	}
 
-	// Clipping
-	for(const SATFace& plane : clippingPlanes){
+	return points;
+}
+
+vector<ClipPoint> ntw::clipPolygon(vector<ClipPoint> points, const vector<SATPlane>& clippingPlanes){
+
+	for(int planeIndex = 0; planeIndex < clippingPlanes.size(); planeIndex++){
+
+		const SATPlane& plane = clippingPlanes[planeIndex];
 
 		// Clipped points
-		vector<Vec3> output;
+		vector<ClipPoint> output;
 
 		// Clip each pair of points
 		for(int i = 0; i < points.size(); i++){
@@ -132,18 +155,23 @@ vector<Vec3> ntw::clipFaces(const Hitbox& hitbox1, int faceIndex1, const Hitbox&
 			j = j >= points.size() ? 0 : j;
 
 			// Points
-			Vec3 v1 = points[i];
-			Vec3 v2 = points[j];
+			const ClipPoint& v1 = points[i];
+			const ClipPoint& v2 = points[j];
 
 			// Which side of clipping plane the points are on
-			bool v1Front = getFaceToPointDistance(plane, v1) > 0;
-			bool v2Front = getFaceToPointDistance(plane, v2) > 0;
+			float d1 = getFaceToPointDistance(plane, v1.position);
+			float d2 = getFaceToPointDistance(plane, v2.position);
+
+			bool v1Front = d1 > 0;
+			bool v2Front = d2 > 0;
 
 
 			// Function to get point of intersection between line and plane
-			auto l_intersect = [](const Vec3& v1, const Vec3& v2, const SATFace& f){
-				Vec3 dir = v2 - v1;
-				return v1 + ((((f.position - v1) * f.normal) / (dir * f.normal)) * dir);
+			// Interpolate by the distances already found, a segment lying almost in the plane
+			// can have its direction round to perpendicular to the normal and divide by zero
+			auto l_intersect = [planeIndex, d1, d2](const ClipPoint& v1, const ClipPoint& v2){
+				Vec3 position = v1.position + ((v2.position - v1.position) * (d1 / (d1 - d2)));
+				return ClipPoint{position, ntw::getClipFeature(v1.feature, v2.feature, planeIndex)};
 			};
 
 
@@ -152,14 +180,14 @@ vector<Vec3> ntw::clipFaces(const Hitbox& hitbox1, int faceIndex1, const Hitbox&
 
 				// If the line segment crosses the clipping plane, add intersecting point
 				if(!v1Front)
-					output.push_back(l_intersect(v1, v2, plane));
+					output.push_back(l_intersect(v1, v2));
 
 				output.push_back(v2);
 			}
 
 			// Start point in front, end point behind
 			else if(v1Front)
-				output.push_back(l_intersect(v1, v2, plane));
+				output.push_back(l_intersect(v1, v2));
 
 		}
 
@@ -169,49 +197,477 @@ vector<Vec3> ntw::clipFaces(const Hitbox& hitbox1, int faceIndex1, const Hitbox&
 	return points;
 }
 
-float ntw::raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Hitbox& hitbox){
+int ntw::getClipFeature(int feature1, int feature2, int plane){
 
-	bool inside = true;
+	// Hash of both features and the plane, kept positive so -1 stays free for unclipped contacts
+	unsigned int hash = (unsigned int)feature1 * 73856093u;
+	hash ^= (unsigned int)feature2 * 19349663u;
+	hash ^= (unsigned int)(plane + 1) * 83492791u;
+
+	return (int)(hash & 0x7fffffff);
+}
+
+vector<ClipPoint> ntw::clipFaces(const TransformedHitbox& hitbox1, int faceIndex1, const TransformedHitbox& hitbox2, int faceIndex2){
+	return ntw::clipPolygon(ntw::getFaceVertices(hitbox2, faceIndex2), ntw::getClippingPlanes(hitbox1, faceIndex1));
+}
+
+void ntw::reduceContacts(vector<Contact>& contacts){
+
+	if(contacts.size() <= NTW_PHYS_MAX_MANIFOLD_CONTACTS)
+		return;
+
+	// Clipped contacts share a normal, areas are measured in the plane perpendicular to it
+	const Vec3& normal = contacts[0].normal;
+
+	auto l_area = [&contacts, &normal](int a, int b, int c){
+		const Vec3& p = contacts[a].obj1ContactGlobal;
+		return ntw::crossProduct(contacts[b].obj1ContactGlobal - p, contacts[c].obj1ContactGlobal - p) * normal;
+	};
+
+
+	// Deepest contact keeps penetration from building up
+	int a = 0;
+
+	for(int i = 1; i < contacts.size(); i++)
+		if(contacts[i].depth > contacts[a].depth)
+			a = i;
+
+	// Contact furthest from it
+	int b = a;
+	float bestDistance = 0;
+
+	for(int i = 0; i < contacts.size(); i++){
+		float distance = (contacts[i].obj1ContactGlobal - contacts[a].obj1ContactGlobal).magnitude2();
+
+		if(distance > bestDistance){
+			b = i;
+			bestDistance = distance;
+		}
+	}
+
+	// Contact making the largest triangle with both, on either side of them
+	int c = a;
+	float bestArea = 0;
+
+	for(int i = 0; i < contacts.size(); i++){
+		float area = l_area(a, b, i);
+
+		if(abs(area) > abs(bestArea)){
+			c = i;
+			bestArea = area;
+		}
+	}
+
+	// Wind the triangle counterclockwise around the normal
+	if(bestArea < 0)
+		std::swap(b, c);
+
+	// Contact adding the most area outside the triangle, lies behind one of its edges
+	int d = a;
+	bestArea = 0;
+
+	for(int i = 0; i < contacts.size(); i++){
+		float area = max(-l_area(a, b, i), max(-l_area(b, c, i), -l_area(c, a, i)));
+
+		if(area > bestArea){
+			d = i;
+			bestArea = area;
+		}
+	}
+
+	// Keep distinct contacts, the triangle and fourth contact are skipped when all points are collinear
+	int kept[4] = {a, b, c, d};
+	vector<Contact> reduced;
+
+	for(int i = 0; i < 4; i++)
+		if(std::find(kept, kept + i, kept[i]) == kept + i)
+			reduced.push_back(contacts[kept[i]]);
+
+	contacts = reduced;
+}
+
+
+Vec3 ntw::getSupportPoint(const TransformedHitbox& hitbox, const Vec3& direction, int& vertex){
+
+	const vector<int>& neighbourStart = hitbox.hitbox->neighbourStart;
+	const vector<int>& neighbours = hitbox.hitbox->vertexNeighbours;
+
+	// Start from the given vertex, which may belong to a different hitbox if the pair has changed
+	if(vertex < 0 || vertex >= hitbox.vertices.size())
+		vertex = 0;
+
+	float maxProduct = direction * hitbox.vertices[vertex];
+
+	// No adjacency, check every vertex
+	if(neighbourStart.empty()){
+		for(int i = 0; i < hitbox.vertices.size(); i++){
+			float product = direction * hitbox.vertices[i];
+
+			if(product > maxProduct){
+				vertex = i;
+				maxProduct = product;
+			}
+		}
+
+		return hitbox.vertices[vertex];
+	}
+
+	// Move to neighbours further along the direction until there are none
+	// Hitbox is convex, so a vertex without a better neighbour is a support vertex
+	for(int current = -1; current != vertex;){
+		current = vertex;
+
+		for(int i = neighbourStart[current]; i < neighbourStart[current + 1]; i++){
+			float product = direction * hitbox.vertices[neighbours[i]];
+
+			if(product > maxProduct){
+				vertex = neighbours[i];
+				maxProduct = product;
+			}
+		}
+	}
+
+	return hitbox.vertices[vertex];
+}
+
+bool ntw::setContactProperties(Contact& c, const Object* object1, const Object* object2){
+
+	c.depth = (c.obj2ContactGlobal - c.obj1ContactGlobal) * c.normal;
+
+	// Check validity
+	if(c.depth < 0)
+		return false;
+
+
+	// Contact vector
+	c.obj1ContactVector = c.obj1ContactGlobal - object1->getTPosition();
+	c.obj2ContactVector = c.obj2ContactGlobal - object2->getTPosition();
+
+	// Contact tangents
+	if(c.normal[0] >= 0.57735f)
+		c.tangent1 = Vec3(c.normal[1], -c.normal[0], 0);
+	else
+		c.tangent1 = Vec3(0, c.normal[2], -c.normal[1]);
+
+	c.tangent1.normalize();
+	c.tangent2 = ntw::crossProduct(c.normal, c.tangent1);
+
+	return true;
+}
+
+
+float ntw::castHitbox(const Collider& moving, const Vec3& offset, const Vec3& sweep, const Collider& other, Vec3& normal){
+
+	// Interval of a collider's vertices projected onto a world axis
+	auto l_project = [](const Collider& collider, const Vec3& axis, float& minProj, float& maxProj) -> void {
+		Vec3 local = collider.rotation.getTranspose() * axis;
+		float offset = axis * collider.position;
+		int vertex = 0;
+
+		maxProj = getSupportPoint(collider.hitboxScaled, local, vertex) * local + offset;
+		minProj = getSupportPoint(collider.hitboxScaled, -local, vertex) * local + offset;
+	};
+
+	// Colliders overlap at a time between 0 and 1 if their projections overlap on every axis at that time
+	// The moving collider is moved by offset + t * sweep at time t
+	float enter = -std::numeric_limits<float>::max();
+	float exit = std::numeric_limits<float>::max();
+
+	// Axis the colliders can be separated along with the least movement, for colliders overlapping at the start
+	float minDepth = std::numeric_limits<float>::max();
+	Vec3 depthNormal;
+
+	auto l_testAxis = [&](const Vec3& axis) -> bool {
+		float min1, max1, min2, max2;
+		l_project(moving, axis, min1, max1);
+		l_project(other, axis, min2, max2);
+
+		// Offset along axis must be between these to overlap
+		float start = offset * axis;
+		float lower = min2 - max1 - start;
+		float upper = max2 - min1 - start;
+		float speed = sweep * axis;
+
+		if(lower <= 0 && upper >= 0 && min(-lower, upper) < minDepth){
+			minDepth = min(-lower, upper);
+			depthNormal = -lower < upper ? -axis : axis;
+		}
+
+		// Not moving along axis, projections either always or never overlap
+		if(abs(speed) < 0.000001f)
+			return lower <= 0 && upper >= 0;
+
+		float t1 = lower / speed;
+		float t2 = upper / speed;
+
+		if(t1 > t2)
+			std::swap(t1, t2);
+
+		// Latest time projections start to overlap
+		if(t1 > enter){
+			enter = t1;
+			normal = speed > 0 ? -axis : axis;
+		}
+
+		exit = min(exit, t2);
+
+		return enter <= exit && enter <= 1 && exit >= 0;
+	};
+
+	for(const SATPlane& face : moving.hitboxScaled.faces)
+		if(!l_testAxis(moving.rotation * face.normal))
+			return -1;
+
+	for(const SATPlane& face : other.hitboxScaled.faces)
+		if(!l_testAxis(other.rotation * face.normal))
+			return -1;
+
+	// World direction of a unique edge direction of the shared hitbox
+	auto l_edgeDirection = [](const Collider& collider, const Vec3& direction) -> Vec3 {
+		Vec3 d = direction;
+		d *= collider.hitboxScale;
+
+		return collider.rotation * d.unitVector();
+	};
+
+	// Edges can touch before any face does when colliders approach edge first
+	for(const Vec3& e1 : moving.hitbox->edgeDirections){
+		Vec3 d1 = l_edgeDirection(moving, e1);
+
+		for(const Vec3& e2 : other.hitbox->edgeDirections){
+			Vec3 axis = ntw::crossProduct(d1, l_edgeDirection(other, e2));
+
+			// Parallel edges are covered by the face normals
+			if(axis.magnitude2() < 0.000001f)
+				continue;
+
+			if(!l_testAxis(axis.unitVector()))
+				return -1;
+		}
+	}
+
+	// Already overlapping at the start, only a hit if moving further in
+	if(enter < 0){
+		normal = depthNormal;
+		return sweep * normal < 0 ? 0 : -1;
+	}
+
+	return enter;
+}
+
+float ntw::getTimeOfImpact(const Collider& moving, const Vec3& sweep, const Collider& other, Vec3& normal){
+
+	// Moving collider starts a whole sweep back
+	float time = castHitbox(moving, -sweep, sweep, other, normal);
+
+	return time > 0 ? time : -1;
+}
+
+
+float ntw::raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const TransformedHitbox& hitbox, int& face){
+
+	// Hitbox is convex, so the ray is inside between the last face it enters and the first face it exits
+	float enter = 0;
+	float exit = maxDistance;
+	face = -1;
 
 	for(int i = 0; i < hitbox.faces.size(); i++){
 
-		const SATFace& face = hitbox.faces[i];
+		const SATPlane& f = hitbox.faces[i];
 
-		// Check case where ray begins inside hitbox
-		if(inside && ntw::getFaceToPointDistance(face, rayPosition) < 0)
-			inside = false;
+		float distance = ntw::getFaceToPointDistance(f, rayPosition);
+		float speed = f.normal * rayDirection;
+
+		// Parallel to face, missed if outside of it
+		if(abs(speed) < 0.000001f){
+			if(distance > 0)
+				return -1;
 
-		// Check only faces with normals opposite to the ray (closest faces on hitbox)
-		if(face.normal * rayDirection > 0)
 			continue;
+		}
 
-		// Find point where ray intersects face
-		float d = ((face.position - rayPosition) * face.normal) / (rayDirection * face.normal);
+		float d = -distance / speed;
 
-		// Discard intersections behind ray position and further than maximum distance
-		if(d <= 0 || d > maxDistance)
-			continue;
+		// Ray moves into hitbox through faces it moves against
+		if(speed < 0){
+			if(d > enter){
+				enter = d;
+				face = i;
+			}
+		}
+		else
+			exit = min(exit, d);
+
+		if(enter > exit)
+			return -1;
+	}
+
+	// Ray cast from inside hitbox has distance 0 and no face
+	return enter;
+}
+
+float ntw::raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const TransformedHitbox& hitbox){
+	int face;
+	return ntw::raycast(rayPosition, rayDirection, maxDistance, hitbox, face);
+}
+
+float ntw::raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Collider& collider){
+	int face;
+	return ntw::raycast(rayPosition, rayDirection, maxDistance, collider, face);
+}
+
+float ntw::raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Collider& collider, int& face){
+
+	// Move ray into collider space, distances are kept since the scale is part of the hitbox
+	Mat3 rotationInv = collider.rotation.getTranspose();
+
+	return ntw::raycast(rotationInv * (rayPosition - collider.position), rotationInv * rayDirection, maxDistance, collider.hitboxScaled, face);
+}
+
+
+bool ntw::overlapsAABB(const Collider& collider, const Vec3& lowerBound, const Vec3& upperBound){
+
+	Vec3 center = (lowerBound + upperBound) / 2;
+	Vec3 extents = upperBound - center;
+
+	Mat3 rotationInv = collider.rotation.getTranspose();
+	int vertex = 0;
+
+	// Separating axis test with the box axes, the collider's face normals and the cross products of their edges
+	auto l_separated = [&](const Vec3& axis) -> bool {
 
-		// Intersection point
-		Vec3 p = rayPosition + rayDirection * d;
+		// Parallel edges have no cross product
+		if(axis.magnitude2() < 0.000001f)
+			return false;
 
-		// Check that point is on face by checking against face clipping planes
-		vector<SATFace> clippingPlanes = ntw::getClippingPlanes(hitbox, i);
+		float boxCenter = center * axis;
+		float boxRadius = abs(axis[0]) * extents[0] + abs(axis[1]) * extents[1] + abs(axis[2]) * extents[2];
 
-		for(const SATFace& plane : clippingPlanes)
-			if(ntw::getFaceToPointDistance(plane, p) < 0)
-				goto faceLoop;
+		Vec3 local = rotationInv * axis;
+		float offset = axis * collider.position;
+		float maxProj = getSupportPoint(collider.hitboxScaled, local, vertex) * local + offset;
+		float minProj = getSupportPoint(collider.hitboxScaled, -local, vertex) * local + offset;
 
+		return maxProj < boxCenter - boxRadius || minProj > boxCenter + boxRadius;
+	};
 
-		// Intersection found, return distance
-		return d;
+	const Vec3 axes[3] = {Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1)};
 
-	faceLoop:;
+	for(const Vec3& axis : axes)
+		if(l_separated(axis))
+			return false;
+
+	for(const SATPlane& f : collider.hitboxScaled.faces)
+		if(l_separated(collider.rotation * f.normal))
+			return false;
+
+	const vector<Vec3>& vertices = collider.hitboxScaled.vertices;
+
+	for(const SATHalfEdge& e : collider.hitboxScaled.hitbox->edges){
+		Vec3 edge = collider.rotation * (vertices[e.v2] - vertices[e.v1]);
+
+		for(const Vec3& axis : axes)
+			if(l_separated(ntw::crossProduct(edge, axis)))
+				return false;
+	}
+
+	return true;
+}
+
+bool ntw::overlapsSphere(const Collider& collider, const Vec3& center, float radius){
+
+	const TransformedHitbox& hitbox = collider.hitboxScaled;
+	const HitboxPrimitive& primitive = hitbox.primitive;
+
+	// Test in collider space
+	Vec3 local = collider.rotation.getTranspose() * (center - collider.position);
+
+	// Closed form tests for primitives
+	if(primitive.shape == HitboxShape::SPHERE)
+		return (local - primitive.center).magnitude2() <= (radius + primitive.radius) * (radius + primitive.radius);
+
+	if(primitive.shape == HitboxShape::CAPSULE){
+		Vec3 v = local - primitive.center;
+		float z = max(-primitive.halfHeight, min(primitive.halfHeight, v[2]));
+		v.setZ(v[2] - z);
+		return v.magnitude2() <= (radius + primitive.radius) * (radius + primitive.radius);
+	}
+
+	if(primitive.shape == HitboxShape::BOX){
+		Vec3 v = local - primitive.center;
+		float distance2 = 0;
+
+		for(int i = 0; i < 3; i++){
+			float d = max(abs(v[i]) - primitive.halfExtents[i], 0.0f);
+			distance2 += d * d;
+		}
+
+		return distance2 <= radius * radius;
+	}
+
+
+	// Hulls, separated if the center is further than the radius in front of a face
+	bool inside = true;
+
+	for(const SATPlane& f : hitbox.faces){
+		float d = (local - f.position) * f.normal;
+
+		if(d > radius)
+			return false;
+
+		if(d > 0)
+			inside = false;
 	}
 
-	// Ray cast from inside hitbox, return distance 0
 	if(inside)
-		return 0;
+		return true;
+
+	// Closest point is inside a face the center is in front of, or on an edge
+	const vector<Vec3>& vertices = hitbox.vertices;
+
+	for(int i = 0; i < hitbox.faces.size(); i++){
+		const SATPlane& f = hitbox.faces[i];
+		float d = (local - f.position) * f.normal;
+
+		if(d <= 0)
+			continue;
+
+		Vec3 point = local - (f.normal * d);
+		const vector<int>& edges = hitbox.hitbox->faces[i].edges;
+
+		// Edges are not ordered around the face, compare each side of the point to the face's center
+		Vec3 faceCenter;
+
+		for(int e : edges)
+			faceCenter += vertices[hitbox.hitbox->edges[e].v1] + vertices[hitbox.hitbox->edges[e].v2];
+
+		faceCenter /= 2 * (float)edges.size();
+
+		bool inFace = true;
+
+		for(int e : edges){
+			const Vec3& a = vertices[hitbox.hitbox->edges[e].v1];
+			const Vec3& b = vertices[hitbox.hitbox->edges[e].v2];
+
+			if((ntw::crossProduct(b - a, point - a) * f.normal) * (ntw::crossProduct(b - a, faceCenter - a) * f.normal) < 0){
+				inFace = false;
+				break;
+			}
+		}
+
+		if(inFace)
+			return true;
+	}
+
+	for(const SATHalfEdge& e : hitbox.hitbox->edges){
+		const Vec3& a = vertices[e.v1];
+		Vec3 ab = vertices[e.v2] - a;
+
+		float t = max(0.0f, min(1.0f, ((local - a) * ab) / ab.magnitude2()));
+
+		if((local - (a + (ab * t))).magnitude2() <= radius * radius)
+			return true;
+	}
 
-	return -1;
+	return false;
 }
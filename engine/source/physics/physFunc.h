@@ -2,17 +2,65 @@
 
 #include"math/vec3.h"
 #include"objects/collider.h"
+#include"physics/physStruct.h"
 
 
 namespace ntw{
 
-	float getFaceToPointDistance(const SATFace& f, const Vec3& v);
-	float getEdgeToEdgeDistance(const Hitbox& hitbox1, int edgeIndex1, const Hitbox& hitbox2, int edgeIndex2);
+	float getFaceToPointDistance(const SATPlane& f, const Vec3& v);
+	float getEdgeToEdgeDistance(const TransformedHitbox& hitbox1, int edgeIndex1, const TransformedHitbox& hitbox2, int edgeIndex2);
 
+	// Edges given by their end points, the first hitbox's center sets the direction of the axis
+	float getEdgeToEdgeDistance(const Vec3& a1, const Vec3& a2, const Vec3& center1, const Vec3& b1, const Vec3& b2);
 
-	vector<SATFace> getClippingPlanes(const Hitbox& hitbox, int faceIndex);
-	vector<Vec3> clipFaces(const Hitbox& hitbox1, int faceIndex1, const Hitbox& hitbox2, int faceIndex2);
 
+	vector<SATPlane> getClippingPlanes(const TransformedHitbox& hitbox, int faceIndex);
 
-	float raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Hitbox& hitbox);
+	// Face vertices in cyclic order, each point's feature is its vertex index
+	vector<ClipPoint> getFaceVertices(const TransformedHitbox& hitbox, int faceIndex);
+	vector<ClipPoint> clipPolygon(vector<ClipPoint> points, const vector<SATPlane>& clippingPlanes);
+
+	// Feature of the point where the edge between two clipped points crosses a clipping plane
+	int getClipFeature(int feature1, int feature2, int plane);
+
+	// Clip face 2 of hitbox 2 against the sides of face 1 of hitbox 1
+	vector<ClipPoint> clipFaces(const TransformedHitbox& hitbox1, int faceIndex1, const TransformedHitbox& hitbox2, int faceIndex2);
+
+	// Keep the deepest contact and the contacts spanning the largest area, at most NTW_PHYS_MAX_MANIFOLD_CONTACTS
+	void reduceContacts(vector<Contact>& contacts);
+
+
+	// Vertex furthest along direction, found by climbing vertex adjacency from the given vertex
+	// Vertex is set to the index of the support vertex for the next query to start from
+	Vec3 getSupportPoint(const TransformedHitbox& hitbox, const Vec3& direction, int& vertex);
+
+
+	// Set contact depth, contact vectors and tangents from its points and normal, returns false if the contact is invalid
+	bool setContactProperties(Contact& c, const Object* object1, const Object* object2);
+
+
+	// Fraction of a sweep at which the moving collider first touches the other, -1 if they do not touch or already overlap at the start
+	// Moving collider is at the end of the sweep, normal is set to the touching axis pointing from the other collider towards it
+	// Face normals and cross products of edge directions are tested, as in SAT
+	float getTimeOfImpact(const Collider& moving, const Vec3& sweep, const Collider& other, Vec3& normal);
+
+	// Fraction of a sweep at which the moving collider first touches the other, -1 if they do not touch
+	// Moving collider is moved by the offset at the start of the sweep, normal is set as for getTimeOfImpact
+	// Colliders overlapping at the start touch at 0 if the sweep moves further in along the axis of least overlap
+	float castHitbox(const Collider& moving, const Vec3& offset, const Vec3& sweep, const Collider& other, Vec3& normal);
+
+
+	// Distance along a ray to a hitbox, 0 if the ray starts inside and -1 if it misses within the maximum distance
+	// Face is set to the face the ray enters through, -1 if it starts inside
+	float raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const TransformedHitbox& hitbox, int& face);
+	float raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const TransformedHitbox& hitbox);
+	float raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Collider& collider);
+	float raycast(const Vec3& rayPosition, const Vec3& rayDirection, float maxDistance, const Collider& collider, int& face);
+
+
+	// Whether a collider overlaps an AABB, testing every separating axis of a box and a hull
+	bool overlapsAABB(const Collider& collider, const Vec3& lowerBound, const Vec3& upperBound);
+
+	// Whether a collider overlaps a sphere, using the closest point of the collider to the center
+	bool overlapsSphere(const Collider& collider, const Vec3& center, float radius);
 }
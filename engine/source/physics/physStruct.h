@@ -8,8 +8,13 @@
  */
 
 #include"objects/object.h"
+#include"objects/hitbox.h"
+#include"physics/physDefine.h"
+#include<utility>
 
 class Portal;
+struct Collider;
+class PhysicsObject;
 
 
 // Pair of objects for collisions
@@ -24,7 +29,7 @@ struct ObjectPair{
 
 	// Hash for unordered_map
 	size_t operator()(const ObjectPair& a) const{
-		return reinterpret_cast<size_t>(object1) + reinterpret_cast<size_t>(object2);
+		return reinterpret_cast<size_t>(a.object1) + reinterpret_cast<size_t>(a.object2);
 	}
 };
 
@@ -46,14 +51,39 @@ struct SATContactInfo{
 };
 
 
-// Cache results of SAT collision tests
-struct SATCollisionInfo{
-	bool updated;
-	bool collided;
-	SATSeparatingAxis separatingAxis;
-	SATContactInfo contactInfo;
+// Narrowphase test used for pairs of hulls, primitive pairs always use closed form tests
+enum class NarrowphaseType{
+	SAT,
+	GJK
+};
+
+
+// Point of the Minkowski difference of two hitboxes, with the support points it was made from
+struct GJKVertex{
+	Vec3 point;
+
+	// Support points in world space and their vertex indices in each hitbox
+	Vec3 support1;
+	Vec3 support2;
+	int vertex1;
+	int vertex2;
+};
+
 
-	SATCollisionInfo() : updated(true) {}
+// Simplex from a GJK test, the next test of the pair starts from its vertices
+struct GJKSimplex{
+	GJKVertex vertices[4];
+	int size;
+
+	GJKSimplex() : size(0) {}
+};
+
+
+// Triangle of the EPA polytope, normal points away from the polytope
+struct EPAFace{
+	int vertices[3];
+	Vec3 normal;
+	float distance;
 };
 
 
@@ -82,11 +112,63 @@ struct Contact{
 	float lambdaAvgTan2;
 	int numSolves;
 
+	// Features the contact was clipped from, stays the same between updates while the same faces touch
+	// -1 for contacts that are not clipped, which are matched between updates by distance
+	int feature;
+
 	bool valid;
 	bool isNew;
 
 	Contact() : depth(0), closingSpeed(0), lambdaSum(0), lambdaSumTan1(0), lambdaSumTan2(0),
-		lambdaAvg(0), lambdaAvgTan1(0), lambdaAvgTan2(0), numSolves(0), valid(true), isNew(true) {}
+		lambdaAvg(0), lambdaAvgTan1(0), lambdaAvgTan2(0), numSolves(0), feature(-1), valid(true), isNew(true) {}
+};
+
+
+// Point of a clipped face, with the incident vertex or the edge and clipping plane it came from
+struct ClipPoint{
+	Vec3 position;
+	int feature;
+};
+
+
+// Cache results of SAT collision tests
+struct SATCollisionInfo{
+	bool updated;
+	bool collided;
+	SATSeparatingAxis separatingAxis;
+	SATContactInfo contactInfo;
+
+	// Support vertices found in the previous test, where the next support queries start
+	int supportVertex1;
+	int supportVertex2;
+
+	// Simplex found in the previous GJK test
+	GJKSimplex simplex;
+
+	// Contacts from the previous update with their accumulated impulses, for warm starting
+	vector<Contact> contacts;
+
+	SATCollisionInfo() : updated(true), supportVertex1(0), supportVertex2(0) {}
+};
+
+
+// Memory reused between SAT tests so tests do not allocate
+struct SATBuffers{
+	// Smaller hitbox moved into the space of the other collider
+	TransformedHitbox localHitbox;
+
+	// Gauss map arcs of edges in structure of arrays layout for the edge query
+	vector<float> edgeArcs;
+};
+
+
+// Memory reused between GJK tests so EPA does not allocate
+struct GJKBuffers{
+	vector<GJKVertex> polytope;
+	vector<EPAFace> faces;
+
+	// Edges of faces removed by an expansion, shared edges cancel out to leave the horizon
+	vector<std::pair<int, int>> horizon;
 };
 
 
@@ -97,7 +179,59 @@ struct ContactManifold{
 	float maxDistance;
 	bool checked;
 
-	ContactManifold() : checked(false) {}
+	// Kept from a sleeping pair without testing, has no contact constraints
+	bool sleeping;
+
+	ContactManifold() : checked(false), sleeping(false) {}
+};
+
+
+// Earliest impact of a fast object's sweep, the first object is the fast object
+// Added as a touching contact if the narrowphase finds no contact between the objects at the impact
+struct SweepImpact{
+	ObjectPair objects;
+	Contact contact;
+
+	// Collider of the fast object that hit first
+	const Collider* collider;
+
+	// Fraction of the update's motion before impact
+	float time;
+};
+
+
+// Narrowphase test result of a broadphase pair, merged into the physics engine in pair order
+struct NarrowphaseResult{
+	ObjectPair objects;
+	ContactManifold manifold;
+
+	// Cached result after the test, without contacts
+	SATCollisionInfo info;
+
+	// Pair had a cached result before the test
+	bool cached;
+
+	// Memory for the SAT test, reused between updates
+	SATBuffers satBuffers;
+	GJKBuffers gjkBuffers;
+
+	NarrowphaseResult() : cached(false) {}
+};
+
+
+// Objects connected by contacts, which sleep and wake together
+// Islands do not share movable objects, so they can be solved independently
+struct Island{
+	vector<PhysicsObject*> objects;
+
+	// Indices into the physics engine's constraint lists
+	vector<int> contactConstraints;
+	vector<int> constraints;
+
+	bool sleeping;
+	int iterations;
+
+	Island() : sleeping(false), iterations(0) {}
 };
 
 
@@ -119,7 +253,7 @@ struct ObjectPortalPair{
 
 	// Hash for unordered_map
 	size_t operator()(const ObjectPortalPair& a) const{
-		return reinterpret_cast<size_t>(object) + reinterpret_cast<size_t>(portal);
+		return reinterpret_cast<size_t>(a.object) + reinterpret_cast<size_t>(a.portal);
 	}
 };
 
@@ -131,3 +265,66 @@ struct PortalCollisionInfo{
 	bool updated;
 	bool withPlayer;
 };
+
+
+// Closest hit of a ray query, collider is null if nothing was hit
+// Position and normal are on the side of the last portal passed through, distance is along the whole path
+struct RaycastHit{
+	const Collider* collider;
+	Object* object;
+
+	Vec3 position;
+	Vec3 normal;
+	float distance;
+
+	// Face of the collider's scaled hitbox the ray entered through, -1 if the ray started inside
+	int face;
+
+	// Portals passed through before the hit, in order
+	Portal* portals[NTW_PHYS_RAY_MAX_PORTALS];
+	int numPortals;
+
+	RaycastHit() : collider(nullptr), object(nullptr), distance(0), face(-1), numPortals(0) {}
+};
+
+
+// Closest hit of a collider cast along a sweep
+struct ShapeCastHit{
+	const Collider* collider;
+	Object* object;
+
+	// Normal of the surface hit, pointing towards the cast collider
+	Vec3 normal;
+
+	// Fraction of the sweep before touching, 0 if the cast starts overlapping and moves further in
+	float time;
+
+	ShapeCastHit() : collider(nullptr), object(nullptr), time(1) {}
+};
+
+
+// Ray of a batched query, distances are measured in direction lengths
+struct RayQuery{
+	Vec3 position;
+	Vec3 direction;
+	float maxDistance;
+
+	// Object the ray passes through, such as the object casting it
+	const Object* ignore;
+
+	RayQuery() : maxDistance(0), ignore(nullptr) {}
+	RayQuery(const Vec3& position, const Vec3& direction, float maxDistance, const Object* ignore = nullptr) :
+		position(position), direction(direction), maxDistance(maxDistance), ignore(ignore) {}
+};
+
+
+// Time taken by each stage of a physics update (microseconds)
+struct PhysicsTimings{
+	float collisions;
+	float constraints;
+	float integration;
+	int constraintIterations;
+	int sleepingObjects;
+
+	PhysicsTimings() : collisions(0), constraints(0), integration(0), constraintIterations(0), sleepingObjects(0) {}
+};
@@ -5,70 +5,88 @@
 #include"core/world.h"
 #include"physics/physFunc.h"
 #include"objects/modelFunc.h"
+#include"core/timing.h"
 #include<algorithm>
 
 using std::max;
 
 
 PhysicsEngine::PhysicsEngine(World& world, vector<Object*>& objects, vector<PhysicsObject*>& physicsObjects)
-	: world_(world), objects_(objects), dynamicObjects_(physicsObjects) {
+	: world_(world), objects_(objects), dynamicObjects_(physicsObjects), threadPool_(NTW_PHYS_THREADS), warmStarting_(true), blockSolver_(true), batchSolver_(true),
+	allowSleeping_(true),
+	narrowphaseType_(NarrowphaseType::SAT) {
 
 }
 
 void PhysicsEngine::update(){
 
-	// Apply initial updates
-	for(PhysicsObject* obj : dynamicObjects_){
+	auto startTime = currentTime;
 
-		// Gravity
-		if(obj->useGravity())
-			obj->addVelocity(obj->getGravityDirection() * 12 * NTW_PHYS_TIME_DELTA);
+	// Apply initial updates
+	for(PhysicsObject* obj : dynamicObjects_)
+		if(!obj->isSleeping())
+			applyInitialUpdate(obj);
 
-		obj->tUpdatePhysics();
-	}
+	auto collisionStartTime = currentTime;
 
 	// Collision detection (in physicsEngineCollisions.cpp)
 	checkCollisions();
 
-	// Solve constraints, repeating until all constraints are satisfied
-	int iter = 0;
+	// Group objects into islands and wake islands touched by moving objects (in physicsEngineIslands.cpp)
+	updateIslands();
 
-	do{
-		// Solve and apply constraints
-		for(ContactConstraint& c : contactConstraints_){
-			c.solve();
+	auto constraintStartTime = currentTime;
 
-			// Temp update objects
-			if(c.getObjects().object1->getPhysicsType() == PhysicsType::RIGID_BODY)
-				((PhysicsObject*)c.getObjects().object1)->tUpdatePhysics();
+	// Solve islands in parallel, largest first so smaller islands fill in at the end
+	solveOrder_.clear();
 
-			if(c.getObjects().object2->getPhysicsType() == PhysicsType::RIGID_BODY)
-				((PhysicsObject*)c.getObjects().object2)->tUpdatePhysics();
-		}
+	for(int i = 0; i < (int)islands_.size(); i++)
+		if(!islands_[i].sleeping && (!islands_[i].contactConstraints.empty() || !islands_[i].constraints.empty()))
+			solveOrder_.push_back(i);
 
-		for(Constraint& c : constraints_)
-			c.solve();
+	std::stable_sort(solveOrder_.begin(), solveOrder_.end(), [this](int a, int b){
+		return islands_[a].contactConstraints.size() > islands_[b].contactConstraints.size();
+	});
 
-		iter++;
+	if(batchSolvers_.size() < islands_.size())
+		batchSolvers_.resize(islands_.size());
 
-		// Check if all constraints are satisfied
-		for(ContactConstraint& c : contactConstraints_)
-			if(!c.isSolved())
-				goto constraintLoop;
+	threadPool_.run((int)solveOrder_.size(), [this](int i){
+		solveIsland(islands_[solveOrder_[i]], batchSolvers_[solveOrder_[i]]);
+	});
 
-		for(Constraint& c : constraints_)
-			if(!c.isSolved())
-				goto constraintLoop;
+	// Iterations of the slowest island
+	int iter = 0;
 
-		// Solved, exit loop
-		break;
+	for(int i : solveOrder_)
+		iter = max(iter, islands_[i].iterations);
 
-	constraintLoop:;
-	} while(iter < NTW_PHYS_MAX_CONSTRAINT_ITER);
+	auto integrationStartTime = currentTime;
 
 	// Update all objects
 	for(PhysicsObject* obj : dynamicObjects_)
-		obj->updatePhysics();
+		if(!obj->isSleeping())
+			obj->updatePhysics();
+
+	// Put resting islands to sleep
+	updateSleeping();
+
+	auto endTime = currentTime;
+
+	// Store stage timings, integration includes the initial updates
+	timings_.collisions				= timeBetweenPrecise(collisionStartTime, constraintStartTime);
+	timings_.constraints			= timeBetweenPrecise(constraintStartTime, integrationStartTime);
+	timings_.integration			= timeBetweenPrecise(startTime, collisionStartTime) + timeBetweenPrecise(integrationStartTime, endTime);
+	timings_.constraintIterations	= iter;
+}
+
+void PhysicsEngine::applyInitialUpdate(PhysicsObject* obj){
+
+	// Gravity
+	if(obj->useGravity())
+		obj->addVelocity(obj->getGravityDirection() * 12 * NTW_PHYS_TIME_DELTA);
+
+	obj->tUpdatePhysics();
 }
 
 void PhysicsEngine::cleanup(){
@@ -76,22 +94,60 @@ void PhysicsEngine::cleanup(){
 	contactManifolds_.clear();
 	constraints_.clear();
 	contactConstraints_.clear();
+	islands_.clear();
+	satCollisions_.clear();
+	portalCollisions_.clear();
+	pairNarrowphaseTypes_.clear();
+}
+
+void PhysicsEngine::setWarmStarting(bool warmStarting){
+	warmStarting_ = warmStarting;
+}
+
+void PhysicsEngine::setBlockSolver(bool blockSolver){
+	blockSolver_ = blockSolver;
+}
+
+void PhysicsEngine::setBatchSolver(bool batchSolver){
+	batchSolver_ = batchSolver;
+}
+
+void PhysicsEngine::setNumThreads(int numThreads){
+	threadPool_.setNumThreads(numThreads);
 }
 
+void PhysicsEngine::setNarrowphaseType(NarrowphaseType type){
+	narrowphaseType_ = type;
 
-vector<Object*> PhysicsEngine::castRay(const Vec3& position, const Vec3& direction, float maxDistance){
+	// Separating axes and simplices of separated pairs are only read by the test that found them
+	for(auto i = satCollisions_.begin(); i != satCollisions_.end();){
+		if(!i->second.collided)
+			i = satCollisions_.erase(i);
+		else
+			i++;
+	}
+}
+
+void PhysicsEngine::setNarrowphaseType(Object* object1, Object* object2, NarrowphaseType type){
+	pairNarrowphaseTypes_[{object1, object2}] = type;
 
-	// TEMPORARY
-	// brute force against dynamic objects
-	vector<Object*> colliding;
+	auto i = satCollisions_.find({object1, object2});
 
-	for(PhysicsObject* pObj : dynamicObjects_)
-		if(ntw::raycast(position, direction, maxDistance, pObj->getColliders()[0].hitboxTransformed) != -1)
-			colliding.push_back(pObj);
+	if(i != satCollisions_.end() && !i->second.collided)
+		satCollisions_.erase(i);
+}
+
+void PhysicsEngine::setAllowSleeping(bool allowSleeping){
+	allowSleeping_ = allowSleeping;
 
-	return colliding;
+	// Wake all objects
+	if(!allowSleeping)
+		for(PhysicsObject* obj : dynamicObjects_)
+			if(obj->isSleeping())
+				obj->setSleeping(false);
 }
 
+
 void PhysicsEngine::addObject(Object* object){
 
 	if(object->getPhysicsType() == PhysicsType::NONE)
@@ -119,6 +175,23 @@ void PhysicsEngine::removeObject(Object* object){
 
 	for(const Collider& c : colliders)
 		aabbTree_.remove(&c);
+
+	// Wake objects the removed object was touching, their islands may have been resting on it
+	for(const ContactManifold& m : contactManifolds_){
+		if(m.objects.object1 == object)
+			m.objects.object2->wake();
+
+		else if(m.objects.object2 == object)
+			m.objects.object1->wake();
+	}
+
+	// Remove narrowphase overrides of the object's pairs
+	for(auto i = pairNarrowphaseTypes_.begin(); i != pairNarrowphaseTypes_.end();){
+		if(i->first.object1 == object || i->first.object2 == object)
+			i = pairNarrowphaseTypes_.erase(i);
+		else
+			i++;
+	}
 }
 
 void PhysicsEngine::addPortal(Portal* portal){
@@ -137,3 +210,23 @@ const vector<ContactManifold>& PhysicsEngine::getContactManifolds(){
 const unordered_map<ObjectPortalPair, PortalCollisionInfo, ObjectPortalPair>& PhysicsEngine::getPortalCollisions(){
 	return portalCollisions_;
 }
+
+const vector<Island>& PhysicsEngine::getIslands() const{
+	return islands_;
+}
+
+AABBTreeQuality PhysicsEngine::getTreeQuality() const{
+	return aabbTree_.getQuality();
+}
+
+const vector<AABBPair>& PhysicsEngine::getBroadphasePairsAdded() const{
+	return aabbTree_.getAddedPairs();
+}
+
+const vector<AABBPair>& PhysicsEngine::getBroadphasePairsRemoved() const{
+	return aabbTree_.getRemovedPairs();
+}
+
+const PhysicsTimings& PhysicsEngine::getTimings() const{
+	return timings_;
+}
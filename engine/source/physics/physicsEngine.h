@@ -14,6 +14,8 @@ class PhysicsEngine;
 #include"physics/physStruct.h"
 #include"physics/aabbTree.h"
 #include"constraints/contactConstraint.h"
+#include"constraints/contactBatchSolver.h"
+#include"core/threadPool.h"
 #include<unordered_map>
 
 using std::unordered_map;
@@ -37,12 +39,99 @@ class PhysicsEngine{
 	vector<ContactConstraint> contactConstraints_;
 
 	unordered_map<ObjectPair, SATCollisionInfo, ObjectPair> satCollisions_;
+
+	// Broadphase pairs between objects and their narrowphase results, kept to reuse allocations
+	vector<const AABBPair*> objectPairs_;
+	vector<NarrowphaseResult> narrowphaseResults_;
 	unordered_map<ObjectPortalPair, PortalCollisionInfo, ObjectPortalPair> portalCollisions_;
 
+	// Impacts of fast objects with continuous collision found in the current update
+	vector<SweepImpact> sweepImpacts_;
+
+	// Objects connected by contacts
+	vector<Island> islands_;
+	vector<int> islandParents_;
+
+	// Islands with constraints in the order they are handed to the thread pool
+	vector<int> solveOrder_;
+
+	// Workers for narrowphase and solving islands in parallel
+	ThreadPool threadPool_;
+
+	// Start solving contacts with impulses from the previous update
+	// Tall stacks only settle with the block solver also enabled
+	bool warmStarting_;
+
+	// Solve normal impulses of each manifold together
+	bool blockSolver_;
+
+	// Solve contacts of large islands 4 at a time, these islands do not use the block solver
+	// When the block solver is on, only islands where every manifold has a single contact are batch solved
+	bool batchSolver_;
+
+	// Batch solver for each island, kept to reuse allocations
+	vector<ContactBatchSolver> batchSolvers_;
+
+	// Put resting islands to sleep
+	bool allowSleeping_;
 
+	// Narrowphase test for pairs of hulls, with overrides for single pairs
+	NarrowphaseType narrowphaseType_;
+	unordered_map<ObjectPair, NarrowphaseType, ObjectPair> pairNarrowphaseTypes_;
+
+	// Timings of the last update
+	PhysicsTimings timings_;
+
+	// Rays of the current batched query still being traced, with the index of their query
+	vector<int> rayQueries_;
+	vector<Vec3> rayPositions_;
+	vector<Vec3> rayDirections_;
+	vector<float> rayDistances_;
+
+	// Distance travelled through earlier portals, closest portal crossed, and portal the ray came out of
+	vector<float> rayTravelled_;
+	vector<Portal*> rayPortals_;
+	vector<float> rayPortalDistances_;
+	vector<const Portal*> rayExitPortals_;
+
+
+	void applyInitialUpdate(PhysicsObject* obj);
+
+	// Collisions (in physicsEngineCollisions.cpp)
 	void checkCollisions();
-	void resolveCollision(const AABBPair& pair);
+	void testCollision(const AABBPair& pair, NarrowphaseResult& result) const;
+	void resolveCollision(NarrowphaseResult& result);
+	NarrowphaseType getNarrowphaseType(Object* object1, Object* object2) const;
 	void resolvePortalCollision(Object* object, Portal* portal);
+	void sweepFastObjects();
+	void moveCharacters();
+	void addSweepContacts();
+	void warmStartContacts(ContactManifold& manifold, const SATCollisionInfo& info) const;
+	void addContactConstraints(ContactManifold& manifold);
+
+	// Islands (in physicsEngineIslands.cpp)
+	void updateIslands();
+	void updateSleeping();
+	void solveIsland(Island& island, ContactBatchSolver& batchSolver);
+	bool isAwake(const Object* object) const;
+
+	// Queries (in physicsEngineQueries.cpp)
+	// Exact test of a ray against a collider found in the tree, updates hit if it is closer
+	static bool castRay(const Vec3& position, const Vec3& direction, float maxDistance, const Collider* collider, RaycastHit& hit);
+
+	// Distance at which a ray crosses a paired portal within its clip planes
+	static bool crossesPortal(const Vec3& position, const Vec3& direction, float maxDistance, Portal* portal, float& distance);
+
+	// Move a ray to the other side of a portal it crosses, and add the portal to the hit's path
+	static void passPortal(Portal* portal, float distance, Vec3& position, Vec3& direction, RaycastHit& hit);
+
+	// Characters (in physicsEngineCharacters.cpp)
+	// Slide a character along its motion, stepping onto low obstacles
+	void moveCharacter(PhysicsObject* obj);
+	bool stepCharacter(PhysicsObject* obj, Vec3& position, Vec3& motion);
+
+	// Cast a character along its motion extended by the skin distance, travel is the fraction of the motion it can move
+	bool castCharacter(PhysicsObject* obj, const Vec3& position, const Vec3& motion, ShapeCastHit& hit, float& travel);
 
 public:
 	PhysicsEngine(World& world, vector<Object*>& objects, vector<PhysicsObject*>& physicsObjects);
@@ -51,8 +140,48 @@ public:
 
 	void cleanup();
 
+	void setWarmStarting(bool warmStarting);
+	void setBlockSolver(bool blockSolver);
+	void setBatchSolver(bool batchSolver);
+	void setAllowSleeping(bool allowSleeping);
+
+	// Number of threads used for narrowphase and solving islands, 0 to use one per hardware thread
+	void setNumThreads(int numThreads);
+
+	// Narrowphase test used for pairs of hulls, globally or for a single pair of objects
+	void setNarrowphaseType(NarrowphaseType type);
+	void setNarrowphaseType(Object* object1, Object* object2, NarrowphaseType type);
+
+
+	// Ray queries against object colliders (in physicsEngineQueries.cpp)
+	// Distances are measured in direction lengths, rays starting inside a collider hit it at distance 0
+	// Rays crossing a paired portal continue from the paired portal, up to NTW_PHYS_RAY_MAX_PORTALS times
+	// Queries use the broadphase tree and must not run during an update
 
-	vector<Object*> castRay(const Vec3& position, const Vec3& direction, float maxDistance);
+	// Closest hit along a ray, returns false if nothing is hit
+	bool castRay(const Vec3& position, const Vec3& direction, float maxDistance, RaycastHit& hit, const Object* ignore = nullptr);
+
+	// Every hit along a ray sorted by distance, hits are appended to the given list
+	int castRayAll(const Vec3& position, const Vec3& direction, float maxDistance, vector<RaycastHit>& hits, const Object* ignore = nullptr);
+
+	// Closest hit of each ray, sharing one traversal of the tree between all rays
+	// Rays are traced with buffers of the engine, so only one batch can run at a time
+	void castRays(const vector<RayQuery>& rays, vector<RaycastHit>& hits);
+
+	// Closest hit of a collider moved from an object position along a sweep, keeping its rotation
+	// Collider is placed relative to the position as it is to its collider position, portals are not hit
+	// Face normals and edge cross products are tested as in SAT, so the time is exact for hulls, round shapes are cast as their hulls
+	bool castCollider(const Collider& collider, const Vec3& position, const Vec3& sweep, ShapeCastHit& hit, const Object* ignore = nullptr);
+
+	// Closest hit of any of an object's colliders moved from a position along a sweep, the object itself is not hit
+	bool castObject(const Object* object, const Vec3& position, const Vec3& sweep, ShapeCastHit& hit);
+
+
+	// Colliders overlapping an AABB or sphere, written to the given buffer up to its size
+	// Returns the number of colliders found, which is more than the buffer size if some did not fit
+	// Exact queries test hitboxes, otherwise every collider whose AABB overlaps is found, portals are never found
+	int overlapAABB(const Vec3& lowerBound, const Vec3& upperBound, const Collider** colliders, int maxColliders, bool exact = true, const Object* ignore = nullptr);
+	int overlapSphere(const Vec3& center, float radius, const Collider** colliders, int maxColliders, bool exact = true, const Object* ignore = nullptr);
 
 	void addObject(Object* object);
 	void removeObject(Object* object);
@@ -62,4 +191,14 @@ public:
 	
 	const vector<ContactManifold>& getContactManifolds();
 	const unordered_map<ObjectPortalPair, PortalCollisionInfo, ObjectPortalPair>& getPortalCollisions();
+	const vector<Island>& getIslands() const;
+	AABBTreeQuality getTreeQuality() const;
+
+	// Collider pairs that started or stopped overlapping in the broadphase during the last update
+	// Removed pairs also include pairs of objects removed since the update, reported by removeObject()
+	// Their colliders are freed with the object, so they must be read before the object is deleted
+	const vector<AABBPair>& getBroadphasePairsAdded() const;
+	const vector<AABBPair>& getBroadphasePairsRemoved() const;
+
+	const PhysicsTimings& getTimings() const;
 };
@@ -0,0 +1,126 @@
+#include"physicsEngine.h"
+
+#include"physics/physDefine.h"
+#include<algorithm>
+
+using std::min;
+using std::max;
+
+
+void PhysicsEngine::moveCharacters(){
+	for(PhysicsObject* obj : dynamicObjects_)
+		if(obj->useCharacterController() && obj->getPhysicsType() == PhysicsType::SIMPLE && !obj->isSleeping())
+			moveCharacter(obj);
+}
+
+void PhysicsEngine::moveCharacter(PhysicsObject* obj){
+
+	Vec3 up = -obj->getGravityDirection();
+	Vec3 position = obj->getPosition();
+	Vec3 motion = obj->getTPosition() - position;
+	Vec3 velocity = obj->getVelocity();
+
+	// Only characters standing on something step, once per update
+	bool canStep = obj->onGround();
+
+	for(int i = 0; i < NTW_PHYS_CHARACTER_MAX_CASTS && motion.nonzero(); i++){
+
+		ShapeCastHit hit;
+		float travel;
+
+		if(!castCharacter(obj, position, motion, hit, travel)){
+			position += motion;
+			break;
+		}
+
+		position += motion * travel;
+		motion *= 1 - travel;
+
+		bool walkable = hit.normal * up >= NTW_PHYS_CHARACTER_WALKABLE;
+
+		if(walkable)
+			obj->setOnGround(true);
+
+		// Blocked by a wall, try to step over it
+		else if(canStep){
+			canStep = false;
+
+			if(stepCharacter(obj, position, motion))
+				continue;
+		}
+
+		// Push rigid bodies in the way, up to the character's speed into them
+		if(!walkable && hit.object->getPhysicsType() == PhysicsType::RIGID_BODY){
+			PhysicsObject* body = (PhysicsObject*)hit.object;
+			float speed = (body->getVelocity() - velocity) * hit.normal;
+
+			if(speed > 0)
+				body->setVelocity(body->getVelocity() - (hit.normal * speed * min(1.0f, obj->getMass() / body->getMass())));
+		}
+
+		// Slide along the surface, removing motion and velocity into it
+		motion -= motion.clampedProjOn(-hit.normal);
+		velocity -= velocity.clampedProjOn(-hit.normal);
+	}
+
+	obj->setVelocity(velocity);
+	obj->setTPosition(position);
+	obj->cacheColliderTransform();
+}
+
+bool PhysicsEngine::stepCharacter(PhysicsObject* obj, Vec3& position, Vec3& motion){
+
+	Vec3 up = -obj->getGravityDirection();
+	Vec3 forward = motion - motion.projOn(up);
+
+	if(forward.isZero())
+		return false;
+
+	ShapeCastHit hit;
+	float travel;
+
+	// Move up, limited by anything above
+	Vec3 raise = up * NTW_PHYS_CHARACTER_STEP_HEIGHT;
+	castCharacter(obj, position, raise, hit, travel);
+
+	Vec3 stepPosition = position + (raise * travel);
+
+	// Still blocked at the raised height, obstacle is too high
+	if(castCharacter(obj, stepPosition, forward, hit, travel))
+		return false;
+
+	stepPosition += forward;
+
+	// Move back down, landing on something to stand on
+	Vec3 drop = -up * ((stepPosition - position) * up);
+
+	if(!castCharacter(obj, stepPosition, drop, hit, travel) || hit.normal * up < NTW_PHYS_CHARACTER_WALKABLE)
+		return false;
+
+	position = stepPosition + (drop * travel);
+
+	// Rest of the motion was along gravity, which the step lands against
+	motion = Vec3();
+	obj->setOnGround(true);
+
+	return true;
+}
+
+bool PhysicsEngine::castCharacter(PhysicsObject* obj, const Vec3& position, const Vec3& motion, ShapeCastHit& hit, float& travel){
+
+	float length = motion.magnitude();
+
+	if(length == 0){
+		travel = 1;
+		return false;
+	}
+
+	// Extending the cast keeps surfaces within the skin distance touching, such as the ground under a resting character
+	if(!castObject(obj, position, motion * ((length + NTW_PHYS_CHARACTER_SKIN) / length), hit)){
+		travel = 1;
+		return false;
+	}
+
+	travel = max(hit.time * (length + NTW_PHYS_CHARACTER_SKIN) - NTW_PHYS_CHARACTER_SKIN, 0.0f) / length;
+	return true;
+}
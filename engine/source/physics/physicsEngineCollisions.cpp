@@ -1,6 +1,9 @@
 #include"physicsEngine.h"
 
 #include"physics/satCollision.h"
+#include"physics/primitiveCollision.h"
+#include"physics/gjkCollision.h"
+#include"physics/physFunc.h"
 #include"physics/physDefine.h"
 #include"objects/portal.h"
 #include"objects/player.h"
@@ -16,6 +19,14 @@ using std::max;
 
 void PhysicsEngine::checkCollisions(){
 
+	// Cache contacts with their accumulated impulses for warm starting
+	for(const ContactManifold& m : contactManifolds_){
+		auto i = satCollisions_.find(m.objects);
+
+		if(i != satCollisions_.end())
+			i->second.contacts = m.contacts;
+	}
+
 	// Clear contacts and contact constraints from previous update
 	contactManifolds_.clear();
 	contactConstraints_.clear();
@@ -33,26 +44,50 @@ void PhysicsEngine::checkCollisions(){
 	aabbTree_.update();
 	const vector<AABBPair>& overlappingAABBs = aabbTree_.getOverlapping();
 
+	// Advance fast objects to where their sweeps first hit something, before testing them
+	sweepFastObjects();
 
-	// Check for and resolve collisions, first with portals then with objects
-	for(int i = 0; i < 2; i++){
-		for(const AABBPair& pair : overlappingAABBs){
+	// Move characters against the other objects' positions at the end of the update (in physicsEngineCharacters.cpp)
+	moveCharacters();
 
-			// Get objects
-			Object* object1 = pair.aabb1.collider->parent;
-			Object* object2 = pair.aabb2.collider->parent;
 
-			// Portal collision
-			if(!object1 || !object2){
-				if(i == 0)
-					resolvePortalCollision(!object1 ? object2 : object1, !object1 ? pair.aabb1.collider->portal : pair.aabb2.collider->portal);
-			}
-			else if(i == 1)
-				resolveCollision(pair);
-		}
+	// Resolve portal collisions first and collect object pairs
+	objectPairs_.clear();
+
+	for(const AABBPair& pair : overlappingAABBs){
+
+		// Get objects
+		Object* object1 = pair.collider1->parent;
+		Object* object2 = pair.collider2->parent;
+
+		// Portal collision
+		if(!object1 || !object2)
+			resolvePortalCollision(!object1 ? object2 : object1, !object1 ? pair.collider1->portal : pair.collider2->portal);
+		else
+			objectPairs_.push_back(&pair);
 	}
 
 
+	// Test object pairs in parallel, tests only read the cached results and hitboxes
+	int numPairs = (int)objectPairs_.size();
+
+	if(narrowphaseResults_.size() < numPairs)
+		narrowphaseResults_.resize(numPairs);
+
+	threadPool_.run((numPairs + NTW_PHYS_NARROWPHASE_BATCH - 1) / NTW_PHYS_NARROWPHASE_BATCH, [this, numPairs](int batch){
+		int end = min((batch + 1) * NTW_PHYS_NARROWPHASE_BATCH, numPairs);
+
+		for(int i = batch * NTW_PHYS_NARROWPHASE_BATCH; i < end; i++)
+			testCollision(*objectPairs_[i], narrowphaseResults_[i]);
+	});
+
+	// Merge results in broadphase order
+	for(int i = 0; i < numPairs; i++)
+		resolveCollision(narrowphaseResults_[i]);
+
+	addSweepContacts();
+
+
 	// Remove out-of-date SAT collisions and portal collisions
 	for(auto i = satCollisions_.begin(); i != satCollisions_.end();){
 		if(!i->second.updated)
@@ -69,89 +104,233 @@ void PhysicsEngine::checkCollisions(){
 	}
 }
 
-void PhysicsEngine::resolveCollision(const AABBPair& pair){
+void PhysicsEngine::testCollision(const AABBPair& pair, NarrowphaseResult& result) const{
 
 	// Get colliders
-	const Collider* collider1 = pair.aabb1.collider;
-	const Collider* collider2 = pair.aabb2.collider;
+	const Collider* collider1 = pair.collider1;
+	const Collider* collider2 = pair.collider2;
 
 	// Get objects
 	Object* object1 = collider1->parent;
 	Object* object2 = collider2->parent;
-	ObjectPair objectPair = {object1, object2};
 
 
-	// Create collision tester
-	SATCollision collisionTest(collider1, collider2);
+	// Check if there is a cached collision result
+	auto i = satCollisions_.find({object1, object2});
+
+	// Pair order can change when AABBs are re-inserted into the tree
+	// Keep the cached order so cached feature indices refer to the right hitboxes
+	if(i != satCollisions_.end() && i->first.object1 != object1){
+		std::swap(collider1, collider2);
+		std::swap(object1, object2);
+	}
 
+	// Reset result
+	result.objects = {object1, object2};
+	result.manifold.contacts.clear();
+	result.manifold.sleeping = false;
+	result.cached = i != satCollisions_.end();
+
+	ContactManifold& m = result.manifold;
+	SATCollisionInfo& info = result.info;
+
+	// Copy cached result without its contacts, which are only read for warm starting
+	if(result.cached){
+		info.collided		= i->second.collided;
+		info.separatingAxis	= i->second.separatingAxis;
+		info.contactInfo	= i->second.contactInfo;
+		info.supportVertex1	= i->second.supportVertex1;
+		info.supportVertex2	= i->second.supportVertex2;
+		info.simplex		= i->second.simplex;
+	}
+	else{
+		info.collided = false;
+		info.supportVertex1 = 0;
+		info.supportVertex2 = 0;
+		info.simplex.size = 0;
+	}
 
-	// Check if there is a cached collision result
-	auto i = satCollisions_.find(objectPair);
+	info.updated = true;
 
-	ContactManifold m;
 
-	if(i != satCollisions_.end()){
-		
-		SATCollisionInfo& info = i->second;
+	// Neither object can move, keep cached result without testing
+	if(!isAwake(object1) && !isAwake(object2)){
+		if(!result.cached){
+			info.updated = false;
+			return;
+		}
+
+		if(!info.collided || i->second.contacts.empty())
+			return;
+
+		// Reuse contacts from the previous update, which are still exact since neither object has moved
+		m.contacts = i->second.contacts;
+		m.maxDistance = 0;
+		m.sleeping = true;
+		return;
+	}
+
+
+	// Primitive pairs have closed form tests, cheap enough to redo every update without a cached separating axis
+	if(PrimitiveCollision::hasTest(collider1, collider2)){
+		PrimitiveCollision primitiveTest(collider1, collider2);
+
+		if(!primitiveTest.testCollision()){
+			// No collision, nothing to cache
+			info.updated = false;
+			return;
+		}
+
+		m = primitiveTest.getContactPoints();
+
+		// Warm start if contacts are generated from the same features as the previous update
+		SATContactInfo contactInfo = primitiveTest.getContactInfo();
+
+		if(warmStarting_ && result.cached && info.collided && contactInfo.isEdgePair == info.contactInfo.isEdgePair &&
+			contactInfo.index1 == info.contactInfo.index1 && contactInfo.index2 == info.contactInfo.index2)
+			warmStartContacts(m, i->second);
+
+		info.collided = true;
+		info.contactInfo = contactInfo;
+		return;
+	}
+
+
+	// GJK test, starting from the simplex and support vertices of the previous update
+	if(getNarrowphaseType(object1, object2) == NarrowphaseType::GJK){
+		GJKCollision gjkTest(collider1, collider2, result.gjkBuffers);
+		gjkTest.setSimplex(info.simplex);
+		gjkTest.setSupportVertices(info.supportVertex1, info.supportVertex2);
+
+		bool collided = gjkTest.testCollision();
+
+		info.simplex = gjkTest.getSimplex();
+		info.supportVertex1 = gjkTest.getSupportVertex1();
+		info.supportVertex2 = gjkTest.getSupportVertex2();
+
+		if(!collided){
+			// No collision, keep simplex for the next test
+			info.collided = false;
+			return;
+		}
+
+		m = gjkTest.getContactPoints();
+
+		// Warm start if contacts are generated from the same features as the previous update
+		SATContactInfo contactInfo = gjkTest.getContactInfo();
+
+		if(warmStarting_ && result.cached && info.collided && contactInfo.isEdgePair == info.contactInfo.isEdgePair &&
+			contactInfo.index1 == info.contactInfo.index1 && contactInfo.index2 == info.contactInfo.index2)
+			warmStartContacts(m, i->second);
+
+		info.collided = true;
+		info.contactInfo = contactInfo;
+		return;
+	}
+
+
+	// Create collision tester, support queries start from the vertices found in the previous update
+	SATCollision collisionTest(collider1, collider2, result.satBuffers);
+	collisionTest.setSupportVertices(info.supportVertex1, info.supportVertex2);
+
+	// Keep support vertices found by a test for the next update
+	auto l_cacheSupport = [&info, &collisionTest](bool collided) -> bool {
+		info.supportVertex1 = collisionTest.getSupportVertex1();
+		info.supportVertex2 = collisionTest.getSupportVertex2();
+		return collided;
+	};
+
+	if(result.cached){
 
 		// Check if cached result is valid
 		if(info.collided){
-			// Objects collided, try to generate the same contact points
-			collisionTest.setContactInfo(info.contactInfo);
+			// Objects collided, redo test since the closest features may have changed
+			// Reusing the cached features lets contacts persist on features that no longer touch
+			if(!l_cacheSupport(collisionTest.testCollision())){
+				// No collision, invalidate contact info and return
+				info.updated = false;
+				return;
+			}
+
 			m = collisionTest.getContactPoints();
 
-			// No contacts generated, redo test
-			if(m.contacts.empty()){
-				if(!collisionTest.testCollision()){
-					// No collision, invalidate contact info and return
-					info.updated = false;
-					return;
-				}
+			// Warm start if contacts are generated from the same features as the previous update
+			SATContactInfo contactInfo = collisionTest.getContactInfo();
 
-				// Objects are colliding
-				m = collisionTest.getContactPoints();
-			}
+			if(warmStarting_ && contactInfo.isEdgePair == info.contactInfo.isEdgePair &&
+				contactInfo.index1 == info.contactInfo.index1 && contactInfo.index2 == info.contactInfo.index2)
+				warmStartContacts(m, i->second);
+
+			info.contactInfo = contactInfo;
 		}
 		else{
 			// Objects did not collide, do test with separating axis
-			if(!collisionTest.testCollision(info.separatingAxis))
+			if(!l_cacheSupport(collisionTest.testCollision(info.separatingAxis)))
 				return;
 
-			// Collision found, invalidate separating axis
+			// Collision found, replace separating axis with contact info
 			m = collisionTest.getContactPoints();
-			info.updated = false;
+			info.collided = true;
+			info.contactInfo = collisionTest.getContactInfo();
 		}
 	}
 
 	// No cached result, test collision and cache
 	else{
-		SATCollisionInfo info;
-		info.collided = collisionTest.testCollision();
+		info.collided = l_cacheSupport(collisionTest.testCollision());
 
 		if(!info.collided){
 			// No collision, cache separating axis and return
 			info.separatingAxis = collisionTest.getSeparatingAxis();
-			satCollisions_.emplace(objectPair, info);
-
 			return;
 		}
 
 		// Collision found, cache contact info
 		m = collisionTest.getContactPoints();
-
 		info.contactInfo = collisionTest.getContactInfo();
-		satCollisions_.emplace(objectPair, info);
 	}
+}
+
+NarrowphaseType PhysicsEngine::getNarrowphaseType(Object* object1, Object* object2) const{
+
+	if(pairNarrowphaseTypes_.empty())
+		return narrowphaseType_;
+
+	auto i = pairNarrowphaseTypes_.find({object1, object2});
+	return i != pairNarrowphaseTypes_.end() ? i->second : narrowphaseType_;
+}
+
+void PhysicsEngine::resolveCollision(NarrowphaseResult& result){
+
+	// Update cached result
+	if(result.cached){
+		SATCollisionInfo& info = satCollisions_.find(result.objects)->second;
+
+		info.updated		= result.info.updated;
+		info.collided		= result.info.collided;
+		info.separatingAxis	= result.info.separatingAxis;
+		info.contactInfo	= result.info.contactInfo;
+		info.supportVertex1	= result.info.supportVertex1;
+		info.supportVertex2	= result.info.supportVertex2;
+		info.simplex		= result.info.simplex;
+	}
+	else if(result.info.updated)
+		satCollisions_.emplace(result.objects, result.info);
 
-	
 
 	// Check output valididty
-	if(m.contacts.empty())
+	if(result.manifold.contacts.empty())
 		return;
 
 
 	// Add manifold
-	contactManifolds_.push_back(m);
+	result.manifold.objects = result.objects;
+	contactManifolds_.push_back(std::move(result.manifold));
+
+	ContactManifold& m = contactManifolds_.back();
+
+	Object* object1 = m.objects.object1;
+	Object* object2 = m.objects.object2;
 
 
 	// Use normal of first contact as normal for entire manifold
@@ -162,10 +341,13 @@ void PhysicsEngine::resolveCollision(const AABBPair& pair){
 	object2->addContact({object1, normal});
 
 
+	// Sleeping objects are not solved, constraints are added if their island wakes up
+	if(m.sleeping)
+		return;
+
 	// If either object uses full rigid body physics, add contact constraints
 	if(object1->getPhysicsType() == PhysicsType::RIGID_BODY || object2->getPhysicsType() == PhysicsType::RIGID_BODY)
-		for(Contact& c : contactManifolds_[contactManifolds_.size() - 1].contacts)
-			contactConstraints_.push_back(ContactConstraint(c, m.objects));
+		addContactConstraints(m);
 
 
 	// Further collision resolution for objects with simple physics
@@ -184,9 +366,13 @@ void PhysicsEngine::resolveCollision(const AABBPair& pair){
 		if(c.depth > distance)
 			distance = c.depth;
 
+	// Characters move themselves and are never pushed, other objects are pushed fully out of them
+	bool obj1Character = obj1Simple && ((PhysicsObject*)object1)->useCharacterController();
+	bool obj2Character = obj2Simple && ((PhysicsObject*)object2)->useCharacterController();
+
 	// Amount to push back based on mass
-	if(object1->getPhysicsType() != PhysicsType::NONE && object1->getPhysicsType() != PhysicsType::STATIC){
-		if(object2->getPhysicsType() != PhysicsType::NONE && object2->getPhysicsType() != PhysicsType::STATIC){
+	if(object1->getPhysicsType() != PhysicsType::NONE && object1->getPhysicsType() != PhysicsType::STATIC && !obj1Character){
+		if(object2->getPhysicsType() != PhysicsType::NONE && object2->getPhysicsType() != PhysicsType::STATIC && !obj2Character){
 			float obj1Mass = ((PhysicsObject*)object1)->getMass();
 			float obj2Mass = ((PhysicsObject*)object2)->getMass();
 			distMult = obj2Mass / (obj1Mass + obj2Mass);
@@ -195,8 +381,8 @@ void PhysicsEngine::resolveCollision(const AABBPair& pair){
 			distMult = 1;
 	}
 
-	bool obj1Phys = obj1Simple || object1->getPhysicsType() == PhysicsType::RIGID_BODY;
-	bool obj2Phys = obj2Simple || object2->getPhysicsType() == PhysicsType::RIGID_BODY;
+	bool obj1Phys = (obj1Simple || object1->getPhysicsType() == PhysicsType::RIGID_BODY) && !obj1Character;
+	bool obj2Phys = (obj2Simple || object2->getPhysicsType() == PhysicsType::RIGID_BODY) && !obj2Character;
 
 	// Zero object velocity and push outwards along penetration normal
 	if(obj1Phys && distMult > 0){
@@ -235,6 +421,145 @@ void PhysicsEngine::resolveCollision(const AABBPair& pair){
 	}
 }
 
+void PhysicsEngine::addContactConstraints(ContactManifold& manifold){
+	for(int i = 0; i < manifold.contacts.size(); i++)
+		contactConstraints_.push_back(ContactConstraint(manifold.contacts[i], manifold.objects, i, (int)manifold.contacts.size()));
+}
+
+void PhysicsEngine::warmStartContacts(ContactManifold& manifold, const SATCollisionInfo& info) const{
+
+	// Match each contact to the previous contact clipped from the same features
+	// Otherwise match the closest contact of the previous update, clipping can change the features of a contact
+	// that has not moved when its point lies on the edge of the reference face, as in stacks of equal boxes
+	for(Contact& c : manifold.contacts){
+
+		const Contact* match = nullptr;
+		float bestDistance = NTW_PHYS_WARM_START_DISTANCE * NTW_PHYS_WARM_START_DISTANCE;
+
+		for(const Contact& prev : info.contacts){
+
+			if(c.feature != -1 && prev.feature == c.feature){
+				match = &prev;
+				break;
+			}
+
+			float distance = (prev.obj1ContactVector - c.obj1ContactVector).magnitude2();
+
+			if(distance < bestDistance){
+				match = &prev;
+				bestDistance = distance;
+			}
+		}
+
+		if(!match)
+			continue;
+
+		// Persistent contact, carry over accumulated impulses
+		c.lambdaSum		= match->lambdaSum		* NTW_PHYS_WARM_START_FAC;
+		c.lambdaSumTan1	= match->lambdaSumTan1	* NTW_PHYS_WARM_START_FAC;
+		c.lambdaSumTan2	= match->lambdaSumTan2	* NTW_PHYS_WARM_START_FAC;
+		c.isNew = false;
+	}
+}
+
+void PhysicsEngine::sweepFastObjects(){
+
+	sweepImpacts_.clear();
+
+	auto l_fast = [](const Object* object) -> bool {
+		return object->getPhysicsType() == PhysicsType::RIGID_BODY && ((const PhysicsObject*)object)->isFastMoving();
+	};
+
+	// Sweep fast objects against other objects at the end of the update, fast objects are not swept against each other
+	for(const AABBPair& pair : aabbTree_.getOverlapping()){
+
+		Object* object1 = pair.collider1->parent;
+		Object* object2 = pair.collider2->parent;
+
+		// Skip portals
+		if(!object1 || !object2)
+			continue;
+
+		bool fast1 = l_fast(object1);
+
+		if(fast1 == l_fast(object2))
+			continue;
+
+		const Collider* moving	= fast1 ? pair.collider1 : pair.collider2;
+		const Collider* other	= fast1 ? pair.collider2 : pair.collider1;
+		PhysicsObject* obj		= (PhysicsObject*)moving->parent;
+
+		Vec3 sweep = obj->getTPosition() - obj->getPosition();
+		Vec3 normal;
+		float time = ntw::getTimeOfImpact(*moving, sweep, *other, normal);
+
+		if(time < 0)
+			continue;
+
+		// Keep the earliest impact of each object
+		auto i = std::find_if(sweepImpacts_.begin(), sweepImpacts_.end(), [obj](const SweepImpact& impact){
+			return impact.objects.object1 == obj;
+		});
+
+		if(i == sweepImpacts_.end())
+			i = sweepImpacts_.emplace(sweepImpacts_.end());
+		else if(i->time <= time)
+			continue;
+
+		i->objects = {obj, other->parent};
+		i->collider = moving;
+		i->time = time;
+
+		i->contact = Contact();
+		i->contact.normal = normal;
+	}
+
+
+	// Advance objects to their impacts, the narrowphase tests them there and the solver starts from there
+	// They are pushed in by the penetration slop, so the narrowphase finds every touching feature without a position correction
+	for(SweepImpact& impact : sweepImpacts_){
+
+		PhysicsObject* obj = (PhysicsObject*)impact.objects.object1;
+		Vec3 motion = ((obj->getTPosition() - obj->getPosition()) * impact.time) - (impact.contact.normal * NTW_PHYS_PENETRATION_SLOP);
+
+		obj->setPosition(obj->getPosition() + motion);
+		obj->setTPosition(obj->getPosition());
+		obj->cacheColliderTransform();
+
+		// Contact is at the point of the fast object furthest towards the other object
+		const Collider& c = *impact.collider;
+		int vertex = 0;
+		Vec3 point = (c.rotation * ntw::getSupportPoint(c.hitboxScaled, c.rotation.getTranspose() * -impact.contact.normal, vertex)) + c.position;
+
+		impact.contact.obj1ContactGlobal = point;
+		impact.contact.obj2ContactGlobal = point;
+		ntw::setContactProperties(impact.contact, obj, impact.objects.object2);
+	}
+}
+
+void PhysicsEngine::addSweepContacts(){
+
+	for(SweepImpact& impact : sweepImpacts_){
+
+		// Narrowphase found contacts at the impact, which replace the sweep's contact
+		bool touching = std::any_of(contactManifolds_.begin(), contactManifolds_.end(), [&impact](const ContactManifold& m){
+			return m.objects == impact.objects;
+		});
+
+		if(touching)
+			continue;
+
+		// Objects only touch at the impact, the contact stops the object from moving further towards the other object
+		ContactManifold m;
+		m.objects = impact.objects;
+		m.contacts.push_back(impact.contact);
+		m.maxDistance = 0;
+
+		contactManifolds_.push_back(std::move(m));
+		addContactConstraints(contactManifolds_.back());
+	}
+}
+
 void PhysicsEngine::resolvePortalCollision(Object* object, Portal* portal){
 
 	// Ignore if object is not within portal clip planes
@@ -275,6 +600,11 @@ void PhysicsEngine::resolvePortalCollision(Object* object, Portal* portal){
 
 			// Set velocity, angular velocity, and gravity direction
 			PhysicsObject* pObj = (PhysicsObject*)object;
+
+			// Characters are placed at the end of their motion, which has to be teleported too
+			if(pObj->useCharacterController())
+				pObj->setTPosition(portal->getTransformedVector(pObj->getTPosition()));
+
 			pObj->setVelocity(portal->getRotatedVector(pObj->getVelocity()));
 			pObj->setAngularVelocity(portal->getRotatedVector(pObj->getAngularVelocity()));
 			pObj->setGravityDirection(portal->getRotatedVector(pObj->getGravityDirection()));
@@ -0,0 +1,241 @@
+#include"physicsEngine.h"
+
+#include"physics/physDefine.h"
+
+
+void PhysicsEngine::updateIslands(){
+
+	islands_.clear();
+
+	int numObjects = (int)dynamicObjects_.size();
+
+	// Each object starts in its own island
+	islandParents_.resize(numObjects);
+
+	for(int i = 0; i < numObjects; i++){
+		islandParents_[i] = i;
+		dynamicObjects_[i]->setIslandIndex(i);
+	}
+
+	// Find root object of an island, halving the path along the way
+	auto l_find = [this](int i) -> int {
+		while(islandParents_[i] != i){
+			islandParents_[i] = islandParents_[islandParents_[i]];
+			i = islandParents_[i];
+		}
+
+		return i;
+	};
+
+	// Index of a movable object, static objects do not connect islands
+	auto l_index = [](const Object* object) -> int {
+		if(object->getPhysicsType() != PhysicsType::RIGID_BODY && object->getPhysicsType() != PhysicsType::SIMPLE)
+			return -1;
+
+		return ((const PhysicsObject*)object)->getIslandIndex();
+	};
+
+
+	// Merge islands of objects in contact
+	for(const ContactManifold& m : contactManifolds_){
+		int i1 = l_index(m.objects.object1);
+		int i2 = l_index(m.objects.object2);
+
+		if(i1 != -1 && i2 != -1)
+			islandParents_[l_find(i1)] = l_find(i2);
+	}
+
+
+	// Create islands, objects store the index of their island afterwards
+	vector<int> rootIslands(numObjects, -1);
+
+	for(int i = 0; i < numObjects; i++){
+		int root = l_find(i);
+
+		if(rootIslands[root] == -1){
+			rootIslands[root] = (int)islands_.size();
+			islands_.emplace_back();
+		}
+
+		islands_[rootIslands[root]].objects.push_back(dynamicObjects_[i]);
+	}
+
+	for(int i = 0; i < (int)islands_.size(); i++)
+		for(PhysicsObject* obj : islands_[i].objects)
+			obj->setIslandIndex(i);
+
+
+	// Wake islands where moving objects have come into contact with sleeping objects
+	for(Island& island : islands_){
+
+		int numSleeping = 0;
+
+		for(PhysicsObject* obj : island.objects)
+			if(obj->isSleeping())
+				numSleeping++;
+
+		island.sleeping = numSleeping == island.objects.size();
+
+		if(numSleeping == 0 || island.sleeping)
+			continue;
+
+		for(PhysicsObject* obj : island.objects){
+			if(!obj->isSleeping())
+				continue;
+
+			obj->setSleeping(false);
+
+			// Initial update was skipped while sleeping
+			applyInitialUpdate(obj);
+		}
+	}
+
+	// Contacts kept between sleeping objects need constraints once either object wakes
+	for(ContactManifold& m : contactManifolds_){
+		if(!m.sleeping || (!isAwake(m.objects.object1) && !isAwake(m.objects.object2)))
+			continue;
+
+		m.sleeping = false;
+		addContactConstraints(m);
+	}
+
+
+	// Island of a constraint is the island of either movable object
+	auto l_island = [&l_index](ObjectPair objects) -> int {
+		int i = l_index(objects.object1);
+		return i != -1 ? i : l_index(objects.object2);
+	};
+
+	for(int i = 0; i < (int)contactConstraints_.size(); i++){
+		int island = l_island(contactConstraints_[i].getObjects());
+
+		if(island != -1)
+			islands_[island].contactConstraints.push_back(i);
+	}
+
+	for(int i = 0; i < (int)constraints_.size(); i++){
+		int island = l_island(constraints_[i].getObjects());
+
+		if(island != -1)
+			islands_[island].constraints.push_back(i);
+	}
+}
+
+void PhysicsEngine::solveIsland(Island& island, ContactBatchSolver& batchSolver){
+
+	// Temp update objects after applying a constraint
+	auto l_tUpdate = [](ObjectPair objects) -> void {
+		if(objects.object1->getPhysicsType() == PhysicsType::RIGID_BODY)
+			((PhysicsObject*)objects.object1)->tUpdatePhysics();
+
+		if(objects.object2->getPhysicsType() == PhysicsType::RIGID_BODY)
+			((PhysicsObject*)objects.object2)->tUpdatePhysics();
+	};
+
+	// Apply impulses from the previous update
+	if(warmStarting_){
+		for(int i : island.contactConstraints){
+			ContactConstraint& c = contactConstraints_[i];
+			c.warmStart();
+			l_tUpdate(c.getObjects());
+		}
+	}
+
+	// Large islands with only contacts are solved in batches
+	// With the block solver on, islands with multi-point manifolds are left to the block solver
+	bool batch = batchSolver_ && island.constraints.empty() && island.contactConstraints.size() >= NTW_PHYS_BATCH_MIN_CONSTRAINTS;
+
+	if(batch && blockSolver_){
+		for(int i : island.contactConstraints){
+			if(contactConstraints_[i].getManifoldSize() > 1){
+				batch = false;
+				break;
+			}
+		}
+	}
+
+	if(batch){
+		island.iterations = batchSolver.solve(contactConstraints_.data(), island.contactConstraints, island.objects);
+		return;
+	}
+
+	// Solve constraints, repeating until all constraints are satisfied
+	int iter = 0;
+
+	do{
+		// Solve and apply constraints
+		// A manifold's constraints are added together, so they follow each other in the island
+		for(int j = 0; j < island.contactConstraints.size(); j++){
+			ContactConstraint& c = contactConstraints_[island.contactConstraints[j]];
+
+			if(blockSolver_ && c.getManifoldIndex() == 0 && c.getManifoldSize() > 1){
+				ContactConstraint::solveBlock(&c, c.getManifoldSize());
+				j += c.getManifoldSize() - 1;
+			}
+			else
+				c.solve();
+
+			l_tUpdate(c.getObjects());
+		}
+
+		for(int i : island.constraints)
+			constraints_[i].solve();
+
+		iter++;
+
+		// Check if all constraints are satisfied
+		for(int i : island.contactConstraints)
+			if(!contactConstraints_[i].isSolved())
+				goto constraintLoop;
+
+		for(int i : island.constraints)
+			if(!constraints_[i].isSolved())
+				goto constraintLoop;
+
+		// Solved, exit loop
+		break;
+
+	constraintLoop:;
+	} while(iter < NTW_PHYS_MAX_CONSTRAINT_ITER);
+
+	island.iterations = iter;
+}
+
+void PhysicsEngine::updateSleeping(){
+
+	int numSleeping = 0;
+
+	for(Island& island : islands_){
+
+		if(island.sleeping){
+			numSleeping += (int)island.objects.size();
+			continue;
+		}
+
+		// Island can sleep once every object has been resting long enough
+		bool resting = allowSleeping_;
+
+		for(PhysicsObject* obj : island.objects){
+			obj->updateSleepTimer();
+
+			if(!obj->canSleep() || obj->getSleepTimer() < NTW_PHYS_SLEEP_TIME)
+				resting = false;
+		}
+
+		if(!resting)
+			continue;
+
+		for(PhysicsObject* obj : island.objects)
+			obj->setSleeping(true);
+
+		island.sleeping = true;
+		numSleeping += (int)island.objects.size();
+	}
+
+	timings_.sleepingObjects = numSleeping;
+}
+
+bool PhysicsEngine::isAwake(const Object* object) const{
+	return (object->getPhysicsType() == PhysicsType::RIGID_BODY || object->getPhysicsType() == PhysicsType::SIMPLE) &&
+		!object->isSleeping();
+}
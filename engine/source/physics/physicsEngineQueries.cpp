@@ -0,0 +1,385 @@
+#include"physicsEngine.h"
+
+#include"physics/physFunc.h"
+#include"objects/portal.h"
+#include<algorithm>
+
+using std::min;
+
+
+bool PhysicsEngine::castRay(const Vec3& position, const Vec3& direction, float maxDistance, const Collider* collider, RaycastHit& hit){
+
+	int face;
+	float distance = ntw::raycast(position, direction, maxDistance, *collider, face);
+
+	if(distance < 0 || (hit.collider && distance >= hit.distance))
+		return false;
+
+	hit.collider	= collider;
+	hit.object		= collider->parent;
+	hit.distance	= distance;
+	hit.face		= face;
+	hit.position	= position + (direction * distance);
+
+	// Rays starting inside have no face, they point back along the ray
+	hit.normal = face != -1 ? collider->rotation * collider->hitboxScaled.faces[face].normal : -direction;
+
+	return true;
+}
+
+bool PhysicsEngine::crossesPortal(const Vec3& position, const Vec3& direction, float maxDistance, Portal* portal, float& distance){
+
+	// Rays pass through portals that lead nowhere
+	if(!portal->getPairedPortal())
+		return false;
+
+	const Vec3& normal = portal->getNormal();
+	float speed = direction * normal;
+
+	if(speed == 0)
+		return false;
+
+	distance = ((portal->getPosition() - position) * normal) / speed;
+
+	if(distance < 0 || distance > maxDistance)
+		return false;
+
+	return portal->isPointWithinClipPlanes(position + (direction * distance));
+}
+
+void PhysicsEngine::passPortal(Portal* portal, float distance, Vec3& position, Vec3& direction, RaycastHit& hit){
+	position	= portal->getTransformedVector(position + (direction * distance));
+	direction	= portal->getRotatedVector(direction);
+
+	hit.portals[hit.numPortals++] = portal;
+}
+
+
+bool PhysicsEngine::castRay(const Vec3& position, const Vec3& direction, float maxDistance, RaycastHit& hit, const Object* ignore){
+
+	hit = RaycastHit();
+
+	Vec3 rayPosition = position;
+	Vec3 rayDirection = direction;
+	float travelled = 0;
+
+	// Portal the ray came out of, it starts on this portal's plane
+	const Portal* exitPortal = nullptr;
+
+	while(true){
+
+		Portal* portal = nullptr;
+		float portalDistance = maxDistance - travelled;
+
+		aabbTree_.castRay(rayPosition, rayDirection, portalDistance, [&](const Collider* collider) -> float {
+
+			float distance;
+
+			// Keep the closest portal, objects behind it cannot be hit
+			if(collider->portal){
+				if(collider->portal != exitPortal && crossesPortal(rayPosition, rayDirection, portalDistance, collider->portal, distance)){
+					portal = collider->portal;
+					portalDistance = distance;
+				}
+			}
+			else if(collider->parent != ignore)
+				castRay(rayPosition, rayDirection, portalDistance, collider, hit);
+
+			// Only closer leaves can have a closer hit
+			return hit.collider ? min(hit.distance, portalDistance) : portalDistance;
+		});
+
+		// Hit before any portal
+		if(hit.collider && (!portal || hit.distance <= portalDistance)){
+			hit.distance += travelled;
+			return true;
+		}
+
+		// Hits found before a closer portal are behind it
+		hit.collider	= nullptr;
+		hit.object		= nullptr;
+
+		if(!portal || hit.numPortals == NTW_PHYS_RAY_MAX_PORTALS)
+			return false;
+
+		passPortal(portal, portalDistance, rayPosition, rayDirection, hit);
+		travelled += portalDistance;
+		exitPortal = portal->getPairedPortal();
+	}
+}
+
+int PhysicsEngine::castRayAll(const Vec3& position, const Vec3& direction, float maxDistance, vector<RaycastHit>& hits, const Object* ignore){
+
+	int start = (int)hits.size();
+
+	// Portals passed through so far
+	RaycastHit path;
+
+	Vec3 rayPosition = position;
+	Vec3 rayDirection = direction;
+	float travelled = 0;
+	const Portal* exitPortal = nullptr;
+
+	while(true){
+
+		int segmentStart = (int)hits.size();
+
+		Portal* portal = nullptr;
+		float portalDistance = maxDistance - travelled;
+
+		aabbTree_.castRay(rayPosition, rayDirection, portalDistance, [&](const Collider* collider) -> float {
+
+			float distance;
+
+			if(collider->portal){
+				if(collider->portal != exitPortal && crossesPortal(rayPosition, rayDirection, portalDistance, collider->portal, distance)){
+					portal = collider->portal;
+					portalDistance = distance;
+				}
+			}
+			else if(collider->parent != ignore){
+				RaycastHit hit = path;
+
+				if(castRay(rayPosition, rayDirection, portalDistance, collider, hit))
+					hits.push_back(hit);
+			}
+
+			return portalDistance;
+		});
+
+		// Remove hits behind the closest portal, the rest are measured along the whole path
+		for(int i = segmentStart; i < (int)hits.size();){
+			if(portal && hits[i].distance > portalDistance){
+				hits[i] = hits.back();
+				hits.pop_back();
+				continue;
+			}
+
+			hits[i].distance += travelled;
+			i++;
+		}
+
+		if(!portal || path.numPortals == NTW_PHYS_RAY_MAX_PORTALS)
+			break;
+
+		passPortal(portal, portalDistance, rayPosition, rayDirection, path);
+		travelled += portalDistance;
+		exitPortal = portal->getPairedPortal();
+	}
+
+	std::sort(hits.begin() + start, hits.end(), [](const RaycastHit& a, const RaycastHit& b){
+		return a.distance < b.distance;
+	});
+
+	return (int)hits.size() - start;
+}
+
+void PhysicsEngine::castRays(const vector<RayQuery>& rays, vector<RaycastHit>& hits){
+
+	int numRays = (int)rays.size();
+
+	hits.assign(numRays, RaycastHit());
+
+	rayQueries_.resize(numRays);
+	rayPositions_.resize(numRays);
+	rayDirections_.resize(numRays);
+	rayDistances_.resize(numRays);
+	rayTravelled_.resize(numRays);
+	rayPortals_.resize(numRays);
+	rayPortalDistances_.resize(numRays);
+	rayExitPortals_.resize(numRays);
+
+	for(int i = 0; i < numRays; i++){
+		rayQueries_[i]		= i;
+		rayPositions_[i]	= rays[i].position;
+		rayDirections_[i]	= rays[i].direction;
+		rayTravelled_[i]	= 0;
+		rayExitPortals_[i]	= nullptr;
+	}
+
+	// Each pass traces rays up to their closest portal, then continues the rays that crossed one
+	int numActive = numRays;
+
+	while(numActive > 0){
+
+		for(int i = 0; i < numActive; i++){
+			rayDistances_[i]		= rays[rayQueries_[i]].maxDistance - rayTravelled_[i];
+			rayPortals_[i]			= nullptr;
+			rayPortalDistances_[i]	= rayDistances_[i];
+		}
+
+		aabbTree_.castRays(rayPositions_.data(), rayDirections_.data(), rayDistances_.data(), numActive, [&](int i, const Collider* collider) -> float {
+
+			RaycastHit& hit = hits[rayQueries_[i]];
+			float distance;
+
+			if(collider->portal){
+				if(collider->portal != rayExitPortals_[i] &&
+					crossesPortal(rayPositions_[i], rayDirections_[i], rayPortalDistances_[i], collider->portal, distance)){
+
+					rayPortals_[i] = collider->portal;
+					rayPortalDistances_[i] = distance;
+				}
+			}
+			else if(collider->parent != rays[rayQueries_[i]].ignore)
+				castRay(rayPositions_[i], rayDirections_[i], rayPortalDistances_[i], collider, hit);
+
+			return hit.collider ? min(hit.distance, rayPortalDistances_[i]) : rayPortalDistances_[i];
+		});
+
+		// Keep rays that crossed a portal before hitting anything, packed at the front
+		int numNext = 0;
+
+		for(int i = 0; i < numActive; i++){
+
+			RaycastHit& hit = hits[rayQueries_[i]];
+			Portal* portal = rayPortals_[i];
+
+			if(hit.collider && (!portal || hit.distance <= rayPortalDistances_[i])){
+				hit.distance += rayTravelled_[i];
+				continue;
+			}
+
+			hit.collider	= nullptr;
+			hit.object		= nullptr;
+
+			if(!portal || hit.numPortals == NTW_PHYS_RAY_MAX_PORTALS)
+				continue;
+
+			rayQueries_[numNext]		= rayQueries_[i];
+			rayPositions_[numNext]		= rayPositions_[i];
+			rayDirections_[numNext]		= rayDirections_[i];
+			rayTravelled_[numNext]		= rayTravelled_[i] + rayPortalDistances_[i];
+			rayExitPortals_[numNext]	= portal->getPairedPortal();
+
+			passPortal(portal, rayPortalDistances_[i], rayPositions_[numNext], rayDirections_[numNext], hit);
+			numNext++;
+		}
+
+		numActive = numNext;
+	}
+}
+
+
+bool PhysicsEngine::castCollider(const Collider& collider, const Vec3& position, const Vec3& sweep, ShapeCastHit& hit, const Object* ignore){
+
+	hit = ShapeCastHit();
+
+	if(sweep.isZero())
+		return false;
+
+	Vec3 offset = position - collider.position;
+
+	// World bounds of the collider at the start of the sweep
+	Vec3 center = (collider.lowerBound + collider.upperBound) / 2;
+	Vec3 extents = collider.upperBound - center;
+	center = collider.rotation * center + position;
+
+	AABB aabb;
+
+	for(int i = 0; i < 3; i++){
+		float e =	std::abs(collider.rotation.get(i, 0)) * extents[0] +
+					std::abs(collider.rotation.get(i, 1)) * extents[1] +
+					std::abs(collider.rotation.get(i, 2)) * extents[2];
+
+		aabb.lowerBound[i] = center[i] - e;
+		aabb.upperBound[i] = center[i] + e;
+	}
+
+	aabbTree_.castAABB(aabb, sweep, [&](const Collider* other) -> float {
+
+		if(!other->parent || other->parent == ignore || other == &collider)
+			return hit.time;
+
+		Vec3 normal;
+		float time = ntw::castHitbox(collider, offset, sweep, *other, normal);
+
+		if(time >= 0 && (!hit.collider || time < hit.time)){
+			hit.collider	= other;
+			hit.object		= other->parent;
+			hit.normal		= normal;
+			hit.time		= time;
+		}
+
+		return hit.time;
+	});
+
+	return hit.collider != nullptr;
+}
+
+bool PhysicsEngine::castObject(const Object* object, const Vec3& position, const Vec3& sweep, ShapeCastHit& hit){
+
+	hit = ShapeCastHit();
+
+	ShapeCastHit colliderHit;
+
+	for(const Collider& c : object->getColliders())
+		if(castCollider(c, position, sweep, colliderHit, object) && (!hit.collider || colliderHit.time < hit.time))
+			hit = colliderHit;
+
+	return hit.collider != nullptr;
+}
+
+
+int PhysicsEngine::overlapAABB(const Vec3& lowerBound, const Vec3& upperBound, const Collider** colliders, int maxColliders, bool exact, const Object* ignore){
+
+	// Query is captured as a single reference, so the callback is stored without allocating
+	struct{
+		const Vec3& lowerBound;
+		const Vec3& upperBound;
+		const Collider** colliders;
+		int maxColliders;
+		int numColliders;
+		bool exact;
+		const Object* ignore;
+	} query = {lowerBound, upperBound, colliders, maxColliders, 0, exact, ignore};
+
+	AABB aabb;
+	aabb.lowerBound = lowerBound;
+	aabb.upperBound = upperBound;
+
+	aabbTree_.queryAABB(aabb, [&query](const Collider* collider){
+
+		if(!collider->parent || collider->parent == query.ignore)
+			return;
+
+		if(query.exact && !ntw::overlapsAABB(*collider, query.lowerBound, query.upperBound))
+			return;
+
+		if(query.numColliders < query.maxColliders)
+			query.colliders[query.numColliders] = collider;
+
+		query.numColliders++;
+	});
+
+	return query.numColliders;
+}
+
+int PhysicsEngine::overlapSphere(const Vec3& center, float radius, const Collider** colliders, int maxColliders, bool exact, const Object* ignore){
+
+	struct{
+		const Vec3& center;
+		float radius;
+		const Collider** colliders;
+		int maxColliders;
+		int numColliders;
+		bool exact;
+		const Object* ignore;
+	} query = {center, radius, colliders, maxColliders, 0, exact, ignore};
+
+	aabbTree_.querySphere(center, radius, [&query](const Collider* collider){
+
+		if(!collider->parent || collider->parent == query.ignore)
+			return;
+
+		if(query.exact && !ntw::overlapsSphere(*collider, query.center, query.radius))
+			return;
+
+		if(query.numColliders < query.maxColliders)
+			query.colliders[query.numColliders] = collider;
+
+		query.numColliders++;
+	});
+
+	return query.numColliders;
+}
@@ -0,0 +1,417 @@
+#include"primitiveCollision.h"
+
+#include"physics/physFunc.h"
+#include<algorithm>
+#include<limits>
+#include<math.h>
+
+using ntw::crossProduct;
+using std::min;
+using std::max;
+
+
+PrimitiveCollision::PrimitiveCollision(const Collider* collider1, const Collider* collider2) :
+	collider1_(collider1), collider2_(collider2), shape1_(getShape(collider1)), shape2_(getShape(collider2)), swapped_(false) {}
+
+
+bool PrimitiveCollision::hasTest(const Collider* collider1, const Collider* collider2){
+	return collider1->hitboxScaled.primitive.shape != HitboxShape::HULL &&
+		collider2->hitboxScaled.primitive.shape != HitboxShape::HULL;
+}
+
+bool PrimitiveCollision::testCollision(){
+
+	manifold_ = ContactManifold();
+	manifold_.objects = {collider1_->parent, collider2_->parent};
+	manifold_.maxDistance = 0;
+	contactInfo_ = {0, false, -1, -1};
+
+	// Test shapes in order of type so each pair of types has one routine
+	swapped_ = shape1_.type > shape2_.type;
+
+	const Shape& a = swapped_ ? shape2_ : shape1_;
+	const Shape& b = swapped_ ? shape1_ : shape2_;
+
+	if(a.type == HitboxShape::SPHERE){
+		if(b.type == HitboxShape::SPHERE)			testSpheres(a.center, a.radius, b.center, b.radius);
+		else if(b.type == HitboxShape::CAPSULE)		testSphereCapsule(a.center, a.radius, b);
+		else										testSphereBox(a.center, a.radius, b);
+	}
+	else if(a.type == HitboxShape::CAPSULE){
+		if(b.type == HitboxShape::CAPSULE)			testCapsules(a, b);
+		else										testCapsuleBox(a, b);
+	}
+	else
+		testBoxes(a, b);
+
+	contactInfo_.distance = -manifold_.maxDistance;
+
+	return !manifold_.contacts.empty();
+}
+
+
+bool PrimitiveCollision::testSpheres(const Vec3& centerA, float radiusA, const Vec3& centerB, float radiusB){
+
+	Vec3 offset = centerA - centerB;
+	float distance = offset.magnitude();
+
+	if(distance - radiusA - radiusB >= NTW_PRIMITIVE_THRESHOLD)
+		return false;
+
+	// Concentric spheres are pushed apart along an arbitrary axis
+	Vec3 normal = distance > 0.000001f ? offset / distance : Vec3(0, 0, 1);
+
+	addContact(centerA - normal * radiusA, centerB + normal * radiusB, normal);
+	return true;
+}
+
+bool PrimitiveCollision::testSphereBox(const Vec3& centerA, float radiusA, const Shape& b){
+
+	Vec3 closest = getClosestPointOnBox(b, centerA);
+	Vec3 offset = centerA - closest;
+	float distance = offset.magnitude();
+
+	// Center outside the box, contact is the closest point on the box
+	if(distance > 0.000001f){
+		if(distance - radiusA >= NTW_PRIMITIVE_THRESHOLD)
+			return false;
+
+		Vec3 normal = offset / distance;
+		addContact(centerA - normal * radiusA, closest, normal);
+		return true;
+	}
+
+	// Center inside the box, push out through the nearest face
+	Vec3 local = centerA - b.center;
+	int face = 0;
+	float faceDistance = std::numeric_limits<float>::max();
+
+	for(int i = 0; i < 3; i++){
+		float distance = b.halfExtents[i] - abs(local * b.axes[i]);
+
+		if(distance < faceDistance){
+			face = i;
+			faceDistance = distance;
+		}
+	}
+
+	Vec3 normal = local * b.axes[face] >= 0 ? b.axes[face] : -b.axes[face];
+
+	addContact(centerA - normal * radiusA, centerA + normal * faceDistance, normal);
+	return true;
+}
+
+bool PrimitiveCollision::testSphereCapsule(const Vec3& centerA, float radiusA, const Shape& b){
+
+	// Closest point on the capsule's segment
+	float t = min(max((centerA - b.center) * b.axes[2], -b.halfHeight), b.halfHeight);
+
+	return testSpheres(centerA, radiusA, b.center + b.axes[2] * t, b.radius);
+}
+
+bool PrimitiveCollision::testCapsules(const Shape& a, const Shape& b){
+
+	const Vec3& axisA = a.axes[2];
+	const Vec3& axisB = b.axes[2];
+
+	Vec3 offset = a.center - b.center;
+	float dotAB = axisA * axisB;
+	float dotA = axisA * offset;
+	float dotB = axisB * offset;
+	float denom = 1 - dotAB * dotAB;
+
+	// Sphere on the second segment closest to the given point on the first
+	auto l_testAt = [&](float s) -> bool {
+		Vec3 pointA = a.center + axisA * s;
+		float t = min(max((pointA - b.center) * axisB, -b.halfHeight), b.halfHeight);
+
+		return testSpheres(pointA, a.radius, b.center + axisB * t, b.radius);
+	};
+
+	// Parallel capsules touch along a line, contact both ends of the overlap to keep them from rolling
+	if(denom < 0.0001f){
+		float lower = max(-a.halfHeight, -dotA - b.halfHeight);
+		float upper = min(a.halfHeight, -dotA + b.halfHeight);
+
+		if(upper > lower){
+			bool lowerHit = l_testAt(lower);
+			bool upperHit = l_testAt(upper);
+			return lowerHit || upperHit;
+		}
+	}
+
+	// Closest points between the segments, parallel segments start from the point closest to the other center
+	float s = denom < 0.0001f ? -dotA : (dotAB * dotB - dotA) / denom;
+	s = min(max(s, -a.halfHeight), a.halfHeight);
+
+	float t = min(max(dotB + s * dotAB, -b.halfHeight), b.halfHeight);
+	s = min(max(t * dotAB - dotA, -a.halfHeight), a.halfHeight);
+
+	return testSpheres(a.center + axisA * s, a.radius, b.center + axisB * t, b.radius);
+}
+
+bool PrimitiveCollision::testCapsuleBox(const Shape& a, const Shape& b){
+
+	const Vec3& axis = a.axes[2];
+
+	// End spheres, which support a capsule lying on the box
+	bool end1 = testSphereBox(a.center + axis * a.halfHeight, a.radius, b);
+	bool end2 = testSphereBox(a.center - axis * a.halfHeight, a.radius, b);
+
+	// Segment touching at both ends can not go deeper in between
+	if(end1 && end2)
+		return true;
+
+	// Closest point of the segment to the box, found by projecting back and forth between them
+	// The middle of the capsule can touch where neither end does, such as when lying across an edge
+	float t = 0;
+
+	for(int i = 0; i < 4; i++){
+		Vec3 closest = getClosestPointOnBox(b, a.center + axis * t);
+		t = min(max((closest - a.center) * axis, -a.halfHeight), a.halfHeight);
+	}
+
+	// Skip points already tested as end spheres
+	if(abs(t) < a.halfHeight * 0.99f && testSphereBox(a.center + axis * t, a.radius, b))
+		return true;
+
+	return end1 || end2;
+}
+
+bool PrimitiveCollision::testBoxes(const Shape& a, const Shape& b){
+
+	// Offset from the first box to the second
+	Vec3 offset = b.center - a.center;
+
+	// Axis with the least penetration, pointing from the first box towards the second
+	float bestSeparation = -std::numeric_limits<float>::max();
+	Vec3 bestAxis;
+	int bestIndex = -1;
+
+	// Project both boxes onto axis, returns false if they are separated
+	auto l_testAxis = [&](const Vec3& axis, int index, float tolerance) -> bool {
+		float distance = offset * axis;
+		float radius = 0;
+
+		for(int i = 0; i < 3; i++)
+			radius += a.halfExtents[i] * abs(a.axes[i] * axis) + b.halfExtents[i] * abs(b.axes[i] * axis);
+
+		float separation = abs(distance) - radius;
+
+		if(separation >= NTW_PRIMITIVE_THRESHOLD)
+			return false;
+
+		if(separation > bestSeparation + tolerance){
+			bestSeparation = separation;
+			bestAxis = distance >= 0 ? axis : -axis;
+			bestIndex = index;
+		}
+
+		return true;
+	};
+
+	// Face axes of each box
+	for(int i = 0; i < 3; i++)
+		if(!l_testAxis(a.axes[i], i, 0))
+			return false;
+
+	for(int i = 0; i < 3; i++)
+		if(!l_testAxis(b.axes[i], 3 + i, NTW_PRIMITIVE_FEATURE_TOLERANCE))
+			return false;
+
+	// Edge axes, parallel edges are covered by the face axes
+	for(int i = 0; i < 3; i++){
+		for(int j = 0; j < 3; j++){
+			Vec3 axis = crossProduct(a.axes[i], b.axes[j]);
+			float length2 = axis.magnitude2();
+
+			if(length2 < 0.00001f)
+				continue;
+
+			if(!l_testAxis(axis / sqrtf(length2), 6 + i * 3 + j, NTW_PRIMITIVE_FEATURE_TOLERANCE))
+				return false;
+		}
+	}
+
+	contactInfo_.isEdgePair = bestIndex >= 6;
+	contactInfo_.index1 = bestIndex;
+
+
+	// Edge axis, contact is between the closest points of the two edges
+	if(bestIndex >= 6){
+		int i = (bestIndex - 6) / 3;
+		int j = (bestIndex - 6) % 3;
+
+		// Edges of each box furthest towards the other box
+		Vec3 edgeA = a.center;
+		Vec3 edgeB = b.center;
+
+		for(int k = 0; k < 3; k++){
+			if(k != i)	edgeA += a.axes[k] * (a.axes[k] * bestAxis >= 0 ? a.halfExtents[k] : -a.halfExtents[k]);
+			if(k != j)	edgeB -= b.axes[k] * (b.axes[k] * bestAxis >= 0 ? b.halfExtents[k] : -b.halfExtents[k]);
+		}
+
+		// Closest points between the edges
+		const Vec3& dirA = a.axes[i];
+		const Vec3& dirB = b.axes[j];
+
+		Vec3 edgeOffset = edgeA - edgeB;
+		float dotAB = dirA * dirB;
+		float dotA = dirA * edgeOffset;
+		float dotB = dirB * edgeOffset;
+
+		float s = min(max((dotAB * dotB - dotA) / (1 - dotAB * dotAB), -a.halfExtents[i]), a.halfExtents[i]);
+		float t = min(max(dotB + s * dotAB, -b.halfExtents[j]), b.halfExtents[j]);
+
+		addContact(edgeA + dirA * s, edgeB + dirB * t, -bestAxis);
+		return !manifold_.contacts.empty();
+	}
+
+
+	// Face axis, the incident face of the other box is clipped against the sides of the reference face
+	bool referenceA = bestIndex < 3;
+	const Shape& reference = referenceA ? a : b;
+	const Shape& incident = referenceA ? b : a;
+	int face = bestIndex % 3;
+
+	// Reference face normal points towards the incident box
+	Vec3 normal = referenceA ? bestAxis : -bestAxis;
+	float faceOffset = normal * reference.center + reference.halfExtents[face];
+
+	// Incident face is the face most opposed to the reference normal
+	int incidentFace = 0;
+	float incidentDot = 0;
+
+	for(int i = 0; i < 3; i++){
+		float dot = incident.axes[i] * normal;
+
+		if(abs(dot) > abs(incidentDot)){
+			incidentFace = i;
+			incidentDot = dot;
+		}
+	}
+
+	contactInfo_.index2 = incidentFace * 2 + (incidentDot > 0 ? 1 : 0);
+
+	int incidentU = (incidentFace + 1) % 3;
+	int incidentV = (incidentFace + 2) % 3;
+
+	Vec3 incidentCenter = incident.center + incident.axes[incidentFace] * (incidentDot > 0 ? -incident.halfExtents[incidentFace] : incident.halfExtents[incidentFace]);
+	Vec3 u = incident.axes[incidentU] * incident.halfExtents[incidentU];
+	Vec3 v = incident.axes[incidentV] * incident.halfExtents[incidentV];
+
+	// Incident face vertices in cyclic order, each clip adds at most one vertex
+	// Features start as the incident vertex and are combined with the side plane at each crossing
+	Vec3 points[8] = {incidentCenter + u + v, incidentCenter - u + v, incidentCenter - u - v, incidentCenter + u - v};
+	int features[8] = {0, 1, 2, 3};
+	Vec3 clipped[8];
+	int clippedFeatures[8];
+	int numPoints = 4;
+
+	// Clip against the four side planes of the reference face
+	for(int side = 0; side < 4 && numPoints > 0; side++){
+
+		int axis = (face + 1 + side / 2) % 3;
+		Vec3 sideNormal = side % 2 == 0 ? reference.axes[axis] : -reference.axes[axis];
+		float sideOffset = sideNormal * reference.center + reference.halfExtents[axis];
+
+		int numClipped = 0;
+
+		for(int i = 0; i < numPoints; i++){
+			const Vec3& p1 = points[i];
+			const Vec3& p2 = points[(i + 1) % numPoints];
+
+			float d1 = p1 * sideNormal - sideOffset;
+			float d2 = p2 * sideNormal - sideOffset;
+
+			if(d1 <= 0){
+				clippedFeatures[numClipped] = features[i];
+				clipped[numClipped++] = p1;
+			}
+
+			if((d1 <= 0) != (d2 <= 0)){
+				clippedFeatures[numClipped] = ntw::getClipFeature(features[i], features[(i + 1) % numPoints], side);
+				clipped[numClipped++] = p1 + (p2 - p1) * (d1 / (d1 - d2));
+			}
+		}
+
+		numPoints = numClipped;
+		std::copy(clipped, clipped + numClipped, points);
+		std::copy(clippedFeatures, clippedFeatures + numClipped, features);
+	}
+
+	// Points below the reference face are contacts, paired with their projection onto it
+	for(int i = 0; i < numPoints; i++){
+
+		float separation = normal * points[i] - faceOffset;
+
+		if(separation > 0)
+			continue;
+
+		Vec3 projected = points[i] - normal * separation;
+
+		if(referenceA)
+			addContact(projected, points[i], -normal, features[i]);
+		else
+			addContact(points[i], projected, normal, features[i]);
+	}
+
+	ntw::reduceContacts(manifold_.contacts);
+
+	return !manifold_.contacts.empty();
+}
+
+
+void PrimitiveCollision::addContact(const Vec3& pointA, const Vec3& pointB, const Vec3& normal, int feature){
+
+	Contact c;
+	c.obj1ContactGlobal = swapped_ ? pointB : pointA;
+	c.obj2ContactGlobal = swapped_ ? pointA : pointB;
+	c.normal = swapped_ ? -normal : normal;
+	c.feature = feature;
+
+	// Set contact properties and check its validity before adding
+	if(ntw::setContactProperties(c, collider1_->parent, collider2_->parent)){
+		manifold_.maxDistance = max(manifold_.maxDistance, c.depth);
+		manifold_.contacts.push_back(c);
+	}
+}
+
+PrimitiveCollision::Shape PrimitiveCollision::getShape(const Collider* collider){
+
+	const HitboxPrimitive& primitive = collider->hitboxScaled.primitive;
+	const Mat3& rotation = collider->rotation;
+
+	Shape shape;
+	shape.type = primitive.shape;
+	shape.center = rotation * primitive.center + collider->position;
+	shape.halfExtents = primitive.halfExtents;
+	shape.radius = primitive.radius;
+	shape.halfHeight = primitive.halfHeight;
+
+	// Local axes are the columns of the rotation
+	for(int i = 0; i < 3; i++)
+		shape.axes[i] = Vec3(rotation.get(0, i), rotation.get(1, i), rotation.get(2, i));
+
+	return shape;
+}
+
+Vec3 PrimitiveCollision::getClosestPointOnBox(const Shape& box, const Vec3& point){
+
+	Vec3 offset = point - box.center;
+	Vec3 closest = box.center;
+
+	for(int i = 0; i < 3; i++)
+		closest += box.axes[i] * min(max(offset * box.axes[i], -box.halfExtents[i]), box.halfExtents[i]);
+
+	return closest;
+}
+
+
+const ContactManifold& PrimitiveCollision::getContactPoints() const{
+	return manifold_;
+}
+
+SATContactInfo PrimitiveCollision::getContactInfo() const{
+	return contactInfo_;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ *	primitiveCollision.h
+ *
+ *	Closed form collision tests between primitive hitbox shapes.
+ *	Spheres and capsules are tested against each other and against boxes with closest points,
+ *	boxes are tested against each other on their 15 possible separating axes.
+ *	Pairs involving a hull are left to SATCollision.
+ *
+ */
+
+class PrimitiveCollision;
+
+#include"objects/object.h"
+#include"physics/physStruct.h"
+
+// Threshold to allow for a small amount of penetration before registering collision, matches SAT tests
+#define NTW_PRIMITIVE_THRESHOLD	-0.0001f
+
+// Distance a box axis must be closer by to replace an axis found earlier
+// Face axes of the first box are preferred, then face axes of the second, then edge axes
+#define NTW_PRIMITIVE_FEATURE_TOLERANCE	0.005f
+
+
+class PrimitiveCollision{
+	// Primitive moved into world space
+	struct Shape{
+		HitboxShape type;
+		Vec3 center;
+
+		// Local axes in world space, capsules lie along the third axis
+		Vec3 axes[3];
+
+		Vec3 halfExtents;
+		float radius;
+		float halfHeight;
+	};
+
+
+	// Colliders
+	const Collider* collider1_;
+	const Collider* collider2_;
+
+	Shape shape1_;
+	Shape shape2_;
+
+	// Shapes are tested in order of shape type, contacts are flipped back if the order was swapped
+	bool swapped_;
+
+	ContactManifold manifold_;
+	SATContactInfo contactInfo_;
+
+
+	bool testSpheres(const Vec3& centerA, float radiusA, const Vec3& centerB, float radiusB);
+	bool testSphereBox(const Vec3& centerA, float radiusA, const Shape& b);
+	bool testSphereCapsule(const Vec3& centerA, float radiusA, const Shape& b);
+	bool testCapsules(const Shape& a, const Shape& b);
+	bool testCapsuleBox(const Shape& a, const Shape& b);
+	bool testBoxes(const Shape& a, const Shape& b);
+
+	// Add contact between the first shape and the second shape tested, normal points from the second towards the first
+	// Clipped box contacts have a feature to match them between updates
+	void addContact(const Vec3& pointA, const Vec3& pointB, const Vec3& normal, int feature = -1);
+
+	static Shape getShape(const Collider* collider);
+	static Vec3 getClosestPointOnBox(const Shape& box, const Vec3& point);
+
+public:
+	PrimitiveCollision(const Collider* collider1, const Collider* collider2);
+
+	// Check if both colliders are primitives with a closed form test
+	static bool hasTest(const Collider* collider1, const Collider* collider2);
+
+	// Test collision, returns true if objects are colliding
+	bool testCollision();
+
+	// Get penetration vector and object contact points in world space
+	const ContactManifold& getContactPoints() const;
+
+	// Features the contacts were generated from, only compared between updates for warm starting
+	SATContactInfo getContactInfo() const;
+};
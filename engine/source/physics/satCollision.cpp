@@ -1,28 +1,77 @@
 #include"SATCollision.h"
 
 #include"core/error.h"
-#include"math/matrix.h"
 #include"physics/physDefine.h"
 #include"physics/physFunc.h"
 #include<algorithm>
 #include<limits>
 #include<math.h>
+#include<xmmintrin.h>
 
 using ntw::crossProduct;
 using ntw::getFaceToPointDistance;
 using ntw::getEdgeToEdgeDistance;
 using ntw::clipFaces;
+using ntw::getSupportPoint;
 using std::min;
 using std::max;
 
 
-SATCollision::SATCollision(const Collider* collider1, const Collider* collider2) : collider1_(collider1), collider2_(collider2),
-	hitbox1_(collider1->hitboxTransformed), hitbox2_(collider2->hitboxTransformed) {
-	
+SATCollision::SATCollision(const Collider* collider1, const Collider* collider2, SATBuffers& buffers) :
+	collider1_(collider1), collider2_(collider2), frame_(getFrame(collider1, collider2)),
+	hitbox1_(frame_ == collider1 ? collider1->hitboxScaled : buffers.localHitbox),
+	hitbox2_(frame_ == collider2 ? collider2->hitboxScaled : buffers.localHitbox), buffers_(buffers),
+	localized_(false), supportVertex1_(0), supportVertex2_(0) {
+
+	const Collider* other = frame_ == collider1 ? collider2 : collider1;
+
+	// Relative transform from the other collider's space to the frame collider's space
+	Mat3 frameRotationInv = frame_->rotation.getTranspose();
+	rotation_ = frameRotationInv * other->rotation;
+	translation_ = frameRotationInv * (other->position - frame_->position);
+}
+
+void SATCollision::localize(){
+
+	if(localized_)
+		return;
+
+	localized_ = true;
+
+	TransformedHitbox& localHitbox = buffers_.localHitbox;
+	const TransformedHitbox& hitbox = (frame_ == collider1_ ? collider2_ : collider1_)->hitboxScaled;
+
+	localHitbox.hitbox = hitbox.hitbox;
+	localHitbox.vertices.resize(hitbox.vertices.size());
+	localHitbox.faces.resize(hitbox.faces.size());
+	localHitbox.center = rotation_ * hitbox.center + translation_;
+
+	for(int i = 0; i < hitbox.vertices.size(); i++)
+		localHitbox.vertices[i] = rotation_ * hitbox.vertices[i] + translation_;
+
+	for(int i = 0; i < hitbox.faces.size(); i++){
+		localHitbox.faces[i].position = rotation_ * hitbox.faces[i].position + translation_;
+		localHitbox.faces[i].normal = rotation_ * hitbox.faces[i].normal;
+	}
+}
+
+Vec3 SATCollision::toFrame(const Collider* collider, const Vec3& v) const{
+	return collider == frame_ ? v : rotation_ * v + translation_;
+}
+
+const Collider* SATCollision::getFrame(const Collider* collider1, const Collider* collider2){
+
+	// Transform the hitbox with fewer features
+	const Hitbox* h1 = collider1->hitbox;
+	const Hitbox* h2 = collider2->hitbox;
+
+	return h1->vertices.size() + h1->faces.size() >= h2->vertices.size() + h2->faces.size() ? collider1 : collider2;
 }
 
 bool SATCollision::testCollision(){
-	
+
+	localize();
+
 	// Initialize contact point info to get shortest distance between features
 	contactInfo_ = {-std::numeric_limits<float>::max(), false, -1, -1};
 
@@ -42,16 +91,43 @@ bool SATCollision::testCollision(){
 bool SATCollision::testCollision(const SATSeparatingAxis& axis){
 	
 	// Check collision with previously found axis
+	// Hitboxes are used in their own collider's space, only the axis and support point are transformed
 	if(!axis.isEdgePair){
-		const SATFace& f = axis.index1 != -1 ? hitbox1_.faces[axis.index1] : hitbox2_.faces[axis.index2];
-		Vec3 support = getSupportPoint(axis.index1 != -1 ? hitbox2_ : hitbox1_, -f.normal);
+		bool isFace1 = axis.index1 != -1;
+
+		const Collider* faceCollider = isFace1 ? collider1_ : collider2_;
+		const Collider* supportCollider = isFace1 ? collider2_ : collider1_;
+		int& supportVertex = isFace1 ? supportVertex2_ : supportVertex1_;
+
+		const SATPlane& f = faceCollider->hitboxScaled.faces[isFace1 ? axis.index1 : axis.index2];
+		Vec3 support;
+
+		// Face in the frame's space, support point of the other hitbox is moved into it
+		if(faceCollider == frame_)
+			support = rotation_ * getSupportPoint(supportCollider->hitboxScaled, rotation_.getTranspose() * -f.normal, supportVertex) + translation_;
+
+		// Face in the other collider's space, support point of the frame's hitbox is moved out of the frame's space
+		else
+			support = rotation_.getTranspose() * (getSupportPoint(supportCollider->hitboxScaled, rotation_ * -f.normal, supportVertex) - translation_);
 
 		// Largest distance
 		if(getFaceToPointDistance(f, support) > NTW_SAT_THRESHOLD)
 			return false;
 	}
-	else if(getEdgeToEdgeDistance(hitbox1_, axis.index1, hitbox2_, axis.index2) > NTW_SAT_THRESHOLD)
-		return false;
+	else{
+		const TransformedHitbox& h1 = collider1_->hitboxScaled;
+		const TransformedHitbox& h2 = collider2_->hitboxScaled;
+		const SATHalfEdge& e1 = h1.hitbox->edges[axis.index1];
+		const SATHalfEdge& e2 = h2.hitbox->edges[axis.index2];
+
+		// Only the end points of the edges and the first hitbox's center are moved into the frame's space
+		float distance = getEdgeToEdgeDistance(
+			toFrame(collider1_, h1.vertices[e1.v1]), toFrame(collider1_, h1.vertices[e1.v2]), toFrame(collider1_, h1.center),
+			toFrame(collider2_, h2.vertices[e2.v1]), toFrame(collider2_, h2.vertices[e2.v2]));
+
+		if(distance > NTW_SAT_THRESHOLD)
+			return false;
+	}
 
 	// Separating axis is invalid, perform full SAT test
 	return testCollision();
@@ -59,12 +135,14 @@ bool SATCollision::testCollision(const SATSeparatingAxis& axis){
 
 ContactManifold SATCollision::getContactPoints(){
 
+	localize();
+
 	// Contact points on edges
 	if(contactInfo_.isEdgePair){
 
 		// Edges
-		const SATHalfEdge& e1 = hitbox1_.edges[contactInfo_.index1];
-		const SATHalfEdge& e2 = hitbox2_.edges[contactInfo_.index2];
+		const SATHalfEdge& e1 = hitbox1_.hitbox->edges[contactInfo_.index1];
+		const SATHalfEdge& e2 = hitbox2_.hitbox->edges[contactInfo_.index2];
 
 		// Edge start points
 		Vec3 p1 = hitbox1_.vertices[e1.v1];
@@ -79,13 +157,13 @@ ContactManifold SATCollision::getContactPoints(){
 		Vec3 n1 = crossProduct(d1, n);
 		Vec3 n2 = crossProduct(d2, n);
 
-		// Contact points are closest points on each edge
+		// Contact points are closest points on each edge, moved to world space
 		Contact c;
-		c.obj1ContactGlobal = p1 + ((((p2 - p1) * n2) / (d1 * n2)) * d1);
-		c.obj2ContactGlobal = p2 + ((((p1 - p2) * n1) / (d2 * n1)) * d2);
+		c.obj1ContactGlobal = frame_->rotation * (p1 + ((((p2 - p1) * n2) / (d1 * n2)) * d1)) + frame_->position;
+		c.obj2ContactGlobal = frame_->rotation * (p2 + ((((p1 - p2) * n1) / (d2 * n1)) * d2)) + frame_->position;
 
 		c.normal = (c.obj2ContactGlobal - c.obj1ContactGlobal).unitVector();
-		setContactProperties(c);
+		ntw::setContactProperties(c, collider1_->parent, collider2_->parent);
 
 		// Create manifold and return
 		ContactManifold m;
@@ -143,50 +221,56 @@ ContactManifold SATCollision::getContactPoints(){
 	}
 
 	// Get faces
-	const SATFace& f1 = hitbox1_.faces[fi1];
-	const SATFace& f2 = hitbox2_.faces[fi2];
+	const SATPlane& f1 = hitbox1_.faces[fi1];
+	const SATPlane& f2 = hitbox2_.faces[fi2];
 
 	// Clip faces to get single contact points
-	vector<Vec3> points = clipFaces(hitbox1_, fi1, hitbox2_, fi2);
+	vector<ClipPoint> points = clipFaces(hitbox1_, fi1, hitbox2_, fi2);
 
 	// Create manifold
 	ContactManifold m;
 	m.objects = {collider1_->parent, collider2_->parent};
 	m.maxDistance = -contactInfo_.distance;
+
+	normal = frame_->rotation * normal;
 	
-	for(const Vec3& v : points){
+	for(const ClipPoint& p : points){
 
 		Contact c;
+		const Vec3& v = p.position;
 
 		// Contact points for each object are clipped points projected onto each object's respective face
-		auto l_project = [](const Vec3& v, const SATFace& f){
+		auto l_project = [](const Vec3& v, const SATPlane& f){
 			const Vec3& p = f.position;
 			const Vec3& n = f.normal;
 			return v + (n * (((n * p) - (n * v)) / n.magnitude2()));
 		};
 
-		c.obj1ContactGlobal = l_project(v, f1);
-		c.obj2ContactGlobal = l_project(v, f2);
+		c.obj1ContactGlobal = frame_->rotation * l_project(v, f1) + frame_->position;
+		c.obj2ContactGlobal = frame_->rotation * l_project(v, f2) + frame_->position;
 		c.normal = normal;
+		c.feature = p.feature;
 
 		// Set contact properties and check its validity before adding
-		if(setContactProperties(c))
+		if(ntw::setContactProperties(c, collider1_->parent, collider2_->parent))
 			m.contacts.push_back(c);
 	}
 
+	ntw::reduceContacts(m.contacts);
+
 	return m;
 }
 
 
-float SATCollision::queryFaces(const Hitbox& hitbox1, const Hitbox& hitbox2, bool useIndex1){
+float SATCollision::queryFaces(const TransformedHitbox& hitbox1, const TransformedHitbox& hitbox2, bool useIndex1){
 
 	float maxDistance = -std::numeric_limits<float>::max();
 
 	// Loop through faces
 	for(int i = 0; i < hitbox1.faces.size(); i++){
 
-		const SATFace& f = hitbox1.faces[i];
-		Vec3 support = getSupportPoint(hitbox2, -f.normal);
+		const SATPlane& f = hitbox1.faces[i];
+		Vec3 support = getSupportPoint(hitbox2, -f.normal, useIndex1 ? supportVertex2_ : supportVertex1_);
 		float distance = getFaceToPointDistance(f, support);
 
 		// Largest distance
@@ -200,7 +284,7 @@ float SATCollision::queryFaces(const Hitbox& hitbox1, const Hitbox& hitbox2, boo
 		}
 
 		// Smallest penetration distance over all features
-		if(distance < 0 && distance > contactInfo_.distance){
+		if(distance < 0 && distance > contactInfo_.distance + (useIndex1 ? 0 : NTW_SAT_FEATURE_TOLERANCE)){
 
 			// Set contact info
 			contactInfo_.distance = distance;
@@ -220,127 +304,145 @@ float SATCollision::queryFaces(const Hitbox& hitbox1, const Hitbox& hitbox2, boo
 	return maxDistance;
 }
 
-float SATCollision::queryEdges(const Hitbox& hitbox1, const Hitbox& hitbox2){
+float SATCollision::queryEdges(const TransformedHitbox& hitbox1, const TransformedHitbox& hitbox2){
 
 	float maxDistance = -std::numeric_limits<float>::max();
 
-	// Loop through edge pairs
-	for(int i = 0; i < hitbox1.edges.size(); i++){
-		for(int j = 0; j < hitbox2.edges.size(); j++){
+	// Edges are shared topology
+	const vector<SATHalfEdge>& edges1 = hitbox1.hitbox->edges;
+	const vector<SATHalfEdge>& edges2 = hitbox2.hitbox->edges;
 
-			const SATHalfEdge& e1 = hitbox1.edges[i];
-			const SATHalfEdge& e2 = hitbox2.edges[j];
+	int numEdges2 = (int)edges2.size();
 
-			// Check for invalid edge faces
-			if(e1.f1 == -1 || e1.f2 == -1 || e2.f1 == -1 || e2.f2 == -1)
-				continue;
 
-			// Edge pruning
-			if(isMinkowskiFace(hitbox1.faces[e1.f1].normal, hitbox1.faces[e1.f2].normal, -hitbox2.faces[e2.f1].normal, -hitbox2.faces[e2.f2].normal)){
-				float distance = getEdgeToEdgeDistance(hitbox1, i, hitbox2, j);
+	// Gauss map arcs of second hitbox edges, negated for the Minkowski difference
+	// Components of C, D and D x C are each stored in an array padded to a multiple of 4 edges
+	int stride = (numEdges2 + 3) & ~3;
 
-				// Largest distance
-				if(distance > maxDistance){
-					maxDistance = distance;
+	vector<float>& arcs = buffers_.edgeArcs;
+	arcs.assign(stride * 9, 0.0f);
 
-					// Set separating axis info
-					separatingAxis_.isEdgePair = true;
-					separatingAxis_.index1 = i;
-					separatingAxis_.index2 = j;
-				}
+	for(int j = 0; j < numEdges2; j++){
+		const SATHalfEdge& e2 = edges2[j];
 
-				// Smallest penetration distance over all features
-				if(distance < 0 && distance > contactInfo_.distance){
+		// Edges without two faces and padding keep zero arcs, which never pass the test
+		if(e2.f1 == -1 || e2.f2 == -1)
+			continue;
 
-					// Set contact info
-					contactInfo_.distance = distance;
-					contactInfo_.isEdgePair = true;
-					contactInfo_.index1 = i;
-					contactInfo_.index2 = j;
-				}
-			}
+		Vec3 c = -hitbox2.faces[e2.f1].normal;
+		Vec3 d = -hitbox2.faces[e2.f2].normal;
+		Vec3 dxc = crossProduct(d, c);
+
+		for(int k = 0; k < 3; k++){
+			arcs[k * stride + j]		= c[k];
+			arcs[(k + 3) * stride + j]	= d[k];
+			arcs[(k + 6) * stride + j]	= dxc[k];
 		}
 	}
 
-	return maxDistance;
-}
+	// Dot products of 4 arcs starting at edge j with a vector, component 0 for C, 3 for D and 6 for D x C
+	auto l_dot = [&arcs, stride](int component, int j, __m128 x, __m128 y, __m128 z) -> __m128 {
+		const float* p = arcs.data() + component * stride + j;
 
-Vec3 SATCollision::getSupportPoint(const Hitbox& hitbox, const Vec3& direction){
+		return _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(p), x),
+			_mm_mul_ps(_mm_loadu_ps(p + stride), y)),
+			_mm_mul_ps(_mm_loadu_ps(p + stride * 2), z));
+	};
 
-	Vec3 vertex = hitbox.vertices[0];
-	float maxProduct = direction * vertex;
+	__m128 zero = _mm_setzero_ps();
 
-	for(int i = 1; i < hitbox.vertices.size(); i++){
-		const Vec3& v = hitbox.vertices[i];
-		float product = direction * v;
 
-		if(product > maxProduct){
-			vertex = v;
-			maxProduct = product;
-		}
-	}
+	// Loop through edge pairs, testing 4 edges of the second hitbox at a time
+	for(int i = 0; i < edges1.size(); i++){
 
-	return vertex;
-}
+		const SATHalfEdge& e1 = edges1[i];
 
+		// Check for invalid edge faces
+		if(e1.f1 == -1 || e1.f2 == -1)
+			continue;
 
-SATCollision::EdgeInterval SATCollision::project(const Hitbox& hitbox, const Vec3& axis){
+		const Vec3& a = hitbox1.faces[e1.f1].normal;
+		const Vec3& b = hitbox1.faces[e1.f2].normal;
+		Vec3 bxa = crossProduct(b, a);
 
-	float d = hitbox.vertices[0] * axis;
-	EdgeInterval i = {d, d};
+		__m128 ax = _mm_set1_ps(a[0]), ay = _mm_set1_ps(a[1]), az = _mm_set1_ps(a[2]);
+		__m128 bx = _mm_set1_ps(b[0]), by = _mm_set1_ps(b[1]), bz = _mm_set1_ps(b[2]);
+		__m128 bxax = _mm_set1_ps(bxa[0]), bxay = _mm_set1_ps(bxa[1]), bxaz = _mm_set1_ps(bxa[2]);
 
-	// Get smallest and largest dot product
-	for(const Vec3& v : hitbox.vertices){
-		d = v * axis;
-		i.v1 = min(i.v1, d);
-		i.v2 = max(i.v2, d);
-	}
+		for(int j = 0; j < numEdges2; j += 4){
 
-	return i;
-}
+			// Arc CD must cross the plane of arc AB, which rejects most edge pairs
+			__m128 cba = l_dot(0, j, bxax, bxay, bxaz);
+			__m128 dba = l_dot(3, j, bxax, bxay, bxaz);
+			__m128 crosses = _mm_cmplt_ps(_mm_mul_ps(cba, dba), zero);
 
-bool SATCollision::isMinkowskiFace(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d){
+			if(_mm_movemask_ps(crosses) == 0)
+				continue;
 
-	Vec3 bxa = crossProduct(b, a);
-	Vec3 dxc = crossProduct(d, c);
+			// Arc AB must cross the plane of arc CD, and both arcs must be on the same hemisphere
+			__m128 adc = l_dot(6, j, ax, ay, az);
+			__m128 bdc = l_dot(6, j, bx, by, bz);
 
-	float cba = c * bxa;
-	float dba = d * bxa;
-	float adc = a * dxc;
-	float bdc = b * dxc;
+			int minkowskiFaces = _mm_movemask_ps(_mm_and_ps(crosses, _mm_and_ps(
+				_mm_cmplt_ps(_mm_mul_ps(adc, bdc), zero),
+				_mm_cmpgt_ps(_mm_mul_ps(cba, bdc), zero))));
 
-	return cba * dba < 0 && adc * bdc < 0 && cba * bdc > 0;
-}
+			// Edge pairs that form a face on the Minkowski difference, in edge order
+			for(int k = 0; k < 4; k++){
 
-bool SATCollision::setContactProperties(Contact& c){
+				if(!(minkowskiFaces & (1 << k)))
+					continue;
 
-	c.depth = (c.obj2ContactGlobal - c.obj1ContactGlobal) * c.normal;
+				float distance = getEdgeToEdgeDistance(hitbox1, i, hitbox2, j + k);
 
-	// Check validity
-	if(c.depth < 0)
-		return false;
+				// Largest distance
+				if(distance > maxDistance){
+					maxDistance = distance;
 
+					// Set separating axis info
+					separatingAxis_.isEdgePair = true;
+					separatingAxis_.index1 = i;
+					separatingAxis_.index2 = j + k;
+				}
 
-	// Contact vector
-	c.obj1ContactVector = c.obj1ContactGlobal - collider1_->parent->getTPosition();
-	c.obj2ContactVector = c.obj2ContactGlobal - collider2_->parent->getTPosition();
+				// Smallest penetration distance over all features
+				if(distance < 0 && distance > contactInfo_.distance + NTW_SAT_FEATURE_TOLERANCE){
+
+					// Set contact info
+					contactInfo_.distance = distance;
+					contactInfo_.isEdgePair = true;
+					contactInfo_.index1 = i;
+					contactInfo_.index2 = j + k;
+				}
+			}
+		}
+	}
+
+	return maxDistance;
+}
 
-	// Contact tangents
-	if(c.normal[0] >= 0.57735f)
-		c.tangent1 = Vec3(c.normal[1], -c.normal[0], 0);
-	else
-		c.tangent1 = Vec3(0, c.normal[2], -c.normal[1]);
+SATCollision::EdgeInterval SATCollision::project(const TransformedHitbox& hitbox, const Vec3& axis, int vertex){
 
-	c.tangent1.normalize();
-	c.tangent2 = crossProduct(c.normal, c.tangent1);
+	// Smallest and largest dot product are support points in opposite directions
+	int minVertex = vertex;
 
-	return true;
+	EdgeInterval i;
+	i.v1 = getSupportPoint(hitbox, -axis, minVertex) * axis;
+	i.v2 = getSupportPoint(hitbox, axis, vertex) * axis;
+
+	return i;
 }
 
 void SATCollision::setContactInfo(const SATContactInfo& contactInfo){
 	contactInfo_ = contactInfo;
 }
 
+void SATCollision::setSupportVertices(int vertex1, int vertex2){
+	supportVertex1_ = vertex1;
+	supportVertex2_ = vertex2;
+}
+
 SATSeparatingAxis SATCollision::getSeparatingAxis(){
 	return separatingAxis_;
 }
@@ -348,3 +450,11 @@ SATSeparatingAxis SATCollision::getSeparatingAxis(){
 SATContactInfo SATCollision::getContactInfo(){
 	return contactInfo_;
 }
+
+int SATCollision::getSupportVertex1() const{
+	return supportVertex1_;
+}
+
+int SATCollision::getSupportVertex2() const{
+	return supportVertex2_;
+}
@@ -4,6 +4,10 @@
  *	satCollision.h
  *
  *	SAT collision tester and contact point generator.
+ *	Tests are done in the space of the collider with the larger hitbox,
+ *	only the smaller hitbox is transformed and contacts are returned in world space.
+ *	The smaller hitbox is transformed only for a full test, a test against a cached
+ *	separating axis moves just the axis and the support points between spaces.
  *
  */
 
@@ -15,6 +19,11 @@ class SATCollision;
 // Threshold to allow for a small amount of penetration before registering collision
 #define NTW_SAT_THRESHOLD	-0.0001f
 
+// Distance a feature must be closer by to replace a feature found earlier
+// Faces of the first hitbox are preferred, then faces of the second, then edges
+// Keeps contact features stable between updates when distances are nearly equal
+#define NTW_SAT_FEATURE_TOLERANCE	0.005f
+
 
 class SATCollision{
 	// Projected interval for edge query
@@ -28,9 +37,19 @@ class SATCollision{
 	const Collider* collider1_;
 	const Collider* collider2_;
 
-	// Transformed hitbox of each collider
-	const Hitbox& hitbox1_;
-	const Hitbox& hitbox2_;
+	// Collider whose space the test is done in
+	const Collider* frame_;
+
+	// Hitbox of each collider in the space of frame_, valid once localized_ is set
+	const TransformedHitbox& hitbox1_;
+	const TransformedHitbox& hitbox2_;
+
+	SATBuffers& buffers_;
+
+	// Transform from the other collider's space to the space of frame_
+	Mat3 rotation_;
+	Vec3 translation_;
+	bool localized_;
 
 	// Store info of separating axis
 	SATSeparatingAxis separatingAxis_;
@@ -38,20 +57,27 @@ class SATCollision{
 	// Store info for contact point generation
 	SATContactInfo contactInfo_;
 
+	// Last support vertex found on each hitbox, support queries climb from here
+	int supportVertex1_;
+	int supportVertex2_;
+
 
-	float queryFaces(const Hitbox& hitbox1, const Hitbox& hitbox2, bool useIndex1);
-	float queryEdges(const Hitbox& hitbox1, const Hitbox& hitbox2);
+	float queryFaces(const TransformedHitbox& hitbox1, const TransformedHitbox& hitbox2, bool useIndex1);
+	float queryEdges(const TransformedHitbox& hitbox1, const TransformedHitbox& hitbox2);
 
-	Vec3 getSupportPoint(const Hitbox& hitbox, const Vec3& direction);
+	EdgeInterval project(const TransformedHitbox& hitbox, const Vec3& axis, int vertex);
 
-	EdgeInterval project(const Hitbox& hitbox, const Vec3& axis);
+	// Transform the other collider's hitbox into the space of frame_
+	void localize();
 
-	bool isMinkowskiFace(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d);
+	// Point of a collider's hitbox in the space of frame_
+	Vec3 toFrame(const Collider* collider, const Vec3& v) const;
 
-	bool setContactProperties(Contact& c);
+	static const Collider* getFrame(const Collider* collider1, const Collider* collider2);
 
 public:
-	SATCollision(const Collider* collider1, const Collider* collider2);
+	// Buffers receive the smaller hitbox in the space of the other collider on a full test, and must outlive the tester
+	SATCollision(const Collider* collider1, const Collider* collider2, SATBuffers& buffers);
 
 	// Test collision, returns true if objects are colliding
 	bool testCollision();
@@ -61,7 +87,10 @@ public:
 	ContactManifold getContactPoints();
 
 	void setContactInfo(const SATContactInfo& contactInfo);
+	void setSupportVertices(int vertex1, int vertex2);
 
 	SATSeparatingAxis getSeparatingAxis();
 	SATContactInfo getContactInfo();
+	int getSupportVertex1() const;
+	int getSupportVertex2() const;
 };